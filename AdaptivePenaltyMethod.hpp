@@ -11,40 +11,728 @@
  * Please, read README file for more information about
  * the method.
  *
+ * The class is a template on the type of the values ('T'), on the
+ * type of the sums ('Accumulator', which may be wider than 'T' for
+ * accuracy) and on the type of the sizes and indices ('Index').
+ * 'AdaptivePenaltyMethod' is the class with 'double' values.
+ * The internal buffers come from a std::pmr::memory_resource given to
+ * the constructor, so the library requires C++17.
+ *
  * Compilation:
  * Use the following command to compile this code:
- * g++ -c AdaptivePenaltyMethod.cpp
- * This will generate a 'AdaptivePenaltyMethod.o' object file.
+ * g++ -c -pthread AdaptivePenaltyMethod.cpp AdaptivePenaltyMethodKernels.cpp AdaptivePenaltyMethodParallel.cpp
+ * This will generate the 'AdaptivePenaltyMethod.o',
+ * 'AdaptivePenaltyMethodKernels.o' and 'AdaptivePenaltyMethodParallel.o'
+ * object files. The first one contains the classes with 'float',
+ * 'double' and 'long double' values, the class with 'float' values
+ * and 'double' sums and the instrumented class with 'double' values.
  * To use the AdaptivePenaltyMethod class, it is only necessary
  * to include the "AdaptivePenaltyMethod.hpp" file, 
- * to link the AdaptivePenaltyMethod.o to the compiled code, and
+ * to link the object files to the compiled code (with -pthread), and
  * to instantiate a object of this class.
+ * Other combinations of types are available by including the
+ * "AdaptivePenaltyMethodImpl.hpp" file instead.
+ * Define APM_HEADER_ONLY to use the class as a header-only library:
+ * the definitions of the methods are included by this file and
+ * AdaptivePenaltyMethod.o is not needed, but the kernels and the
+ * thread pool, which hold global state (the selected instruction set
+ * and the worker threads), must still be linked. With CMake, both
+ * ways are given by the 'apm::apm' target (see CMakeLists.txt).
+ * The code which includes this file compiles the inline methods (and,
+ * with APM_HEADER_ONLY, all of them), so it must be compiled with
+ * -ffp-contract=off (GCC and Clang) for the results to be the ones of
+ * the library; the 'apm::apm' target gives this option to its users.
  */
 
 #ifndef ADAPTIVEPENALTYMETHOD_HPP
 #define	ADAPTIVEPENALTYMETHOD_HPP
 
+/*
+ * Includes.
+ */
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#if __cplusplus >= 202002L
+#include <span>
+#endif
+
+#include "AdaptivePenaltyMethodKernels.hpp"
+
 namespace apm {
 
+/*
+ * Memory layouts of a contiguous matrix of constraint violation values.
+ * - ROW_MAJOR: the violations of each candidate solution are contiguous,
+ * i.e. the violation of constraint 'j' by candidate solution 'i' is at
+ * position 'i * leadingDimension + j', where
+ * 'leadingDimension >= numberOfConstraints';
+ * - COLUMN_MAJOR: the violations of each constraint are contiguous
+ * (structure of arrays), i.e. the violation of constraint 'j' by
+ * candidate solution 'i' is at position 'j * leadingDimension + i', where
+ * 'leadingDimension >= populationSize'.
+ */
+enum ViolationLayout {
+	ROW_MAJOR,
+	COLUMN_MAJOR
+};
+
+/*
+ * Ways of updating the penalty coefficients owned by an object
+ * (see BasicAdaptivePenaltyMethod::setCoefficientUpdate).
+ * - REPLACE_COEFFICIENTS: the new coefficients replace the current ones;
+ * - SMOOTH_COEFFICIENTS: exponential moving average ("damped" APM), i.e.
+ * 'k = smoothingFactor * newK + ( 1 - smoothingFactor ) * k';
+ * - MONOTONE_COEFFICIENTS: the coefficients never decrease, i.e.
+ * 'k = max( k, newK )'.
+ * The first update always takes the new coefficients.
+ */
+enum CoefficientUpdate {
+	REPLACE_COEFFICIENTS,
+	SMOOTH_COEFFICIENTS,
+	MONOTONE_COEFFICIENTS
+};
+
+/*
+ * Kinds of the constraints (see BasicAdaptivePenaltyMethod::setConstraintKind).
+ * - INEQUALITY_CONSTRAINT: the value given for the constraint is 'g(x)'
+ * and it is violated if 'g(x) > 0';
+ * - EQUALITY_CONSTRAINT: the value given for the constraint is 'h(x)'
+ * and its violation is '|h(x)| - tolerance', i.e. it is violated if
+ * '|h(x)| > tolerance'.
+ */
+enum ConstraintKind {
+	INEQUALITY_CONSTRAINT,
+	EQUALITY_CONSTRAINT
+};
+
+/*
+ * How the sums over a population are calculated (see
+ * BasicAdaptivePenaltyMethod::setSummationPolicy). The candidate solutions
+ * of a tile (256 of them) are always added in order by the kernels; the
+ * policy concerns how the sums of the tiles of a reduction block and of
+ * the blocks of the population are added.
+ * - NAIVE_SUMMATION: the sums are added in order (the error grows
+ * with the size of the population);
+ * - PAIRWISE_SUMMATION: the sums are added by a balanced tree (the error
+ * grows with the logarithm of the size of the population);
+ * - COMPENSATED_SUMMATION: the sums are added in order with the
+ * compensation of Neumaier (an improved Kahan summation), whose error
+ * does not grow with the number of tiles.
+ */
+enum SummationPolicy {
+	NAIVE_SUMMATION,
+	PAIRWISE_SUMMATION,
+	COMPENSATED_SUMMATION
+};
+
+namespace detail {
+
+	/*
+	 * Penalty of a candidate solution whose constraint violations are
+	 * found 'stride' elements apart. 'infeasible' indicates if some
+	 * constraint is violated. If 'Constraints' is not 0, it is the
+	 * number of constraints and the loop is unrolled.
+	 */
+	template< typename Accumulator, int Constraints, typename T, typename Index >
+	inline Accumulator penaltyOf(
+		const T* constraintViolationValues,
+		std::size_t stride,
+		Index numberOfConstraints,
+		const T* penaltyCoefficients,
+		const kernels::ConstraintKinds< T >& kinds,
+		bool& infeasible ) {
+
+		Accumulator penalty;
+		unsigned char violated;
+		if ( Constraints > 0 ) {
+			kernels::calculatePenaltiesFixed< T, Accumulator, Constraints >( &penalty, &violated,
+				constraintViolationValues, 1, 0, stride, Constraints, penaltyCoefficients, kinds );
+		} else {
+			kernels::calculatePenaltiesScalar< T, Accumulator >( &penalty, &violated,
+				constraintViolationValues, 1, 0, stride, numberOfConstraints, penaltyCoefficients, kinds );
+		}
+		infeasible = violated;
+		return penalty;
+	}
+
+	/*
+	 * Alignment, in bytes, of the internal buffers.
+	 */
+	const std::size_t BUFFER_ALIGNMENT = 64;
+
+	/*
+	 * Allocator of the internal buffers: the memory comes from a
+	 * std::pmr::memory_resource and is aligned to BUFFER_ALIGNMENT bytes,
+	 * so the kernels may use aligned loads. The buffers of a copy of an
+	 * object come from the memory resource of the original one.
+	 */
+	template< typename X >
+	struct ResourceAllocator {
+		typedef X value_type;
+		typedef std::true_type propagate_on_container_copy_assignment;
+		typedef std::true_type propagate_on_container_move_assignment;
+		typedef std::true_type propagate_on_container_swap;
+
+		std::pmr::memory_resource* resource;
+
+		ResourceAllocator( std::pmr::memory_resource* resource ) noexcept:
+			resource( resource ) {
+		}
+
+		template< typename Y >
+		ResourceAllocator( const ResourceAllocator< Y >& other ) noexcept:
+			resource( other.resource ) {
+		}
+
+		X* allocate( std::size_t n ) {
+			if ( n > (std::size_t) -1 / sizeof( X ) ) {
+				throw std::bad_array_new_length( );
+			}
+			return static_cast< X* >( this->resource->allocate( n * sizeof( X ), BUFFER_ALIGNMENT ) );
+		}
+
+		void deallocate( X* values, std::size_t n ) noexcept {
+			this->resource->deallocate( values, n * sizeof( X ), BUFFER_ALIGNMENT );
+		}
+	};
+
+	template< typename X, typename Y >
+	bool operator==( const ResourceAllocator< X >& a, const ResourceAllocator< Y >& b ) noexcept {
+		return a.resource == b.resource || a.resource->is_equal( *b.resource );
+	}
+
+	template< typename X, typename Y >
+	bool operator!=( const ResourceAllocator< X >& a, const ResourceAllocator< Y >& b ) noexcept {
+		return !( a == b );
+	}
+
+	/*
+	 * An internal buffer.
+	 */
+	template< typename X >
+	using Buffer = std::vector< X, ResourceAllocator< X > >;
+
+	/*
+	 * Storage of the sums of the constraint violations: an array inside
+	 * the object if the number of constraints is known at compile time
+	 * and a buffer allocated by the constructor otherwise.
+	 */
+	template< typename Accumulator, int Constraints >
+	struct ConstraintSums {
+		typedef std::array< Accumulator, Constraints > Type;
+
+		static Type allocate( std::size_t, std::pmr::memory_resource* ) {
+			return Type( );
+		}
+	};
+
+	template< typename Accumulator >
+	struct ConstraintSums< Accumulator, 0 > {
+		typedef Buffer< Accumulator > Type;
+
+		static Type allocate( std::size_t numberOfConstraints, std::pmr::memory_resource* resource ) {
+			return Type( numberOfConstraints, resource );
+		}
+	};
+
+	/*
+	 * A mutex which does not prevent its object from being copied or
+	 * moved: the new object has its own mutex, which is not locked.
+	 */
+	struct CopyableMutex {
+		std::mutex mutex;
+
+		CopyableMutex( ) noexcept {
+		}
+
+		CopyableMutex( const CopyableMutex& ) noexcept {
+		}
+
+		CopyableMutex& operator=( const CopyableMutex& ) noexcept {
+			return *this;
+		}
+	};
+
+	/*
+	 * Measure of the time elapsed since the construction, which is
+	 * only made by the instrumented classes.
+	 */
+	template< bool Instrumented >
+	struct Stopwatch {
+		double elapsed( ) const {
+			return 0;
+		}
+	};
+
+	template< >
+	struct Stopwatch< true > {
+		std::chrono::steady_clock::time_point start;
+
+		Stopwatch( ):
+			start( std::chrono::steady_clock::now( ) ) {
+		}
+
+		double elapsed( ) const {
+			return std::chrono::duration< double >( std::chrono::steady_clock::now( ) - this->start ).count( );
+		}
+	};
+
+	/*
+	 * Statistics of the classes which are not instrumented.
+	 */
+	struct NoStatistics {
+		NoStatistics( std::size_t, std::pmr::memory_resource* ) {
+		}
+	};
+
+}
+
+/*
+ * Statistics of the last population evaluated by an instrumented object
+ * (see BasicAdaptivePenaltyMethod::getStatistics). They are collected
+ * while the population is traversed, without another pass over it.
+ * - feasibleCandidates: number of feasible candidate solutions;
+ * - violatingCandidates: for each constraint, the number of candidate
+ * solutions which violate it;
+ * - sumViolation: for each constraint, the sum of its violations;
+ * - denominator: the sum of the squares of 'sumViolation' (the
+ * denominator of the equation of the penalty coefficients);
+ * - averageObjectiveFunctionValues: the average of the objective
+ * function values, used by the fitness function;
+ * - penalizedCandidates, minimumPenalty, maximumPenalty: the number of
+ * infeasible candidate solutions whose fitness values were calculated
+ * and the smallest and the largest penalty added (0 if there is none);
+ * - accumulationTime, coefficientTime, fitnessTime: the time, in seconds,
+ * of the last pass which accumulated the sums over a population, of the
+ * last calculation of the penalty coefficients from the sums and of the
+ * last calculation of the fitness values of a population.
+ * 'feasibleCandidates' and 'violatingCandidates' are the ones of the
+ * last pass over a whole population (not of the chunks of
+ * 'accumulateChunk' or of the populations of a batch).
+ */
+template< typename Accumulator, typename Index >
+struct GenerationStatistics {
+	Index feasibleCandidates;
+	detail::Buffer< Index > violatingCandidates;
+	detail::Buffer< Accumulator > sumViolation;
+	Accumulator denominator;
+	Accumulator averageObjectiveFunctionValues;
+	Index penalizedCandidates;
+	Accumulator minimumPenalty;
+	Accumulator maximumPenalty;
+	double accumulationTime;
+	double coefficientTime;
+	double fitnessTime;
+
+	GenerationStatistics( std::size_t numberOfConstraints, std::pmr::memory_resource* resource ):
+		feasibleCandidates( 0 ),
+		violatingCandidates( numberOfConstraints, 0, resource ),
+		sumViolation( numberOfConstraints, 0, resource ),
+		denominator( 0 ),
+		averageObjectiveFunctionValues( 0 ),
+		penalizedCandidates( 0 ),
+		minimumPenalty( 0 ),
+		maximumPenalty( 0 ),
+		accumulationTime( 0 ),
+		coefficientTime( 0 ),
+		fitnessTime( 0 ) {
+	}
+};
+
+/*
+ * The penalty coefficients, the average of the objective function values
+ * and the kinds of the constraints of a generation, which are all that
+ * the fitness function needs (see BasicAdaptivePenaltyMethod::makeSnapshot).
+ * A snapshot never changes and all its methods are const, so it can be
+ * shared by threads (e.g. through a std::shared_ptr< const CoefficientSnapshot >)
+ * without locks while the object which made it calculates the coefficients
+ * of the next generation: the object is the step which calculates the
+ * coefficients, and the snapshot is the evaluator of a generation. The
+ * version identifies the calculation of the coefficients: two snapshots
+ * with the same version give the same fitness values.
+ */
+template< typename T, typename Accumulator = T >
+class CoefficientSnapshot {
+	public:
+		/*
+		 * Constructor.
+		 * Parameters:
+		 * - numberOfConstraints: the number of constraints of the problem;
+		 * - penaltyCoefficients: the penalty coefficients (copied);
+		 * - averageObjectiveFunctionValues: the average of the objective
+		 * function values of the population;
+		 * - version: the version of the coefficients;
+		 * - constraintScales, tolerances: the kinds of the constraints
+		 * (see kernels::ConstraintKinds), copied; null if all the
+		 * constraints are inequalities;
+		 * - resource: the memory resource of the copies.
+		 */
+		CoefficientSnapshot( 
+			std::size_t numberOfConstraints, 
+			const T* penaltyCoefficients, 
+			Accumulator averageObjectiveFunctionValues, 
+			std::uint64_t version,
+			const T* constraintScales = 0,
+			const T* tolerances = 0,
+			std::pmr::memory_resource* resource = std::pmr::get_default_resource( ) ):
+			penaltyCoefficients( penaltyCoefficients, penaltyCoefficients + numberOfConstraints, resource ),
+			constraintScales( resource ),
+			tolerances( resource ),
+			averageObjectiveFunctionValues( averageObjectiveFunctionValues ),
+			version( version ) {
+
+			if ( constraintScales ) {
+				this->constraintScales.assign( constraintScales, constraintScales + numberOfConstraints );
+				this->tolerances.assign( tolerances, tolerances + numberOfConstraints );
+			}
+
+		}
+
+		std::size_t getNumberOfConstraints( ) const {
+			return this->penaltyCoefficients.size( );
+		}
+
+		const T* getPenaltyCoefficients( ) const {
+			return this->penaltyCoefficients.data( );
+		}
+
+		Accumulator getAverageObjectiveFunctionValues( ) const {
+			return this->averageObjectiveFunctionValues;
+		}
+
+		std::uint64_t getVersion( ) const {
+			return this->version;
+		}
+
+	/*
+	 * Name: calculateFitness
+	 * Description: Calculate the fitness value of a candidate solution
+	 * (see BasicAdaptivePenaltyMethod::calculateFitness); the result is
+	 * the one of the object which made the snapshot.
+	 * Parameters:
+	 * - objectiveFunctionValue: value of the objective function;
+	 * - constraintViolationValues: the constraint violation values,
+	 * found 'stride' elements apart.
+	 */
+	 T calculateFitness( 
+		T objectiveFunctionValue, 
+		const T* constraintViolationValues, 
+		std::size_t stride = 1 ) const {
+
+		 //the penalty is calculated as in BasicAdaptivePenaltyMethod::calculateFitness
+		 bool infeasible;
+		 const Accumulator penalty = detail::penaltyOf< Accumulator, 0 >( constraintViolationValues, stride,
+			 this->penaltyCoefficients.size( ), this->penaltyCoefficients.data( ), this->constraintKinds( ), infeasible );
+		 return kernels::fitnessOf< T, Accumulator >( objectiveFunctionValue, penalty, infeasible, this->averageObjectiveFunctionValues );
+	 }
+
+	/*
+	 * Name: calculateFitness
+	 * Description: Calculate the fitness values of a population (see
+	 * BasicAdaptivePenaltyMethod::calculateFitness); the results are the
+	 * ones of the object which made the snapshot, for any number of threads.
+	 * Parameters:
+	 * - fitnessValues: the fitness values calculated by this method;
+	 * - populationSize, objectiveFunctionValues, constraintViolationValues:
+	 * see BasicAdaptivePenaltyMethod::calculateFitness;
+	 * - threadCount: the number of threads which calculate the fitness
+	 * values or, if it is not positive, the number of hardware threads
+	 * (see BasicAdaptivePenaltyMethod::setThreadCount).
+	 */
+	 void calculateFitness( 
+		T* fitnessValues, 
+		std::size_t populationSize, 
+		const T* objectiveFunctionValues, 
+		const T* const* constraintViolationValues,
+		int threadCount = 1 ) const;
+
+	/*
+	 * Name: calculateFitness
+	 * Description: Same as the method above for the constraint violation
+	 * values in a contiguous matrix.
+	 */
+	 void calculateFitness( 
+		T* fitnessValues, 
+		std::size_t populationSize, 
+		const T* objectiveFunctionValues, 
+		const T* constraintViolationValues,
+		ViolationLayout layout,
+		std::size_t leadingDimension,
+		int threadCount = 1 ) const;
+
+	private:
+		template< typename Violations >
+		void penalize( 
+			T* fitnessValues, 
+			std::size_t populationSize, 
+			const T* objectiveFunctionValues, 
+			const Violations& constraintViolationValues,
+			int threadCount ) const;
+
+		kernels::ConstraintKinds< T > constraintKinds( ) const {
+			const kernels::ConstraintKinds< T > kinds = {
+				this->constraintScales.empty( )? 0: this->constraintScales.data( ),
+				this->tolerances.empty( )? 0: this->tolerances.data( ) };
+			return kinds;
+		}
+
+		detail::Buffer< T > penaltyCoefficients;
+		detail::Buffer< T > constraintScales;
+		detail::Buffer< T > tolerances;
+		Accumulator averageObjectiveFunctionValues;
+		std::uint64_t version;
+
+};
+
+/*
+ * Fitness values of a population calculated on demand with a snapshot
+ * (see CoefficientSnapshot), e.g. for the candidate solutions taken by
+ * tournaments: the fitness value of a candidate solution is only
+ * calculated the first time it is requested, and it is kept until the
+ * population is replaced or another snapshot is given.
+ * An object must not be used by two threads at the same time; the
+ * threads may share the snapshot and the population, each one with
+ * its own LazyFitness.
+ */
+template< typename T, typename Accumulator = T >
+class LazyFitness {
+	public:
+		/*
+		 * Constructor.
+		 * Parameters:
+		 * - resource: the memory resource of the cached fitness values.
+		 */
+		explicit LazyFitness( std::pmr::memory_resource* resource = std::pmr::get_default_resource( ) ):
+			populationSize( 0 ),
+			objectiveFunctionValues( 0 ),
+			rows( 0 ),
+			values( 0 ),
+			individualStride( 0 ),
+			constraintStride( 1 ),
+			epoch( 1 ),
+			evaluations( 0 ),
+			fitnessValues( resource ),
+			epochs( resource ) {
+		}
+
+	/*
+	 * Name: setPopulation
+	 * Description: Set the population whose fitness values are requested
+	 * (the values are not copied) and forget the cached fitness values.
+	 * Parameters:
+	 * - see BasicAdaptivePenaltyMethod::calculateFitness.
+	 */
+	 void setPopulation( 
+		std::size_t populationSize, 
+		const T* objectiveFunctionValues, 
+		const T* const* constraintViolationValues ) {
+
+		 this->resize( populationSize );
+		 this->objectiveFunctionValues = objectiveFunctionValues;
+		 this->rows = constraintViolationValues;
+		 this->values = 0;
+		 this->constraintStride = 1;
+	 }
+
+	/*
+	 * Name: setPopulation
+	 * Description: Same as the method above for the constraint violation
+	 * values in a contiguous matrix.
+	 */
+	 void setPopulation( 
+		std::size_t populationSize, 
+		const T* objectiveFunctionValues, 
+		const T* constraintViolationValues,
+		ViolationLayout layout,
+		std::size_t leadingDimension ) {
+
+		 this->resize( populationSize );
+		 this->objectiveFunctionValues = objectiveFunctionValues;
+		 this->rows = 0;
+		 this->values = constraintViolationValues;
+		 this->individualStride = layout == ROW_MAJOR? leadingDimension: 1;
+		 this->constraintStride = layout == ROW_MAJOR? 1: leadingDimension;
+	 }
 
-class AdaptivePenaltyMethod {
+	/*
+	 * Name: setSnapshot
+	 * Description: Set the snapshot of the coefficients used to calculate
+	 * the fitness values. The cached fitness values are forgotten unless
+	 * it is the current snapshot: the versions are counted by each object
+	 * of BasicAdaptivePenaltyMethod, so the snapshots of two objects may
+	 * have the same version and different coefficients.
+	 */
+	 void setSnapshot( std::shared_ptr< const CoefficientSnapshot< T, Accumulator > > snapshot ) {
+		 if ( !this->snapshot || snapshot != this->snapshot ) {
+			 this->epoch++;
+		 }
+		 this->snapshot = std::move( snapshot );
+	 }
+
+	 const std::shared_ptr< const CoefficientSnapshot< T, Accumulator > >& getSnapshot( ) const {
+		 return this->snapshot;
+	 }
+
+	/*
+	 * Name: getFitness
+	 * Description: Return the fitness value of a candidate solution,
+	 * which is calculated if it is not cached. std::logic_error is
+	 * thrown if there is no snapshot.
+	 * Parameters:
+	 * - individual: the index of the candidate solution.
+	 */
+	 T getFitness( std::size_t individual ) {
+		 if ( this->epochs[ individual ] != this->epoch ) {
+			 if ( !this->snapshot ) {
+				 throw std::logic_error( "the fitness values require a snapshot of the coefficients" );
+			 }
+			 const T* violations = this->rows? this->rows[ individual ]: this->values + individual * this->individualStride;
+			 this->fitnessValues[ individual ] = this->snapshot->calculateFitness( this->objectiveFunctionValues[ individual ],
+				 violations, this->constraintStride );
+			 this->epochs[ individual ] = this->epoch;
+			 this->evaluations++;
+		 }
+		 return this->fitnessValues[ individual ];
+	 }
+
+	/*
+	 * Name: isCached
+	 * Description: Indicates if the fitness value of a candidate solution
+	 * is cached.
+	 */
+	 bool isCached( std::size_t individual ) const {
+		 return this->epochs[ individual ] == this->epoch;
+	 }
+
+	/*
+	 * Name: getNumberOfEvaluations
+	 * Description: Return the number of fitness values calculated since
+	 * the construction.
+	 */
+	 std::size_t getNumberOfEvaluations( ) const {
+		 return this->evaluations;
+	 }
+
+	private:
+		void resize( std::size_t populationSize ) {
+			//the cached values of the previous population are older than the new epoch
+			this->populationSize = populationSize;
+			this->fitnessValues.resize( populationSize );
+			this->epochs.resize( populationSize, 0 );
+			this->epoch++;
+		}
+
+		std::size_t populationSize;
+		const T* objectiveFunctionValues;
+		const T* const* rows;
+		const T* values;
+		std::size_t individualStride;
+		std::size_t constraintStride;
+		std::shared_ptr< const CoefficientSnapshot< T, Accumulator > > snapshot;
+		//a fitness value is cached if its epoch is the current one
+		std::uint64_t epoch;
+		std::size_t evaluations;
+		detail::Buffer< T > fitnessValues;
+		detail::Buffer< std::uint64_t > epochs;
+
+};
+
+/*
+ * The Adaptive Penalty Method.
+ * - T: type of the objective function values, constraint violation
+ * values, penalty coefficients and fitness values;
+ * - Accumulator: type of the sums over the population and of the
+ * average of the objective function values;
+ * - Index: type of the population size and of the number of constraints;
+ * - Constraints: the number of constraints, if it is known at compile
+ * time (see FixedAdaptivePenaltyMethod), or 0 if it is given to the
+ * constructor;
+ * - Instrumented: if true, the statistics of the populations and the
+ * time of the phases are collected (see 'getStatistics'); otherwise,
+ * nothing is measured nor stored.
+ */
+template< typename T, typename Accumulator = T, typename Index = int, int Constraints = 0, bool Instrumented = false >
+class BasicAdaptivePenaltyMethod {
 	public:
 		/*
 		 * Constructor.
 		 * Parameters:
 		 * - numberOfConstraints: the number of constraints of the problem.
+		 * If it is known at compile time, it must be equal to 'Constraints'
+		 * (std::invalid_argument is thrown otherwise);
+		 * - resource: the memory resource of all the internal buffers (e.g.
+		 * a std::pmr::monotonic_buffer_resource of a job), which must outlive
+		 * the object and its copies. The buffers are aligned to 64 bytes.
+		 * If the chunks of a population are accumulated concurrently (see
+		 * 'accumulateChunk'), the memory resource must be thread-safe (e.g.
+		 * the default one or a std::pmr::synchronized_pool_resource).
 		 */
-		AdaptivePenaltyMethod( const int numberOfConstraints );
+		BasicAdaptivePenaltyMethod( 
+			const Index numberOfConstraints, 
+			std::pmr::memory_resource* resource = std::pmr::get_default_resource( ) );
 		
 		/*
-		 * Constructor.
+		 * Constructor. The copy has the state of 'orig' (sums, coefficients,
+		 * feasibility and chunks of the last population, and settings).
+		 */
+		BasicAdaptivePenaltyMethod( const BasicAdaptivePenaltyMethod& orig ) = default;
+
+		/*
+		 * Constructor. The storage of 'orig' is taken without allocations;
+		 * 'orig' may then only be assigned or destroyed.
+		 */
+		BasicAdaptivePenaltyMethod( BasicAdaptivePenaltyMethod&& orig ) noexcept = default;
+
+		/*
+		 * Assignment operators (see the constructors above). The copy
+		 * reuses the storage of the object when it is large enough.
+		 */
+		BasicAdaptivePenaltyMethod& operator=( const BasicAdaptivePenaltyMethod& orig ) = default;
+		BasicAdaptivePenaltyMethod& operator=( BasicAdaptivePenaltyMethod&& orig ) noexcept = default;
+
+		/*
+		 * Destructor. The class has no virtual methods, so the objects
+		 * are not deleted through pointers to a base class.
 		 */
-		AdaptivePenaltyMethod( const AdaptivePenaltyMethod& orig );
+		~BasicAdaptivePenaltyMethod( );
 
 		/*
-		 * Destructor.
+		 * Name: getMemoryResource
+		 * Description: Return the memory resource of the internal buffers.
 		 */
-		virtual ~AdaptivePenaltyMethod( );
+		std::pmr::memory_resource* getMemoryResource( ) const {
+			return this->partialSums.get_allocator( ).resource;
+		}
+
+		/*
+		 * Name: getStatistics
+		 * Description: Return the statistics of the last population
+		 * (only for the instrumented classes, see InstrumentedAdaptivePenaltyMethod).
+		 */
+		template< bool Enabled = Instrumented >
+		const typename std::enable_if< Enabled, GenerationStatistics< Accumulator, Index > >::type& getStatistics( ) const {
+			return this->statistics;
+		}
+
+		/*
+		 * Number of candidate solutions in a reduction block.
+		 * The sums over the population are calculated block by block
+		 * and the partial sums of the blocks are added in the order of
+		 * the blocks, regardless of the number of threads. Thus, the
+		 * results do not depend on the number of threads and, for
+		 * populations not larger than a block, the sums are the plain
+		 * sequential ones.
+		 */
+		static const int REDUCTION_BLOCK_SIZE = 4096;
 		
 	/*
 	 * Name: calculatePenaltyCoefficients
@@ -64,10 +752,10 @@ class AdaptivePenaltyMethod {
 	 * are used by the penalty function.
 	 */
 	 void calculatePenaltyCoefficients (
-		 int populationSize,
-		 double* objectiveFunctionValues,
-		 double** constraintViolationValues,
-		 double* penaltyCoefficients );
+		 Index populationSize,
+		 T* objectiveFunctionValues,
+		 T** constraintViolationValues,
+		 T* penaltyCoefficients );
 		 
 	/*
 	 * Name: calculateFitness
@@ -92,18 +780,20 @@ class AdaptivePenaltyMethod {
 	 * It is important to highlight that, here, a candidate 
 	 * solution 'x' is called infeasible if there is a restriction 
 	 * function 'g(x, i)' greater than zero, for all candidate 
-	 * constraint 'i'.
+	 * constraint 'i'. For an equality constraint 'i' (see
+	 * 'setConstraintKind'), the value is 'h(x, i)' and it is
+	 * violated if '|h(x, i)|' is greater than its tolerance.
 	 * - penaltyCoefficients: penalty coefficients
 	 * calculated by the adaptive penalty method and which
 	 * are used by the penalty function.
 	 */
 	 
 	 void calculateFitness( 
-		double* fitnessValues, 
-		int populationSize, 
-		double* objectiveFunctionValues, 
-		double** constraintViolationValues,
-		double* penaltyCoefficients );
+		T* fitnessValues, 
+		Index populationSize, 
+		T* objectiveFunctionValues, 
+		T** constraintViolationValues,
+		T* penaltyCoefficients );
 	 
 	 
 	 /*
@@ -124,29 +814,1270 @@ class AdaptivePenaltyMethod {
 	 * It is important to highlight that, here, a candidate 
 	 * solution 'x' is called infeasible if there is a restriction 
 	 * function 'g(x, i)' greater than zero, for all candidate 
-	 * constraint 'i'.
+	 * constraint 'i'. For an equality constraint 'i' (see
+	 * 'setConstraintKind'), the value is 'h(x, i)' and it is
+	 * violated if '|h(x, i)|' is greater than its tolerance.
+	 * - penaltyCoefficients: penalty coefficients
+	 * calculated by the adaptive penalty method and which
+	 * are used by the penalty function.
+	 * The method does not change the object, but it reads the average
+	 * calculated last: the threads which call it while the coefficients
+	 * of the next generation are calculated should use a snapshot
+	 * instead (see 'makeSnapshot').
+	 */
+	 
+	 T calculateFitness( 
+		T objectiveFunctionValue, 
+		T* constraintViolationValues,
+		T* penaltyCoefficients ) const {
+
+		 //indicates if the candidate solution is infeasible
+		 bool infeasible;
+
+		 //the penalty value (the loop is unrolled if the number of constraints is fixed)
+		 const Accumulator penalty = detail::penaltyOf< Accumulator, Constraints >( constraintViolationValues, 1,
+			 this->numberOfConstraints, penaltyCoefficients, this->constraintKinds( ), infeasible );
+
+		 //the fitness is the sum of the objective function and penalty values
+		 //if the candidate solution is infeasible and just the objective function value,
+		 //otherwise
+		 return kernels::fitnessOf< T, Accumulator >( objectiveFunctionValue, penalty, infeasible, this->averageObjectiveFunctionValues );
+	 }
+	 
+	 
+	/*
+	 * Name: evaluateGeneration
+	 * Description: Calculate the penalty coefficients and
+	 * the fitness values of a population in a single call.
+	 * The constraint violation values are read only once
+	 * for the whole population: while the violations are
+	 * accumulated, the feasibility of the candidate solutions
+	 * is recorded (see 'getFeasibility'), so that the feasible
+	 * ones receive their objective function values as fitness
+	 * and only the infeasible ones are visited again to apply
+	 * the penalty.
+	 * The results are numerically identical to calling
+	 * 'calculatePenaltyCoefficients' and then 'calculateFitness'.
+	 * Parameters:
+	 * - fitnessValues: pointer to the fitness values 
+	 * which will by calculated by this method;
+	 * - populationSize: number of candidate solutions
+	 * in the population. This value defines the number
+	 * of elements indicated by the pointers;
+	 * - objectiveFunctionValues: values of the objective
+	 * function obtained by evaluating the candidate solutions;
+	 * - constraintViolationValues: values of the constraint 
+	 * violations obtained by evaluating the candidate violations;
+	 * - penaltyCoefficients: penalty coefficients
+	 * calculated by the adaptive penalty method and which
+	 * are used by the penalty function.
+	 */
+	 void evaluateGeneration( 
+		T* fitnessValues, 
+		Index populationSize, 
+		T* objectiveFunctionValues, 
+		T** constraintViolationValues,
+		T* penaltyCoefficients );
+	 
+	 
+	/*
+	 * Name: calculatePenaltyCoefficients
+	 * Description: Same as the method above, but the 
+	 * constraint violation values are given as a single
+	 * contiguous buffer. The loops follow the order of
+	 * the given layout.
+	 * Parameters:
+	 * - populationSize: number of candidate solutions
+	 * in the population;
+	 * - objectiveFunctionValues: values of the objective
+	 * function obtained by evaluating the candidate solutions;
+	 * - constraintViolationValues: contiguous buffer with the values 
+	 * of the constraint violations of the candidate solutions;
+	 * - layout: the layout of 'constraintViolationValues';
+	 * - leadingDimension: distance, in elements, between the
+	 * beginning of two consecutive rows (ROW_MAJOR) or 
+	 * columns (COLUMN_MAJOR) of 'constraintViolationValues';
+	 * - penaltyCoefficients: penalty coefficients
+	 * calculated by the adaptive penalty method and which
+	 * are used by the penalty function.
+	 */
+	 void calculatePenaltyCoefficients (
+		 Index populationSize,
+		 const T* objectiveFunctionValues,
+		 const T* constraintViolationValues,
+		 ViolationLayout layout,
+		 std::size_t leadingDimension,
+		 T* penaltyCoefficients );
+	 
+	/*
+	 * Name: calculateFitness
+	 * Description: Same as the method above, but the 
+	 * constraint violation values are given as a single
+	 * contiguous buffer ('layout' and 'leadingDimension'
+	 * are described in 'calculatePenaltyCoefficients').
+	 */
+	 void calculateFitness( 
+		T* fitnessValues, 
+		Index populationSize, 
+		const T* objectiveFunctionValues, 
+		const T* constraintViolationValues,
+		ViolationLayout layout,
+		std::size_t leadingDimension,
+		const T* penaltyCoefficients );
+	 
+	/*
+	 * Name: evaluateGeneration
+	 * Description: Same as the method above, but the 
+	 * constraint violation values are given as a single
+	 * contiguous buffer ('layout' and 'leadingDimension'
+	 * are described in 'calculatePenaltyCoefficients').
+	 */
+	 void evaluateGeneration( 
+		T* fitnessValues, 
+		Index populationSize, 
+		const T* objectiveFunctionValues, 
+		const T* constraintViolationValues,
+		ViolationLayout layout,
+		std::size_t leadingDimension,
+		T* penaltyCoefficients );
+
+	/*
+	 * Name: calculatePenaltyCoefficients
+	 * Description: Same as the method above, but only the violated
+	 * constraints of each candidate solution are given, in a compressed
+	 * sparse row (CSR) structure, so the cost is proportional to the
+	 * number of violations instead of 'populationSize * numberOfConstraints'.
+	 * If the constraints of each candidate solution are given in increasing
+	 * order, the results are bitwise identical to the ones of the dense input.
+	 * Parameters:
+	 * - populationSize: number of candidate solutions
+	 * in the population;
+	 * - objectiveFunctionValues: values of the objective
+	 * function obtained by evaluating the candidate solutions;
+	 * - violationOffsets: 'populationSize + 1' values; the violations of
+	 * candidate solution 'i' are at positions 'violationOffsets[ i ]' to
+	 * 'violationOffsets[ i + 1 ] - 1' of the two arrays below;
+	 * - violatedConstraints: the index (from 0 to 'numberOfConstraints - 1')
+	 * of the constraint of each violation;
+	 * - violationValues: the value of each violation; the values which
+	 * are not positive are ignored, as in the dense input;
 	 * - penaltyCoefficients: penalty coefficients
 	 * calculated by the adaptive penalty method and which
 	 * are used by the penalty function.
 	 */
+	 void calculatePenaltyCoefficients (
+		 Index populationSize,
+		 const T* objectiveFunctionValues,
+		 const Index* violationOffsets,
+		 const Index* violatedConstraints,
+		 const T* violationValues,
+		 T* penaltyCoefficients );
+
+	/*
+	 * Name: calculateFitness
+	 * Description: Same as the method above, but the
+	 * constraint violation values are given in a compressed
+	 * sparse row structure ('violationOffsets', 'violatedConstraints'
+	 * and 'violationValues' are described in 'calculatePenaltyCoefficients').
+	 */
+	 void calculateFitness(
+		T* fitnessValues,
+		Index populationSize,
+		const T* objectiveFunctionValues,
+		const Index* violationOffsets,
+		const Index* violatedConstraints,
+		const T* violationValues,
+		const T* penaltyCoefficients );
+
+	/*
+	 * Name: evaluateGeneration
+	 * Description: Same as the method above, but the
+	 * constraint violation values are given in a compressed
+	 * sparse row structure ('violationOffsets', 'violatedConstraints'
+	 * and 'violationValues' are described in 'calculatePenaltyCoefficients').
+	 */
+	 void evaluateGeneration(
+		T* fitnessValues,
+		Index populationSize,
+		const T* objectiveFunctionValues,
+		const Index* violationOffsets,
+		const Index* violatedConstraints,
+		const T* violationValues,
+		T* penaltyCoefficients );
+
+	/*
+	 * Overloads over flat vectors. The population size is the
+	 * number of objective function values and the leading dimension is
+	 * the number of constraints (ROW_MAJOR) or the population size
+	 * (COLUMN_MAJOR). 'penaltyCoefficients' and 'fitnessValues'
+	 * must already have the proper sizes.
+	 */
+	 void calculatePenaltyCoefficients (
+		 const std::vector< T >& objectiveFunctionValues,
+		 const std::vector< T >& constraintViolationValues,
+		 ViolationLayout layout,
+		 std::vector< T >& penaltyCoefficients ) {
+		 this->calculatePenaltyCoefficients( (Index) objectiveFunctionValues.size( ), objectiveFunctionValues.data( ), constraintViolationValues.data( ), 
+			 layout, this->denseLeadingDimension( layout, objectiveFunctionValues.size( ) ), penaltyCoefficients.data( ) );
+	 }
+
+	 void calculateFitness( 
+		std::vector< T >& fitnessValues, 
+		const std::vector< T >& objectiveFunctionValues, 
+		const std::vector< T >& constraintViolationValues,
+		ViolationLayout layout,
+		const std::vector< T >& penaltyCoefficients ) {
+		 this->calculateFitness( fitnessValues.data( ), (Index) objectiveFunctionValues.size( ), objectiveFunctionValues.data( ), constraintViolationValues.data( ),
+			 layout, this->denseLeadingDimension( layout, objectiveFunctionValues.size( ) ), penaltyCoefficients.data( ) );
+	 }
+
+	 void evaluateGeneration( 
+		std::vector< T >& fitnessValues, 
+		const std::vector< T >& objectiveFunctionValues, 
+		const std::vector< T >& constraintViolationValues,
+		ViolationLayout layout,
+		std::vector< T >& penaltyCoefficients ) {
+		 this->evaluateGeneration( fitnessValues.data( ), (Index) objectiveFunctionValues.size( ), objectiveFunctionValues.data( ), constraintViolationValues.data( ),
+			 layout, this->denseLeadingDimension( layout, objectiveFunctionValues.size( ) ), penaltyCoefficients.data( ) );
+	 }
+
+#if __cplusplus >= 202002L
+	/*
+	 * Overloads over spans, available when compiling as C++20.
+	 * Same conventions as the overloads over flat vectors.
+	 */
+	 void calculatePenaltyCoefficients (
+		 std::span< const T > objectiveFunctionValues,
+		 std::span< const T > constraintViolationValues,
+		 ViolationLayout layout,
+		 std::span< T > penaltyCoefficients ) {
+		 this->calculatePenaltyCoefficients( (Index) objectiveFunctionValues.size( ), objectiveFunctionValues.data( ), constraintViolationValues.data( ), 
+			 layout, this->denseLeadingDimension( layout, objectiveFunctionValues.size( ) ), penaltyCoefficients.data( ) );
+	 }
+
+	 void calculateFitness( 
+		std::span< T > fitnessValues, 
+		std::span< const T > objectiveFunctionValues, 
+		std::span< const T > constraintViolationValues,
+		ViolationLayout layout,
+		std::span< const T > penaltyCoefficients ) {
+		 this->calculateFitness( fitnessValues.data( ), (Index) objectiveFunctionValues.size( ), objectiveFunctionValues.data( ), constraintViolationValues.data( ),
+			 layout, this->denseLeadingDimension( layout, objectiveFunctionValues.size( ) ), penaltyCoefficients.data( ) );
+	 }
+
+	 void evaluateGeneration( 
+		std::span< T > fitnessValues, 
+		std::span< const T > objectiveFunctionValues, 
+		std::span< const T > constraintViolationValues,
+		ViolationLayout layout,
+		std::span< T > penaltyCoefficients ) {
+		 this->evaluateGeneration( fitnessValues.data( ), (Index) objectiveFunctionValues.size( ), objectiveFunctionValues.data( ), constraintViolationValues.data( ),
+			 layout, this->denseLeadingDimension( layout, objectiveFunctionValues.size( ) ), penaltyCoefficients.data( ) );
+	 }
+#endif
 	 
-	 double calculateFitness( 
-		double objectiveFunctionValue, 
-		double* constraintViolationValues,
-		double* penaltyCoefficients );
+	/*
+	 * Name: calculateBatchPenaltyCoefficients
+	 * Description: Calculate the penalty coefficients and the averages
+	 * of the objective function values of several populations (e.g. the
+	 * islands of an island model) in a single call. The populations are
+	 * stored one after the other in contiguous buffers and are distributed 
+	 * among the threads (see 'setThreadCount'). The results of each
+	 * population are bitwise identical to the ones of calling 
+	 * 'calculatePenaltyCoefficients' for that population alone.
+	 * Parameters:
+	 * - numberOfPopulations: number of populations;
+	 * - populationOffsets: 'numberOfPopulations + 1' values; population 'p'
+	 * is formed by the candidate solutions 'populationOffsets[ p ]' to
+	 * 'populationOffsets[ p + 1 ] - 1' of the buffers, and must not be empty;
+	 * - objectiveFunctionValues: values of the objective
+	 * function of the candidate solutions of all the populations;
+	 * - constraintViolationValues, layout, leadingDimension: contiguous 
+	 * matrix with the constraint violation values of the candidate solutions 
+	 * of all the populations (see 'calculatePenaltyCoefficients');
+	 * - penaltyCoefficients: 'numberOfPopulations * numberOfConstraints'
+	 * values; the coefficients of population 'p' start at position
+	 * 'p * numberOfConstraints';
+	 * - averageObjectiveFunctionValues: 'numberOfPopulations' values, the 
+	 * averages of the objective function values of the populations.
+	 */
+	 void calculateBatchPenaltyCoefficients( 
+		Index numberOfPopulations, 
+		const Index* populationOffsets,
+		const T* objectiveFunctionValues, 
+		const T* constraintViolationValues,
+		ViolationLayout layout,
+		std::size_t leadingDimension,
+		T* penaltyCoefficients,
+		Accumulator* averageObjectiveFunctionValues );
+
+	/*
+	 * Name: calculatePooledPenaltyCoefficients
+	 * Description: Same as 'calculateBatchPenaltyCoefficients', but the
+	 * sums of all the populations are pooled (added in the order of the
+	 * populations) to calculate a single set of penalty coefficients and 
+	 * a single average, which is kept by the object as when calling 
+	 * 'calculatePenaltyCoefficients'.
+	 * Parameters:
+	 * - penaltyCoefficients: 'numberOfConstraints' values;
+	 * - see 'calculateBatchPenaltyCoefficients' for the others.
+	 */
+	 void calculatePooledPenaltyCoefficients( 
+		Index numberOfPopulations, 
+		const Index* populationOffsets,
+		const T* objectiveFunctionValues, 
+		const T* constraintViolationValues,
+		ViolationLayout layout,
+		std::size_t leadingDimension,
+		T* penaltyCoefficients );
+
+	/*
+	 * Name: calculateBatchFitness
+	 * Description: Calculate the fitness values of several populations in a 
+	 * single call (see 'calculateBatchPenaltyCoefficients').
+	 * Parameters:
+	 * - fitnessValues: the fitness values of the candidate solutions of
+	 * all the populations;
+	 * - penaltyCoefficients, averageObjectiveFunctionValues: the results of 
+	 * 'calculateBatchPenaltyCoefficients'; if 'averageObjectiveFunctionValues'
+	 * is null, 'penaltyCoefficients' and the average kept by the object
+	 * (the results of 'calculatePooledPenaltyCoefficients') are used for
+	 * all the populations;
+	 * - see 'calculateBatchPenaltyCoefficients' for the others.
+	 */
+	 void calculateBatchFitness( 
+		T* fitnessValues,
+		Index numberOfPopulations, 
+		const Index* populationOffsets,
+		const T* objectiveFunctionValues, 
+		const T* constraintViolationValues,
+		ViolationLayout layout,
+		std::size_t leadingDimension,
+		const T* penaltyCoefficients,
+		const Accumulator* averageObjectiveFunctionValues );
 	 
+	/*
+	 * Name: setThreadCount
+	 * Description: Set the number of threads used by the methods 
+	 * which process a population. The population is split into
+	 * reduction blocks which are distributed among the threads
+	 * (see REDUCTION_BLOCK_SIZE); the results are bitwise identical
+	 * for any number of threads. The default is 1.
+	 * Parameters:
+	 * - threadCount: the number of threads; 0 means the number
+	 * of threads supported by the hardware.
+	 */
+	 void setThreadCount( int threadCount );
+
+	/*
+	 * Name: getThreadCount
+	 * Description: Return the number of threads used by the methods 
+	 * which process a population.
+	 */
+	 int getThreadCount( ) const {
+		 return this->threadCount;
+	 }
+
+	/*
+	 * Name: getNumberOfConstraints
+	 * Description: Return the number of constraints of the problem.
+	 */
+	 Index getNumberOfConstraints( ) const {
+		 return this->numberOfConstraints;
+	 }
+
+	/*
+	 * Name: getAverageObjectiveFunctionValues
+	 * Description: Return the average of the objective function values
+	 * of the last population, which is used by 'calculateFitness'.
+	 */
+	 Accumulator getAverageObjectiveFunctionValues( ) const {
+		 return this->averageObjectiveFunctionValues;
+	 }
+
+	/*
+	 * Name: setFeasibilityTracking
+	 * Description: Indicates if 'calculatePenaltyCoefficients' records
+	 * the feasibility of the candidate solutions and the number of
+	 * constraints violated by each one of them (see 'getFeasibility').
+	 * 'evaluateGeneration' always records them. The default is false.
+	 * Parameters:
+	 * - tracking: true to record the feasibility.
+	 */
+	 void setFeasibilityTracking( bool tracking ) {
+		 this->feasibilityTracking = tracking;
+	 }
+
+	/*
+	 * Name: getFeasibilityTracking
+	 * Description: Indicates if 'calculatePenaltyCoefficients' records
+	 * the feasibility of the candidate solutions.
+	 */
+	 bool getFeasibilityTracking( ) const {
+		 return this->feasibilityTracking;
+	 }
+
+	/*
+	 * Name: getFeasibility
+	 * Description: Return the feasibility bitmap of the last population
+	 * given to 'evaluateGeneration' or, when the feasibility is tracked,
+	 * to 'calculatePenaltyCoefficients': bit 'i % 64' of word 'i / 64' is
+	 * 1 if candidate solution 'i' is feasible. The bits after the last
+	 * candidate solution are 0. The bitmap is valid until the next call
+	 * of one of these methods.
+	 */
+	 const std::uint64_t* getFeasibility( ) const {
+		 return this->feasibleCandidates.data( );
+	 }
+
+	/*
+	 * Name: getViolatedConstraints
+	 * Description: Return the number of constraints violated by each
+	 * candidate solution of the population of 'getFeasibility'.
+	 */
+	 const unsigned int* getViolatedConstraints( ) const {
+		 return this->violatedConstraints.data( );
+	 }
+
+	/*
+	 * Name: isFeasible
+	 * Description: Indicates if a candidate solution of the population
+	 * of 'getFeasibility' is feasible.
+	 * Parameters:
+	 * - individual: the index of the candidate solution.
+	 */
+	 bool isFeasible( Index individual ) const {
+		 return ( this->feasibleCandidates[ individual / 64 ] >> ( individual % 64 ) ) & 1;
+	 }
+
+	/*
+	 * Name: calculateFitness
+	 * Description: Same as 'calculateFitness', but the feasibility of the
+	 * candidate solutions is known (e.g. from 'getFeasibility' after
+	 * 'calculatePenaltyCoefficients' with the feasibility tracked): the
+	 * fitness of a feasible candidate solution is a copy of its objective
+	 * function value and only the constraints of the infeasible ones are read.
+	 * Parameters:
+	 * - feasibility: a bitmap as the one of 'getFeasibility';
+	 * - see 'calculateFitness' for the others.
+	 */
+	 void calculateFitness( 
+		T* fitnessValues, 
+		Index populationSize, 
+		T* objectiveFunctionValues, 
+		T** constraintViolationValues,
+		T* penaltyCoefficients,
+		const std::uint64_t* feasibility );
+
+	/*
+	 * Name: calculateFitness
+	 * Description: Same as the method above, but the 
+	 * constraint violation values are given as a single
+	 * contiguous buffer ('layout' and 'leadingDimension'
+	 * are described in 'calculatePenaltyCoefficients').
+	 */
+	 void calculateFitness( 
+		T* fitnessValues, 
+		Index populationSize, 
+		const T* objectiveFunctionValues, 
+		const T* constraintViolationValues,
+		ViolationLayout layout,
+		std::size_t leadingDimension,
+		const T* penaltyCoefficients,
+		const std::uint64_t* feasibility );
+
+	/*
+	 * Name: addIndividual
+	 * Description: Update the penalty coefficients after a candidate 
+	 * solution was inserted in the population, in O(numberOfConstraints).
+	 * The sums over the population are the ones of the last call of 
+	 * 'calculatePenaltyCoefficients' or 'evaluateGeneration' (which 
+	 * calculate them exactly) updated by the following calls of 
+	 * 'addIndividual', 'removeIndividual' and 'replaceIndividual'. 
+	 * The average of the objective function values used by 
+	 * 'calculateFitness' is also updated. The violations are calculated
+	 * with the current kinds and tolerances of the constraints, thus,
+	 * after 'setConstraintKind', 'setEqualityTolerance' or
+	 * 'annealTolerances', the incremental updates throw std::logic_error
+	 * until the sums are calculated again for the whole population.
+	 * The factors of the constraints (see 'setConstraintNormalization')
+	 * are applied to the sums, so they may be changed at any time.
+	 * Parameters:
+	 * - objectiveFunctionValue: value of the objective
+	 * function of the inserted candidate solution;
+	 * - constraintViolationValues: values of the constraint 
+	 * violations of the inserted candidate solution;
+	 * - penaltyCoefficients: penalty coefficients
+	 * recalculated from the updated sums.
+	 */
+	 void addIndividual( 
+		T objectiveFunctionValue, 
+		const T* constraintViolationValues,
+		T* penaltyCoefficients );
+
+	/*
+	 * Name: removeIndividual
+	 * Description: Update the penalty coefficients after a candidate 
+	 * solution was removed from the population (see 'addIndividual').
+	 * The population must not become empty (std::logic_error is thrown
+	 * otherwise).
+	 * Parameters:
+	 * - objectiveFunctionValue: value of the objective
+	 * function of the removed candidate solution;
+	 * - constraintViolationValues: values of the constraint 
+	 * violations of the removed candidate solution;
+	 * - penaltyCoefficients: penalty coefficients
+	 * recalculated from the updated sums.
+	 */
+	 void removeIndividual( 
+		T objectiveFunctionValue, 
+		const T* constraintViolationValues,
+		T* penaltyCoefficients );
+
+	/*
+	 * Name: replaceIndividual
+	 * Description: Update the penalty coefficients after a candidate 
+	 * solution of the population was replaced by another one
+	 * (see 'addIndividual').
+	 * Parameters:
+	 * - oldObjectiveFunctionValue, oldConstraintViolationValues: values
+	 * of the replaced candidate solution;
+	 * - newObjectiveFunctionValue, newConstraintViolationValues: values
+	 * of the new candidate solution;
+	 * - penaltyCoefficients: penalty coefficients
+	 * recalculated from the updated sums.
+	 */
+	 void replaceIndividual( 
+		T oldObjectiveFunctionValue, 
+		const T* oldConstraintViolationValues,
+		T newObjectiveFunctionValue, 
+		const T* newConstraintViolationValues,
+		T* penaltyCoefficients );
+
+	/*
+	 * Name: setResynchronizationInterval
+	 * Description: The sums updated by 'addIndividual', 'removeIndividual'
+	 * and 'replaceIndividual' accumulate rounding errors. After the given 
+	 * number of updates, 'isResynchronizationDue' returns true, indicating
+	 * that the exact sums should be recalculated by calling 
+	 * 'calculatePenaltyCoefficients' or 'evaluateGeneration' for the 
+	 * whole population. The default is 0, which never requests it.
+	 * Parameters:
+	 * - numberOfUpdates: the number of updates between two exact
+	 * calculations of the sums.
+	 */
+	 void setResynchronizationInterval( std::size_t numberOfUpdates ) {
+		 this->resynchronizationInterval = numberOfUpdates;
+	 }
+
+	/*
+	 * Name: isResynchronizationDue
+	 * Description: Indicates if the sums were updated incrementally
+	 * more times than the resynchronization interval or if they must
+	 * be calculated again after a change of the constraints (see
+	 * 'addIndividual').
+	 */
+	 bool isResynchronizationDue( ) const {
+		 if ( this->staleSums ) {
+			 return true;
+		 }
+		 return this->resynchronizationInterval > 0 && this->numberOfUpdates >= this->resynchronizationInterval;
+	 }
+
+	/*
+	 * Name: accumulateChunk
+	 * Description: First phase of the evaluation of a population given
+	 * in chunks (e.g. a population which does not fit in memory): add the
+	 * sums of a chunk of candidate solutions. When all the chunks were
+	 * accumulated, 'finalize' calculates the penalty coefficients and
+	 * 'scoreChunk' calculates the fitness values of each chunk.
+	 * A chunk must start at a multiple of REDUCTION_BLOCK_SIZE and, except
+	 * for the last one, its size must be a multiple of REDUCTION_BLOCK_SIZE.
+	 * std::invalid_argument is thrown, and the chunk is not accumulated,
+	 * if it does not start at a block, if it overlaps an accumulated chunk,
+	 * or if a chunk before it or itself ends inside a block while a chunk
+	 * after it was accumulated. A gap between the chunks, which may still
+	 * be filled, is only detected by 'finalize'. Thus, its blocks are
+	 * the ones of the whole population and the results are the same as
+	 * the ones of 'calculatePenaltyCoefficients' for the whole population.
+	 * The chunks may be accumulated in any order and concurrently by
+	 * several threads.
+	 * Parameters:
+	 * - firstIndividual: position of the first candidate solution of the
+	 * chunk in the population;
+	 * - chunkSize: number of candidate solutions in the chunk;
+	 * - objectiveFunctionValues, constraintViolationValues: values of the
+	 * candidate solutions of the chunk (see 'calculatePenaltyCoefficients').
+	 */
+	 void accumulateChunk( 
+		Index firstIndividual, 
+		Index chunkSize, 
+		T* objectiveFunctionValues, 
+		T** constraintViolationValues );
+
+	/*
+	 * Name: accumulateChunk
+	 * Description: Same as the method above for the constraint violation
+	 * values of the chunk in a contiguous matrix (see 'calculatePenaltyCoefficients';
+	 * 'leadingDimension' concerns the matrix of the chunk).
+	 */
+	 void accumulateChunk( 
+		Index firstIndividual, 
+		Index chunkSize, 
+		const T* objectiveFunctionValues, 
+		const T* constraintViolationValues,
+		ViolationLayout layout,
+		std::size_t leadingDimension );
+
+	/*
+	 * Name: finalize
+	 * Description: Calculate the penalty coefficients and the average
+	 * of the objective function values from the chunks accumulated by
+	 * 'accumulateChunk', which form the population, and start a new
+	 * accumulation. std::logic_error is thrown if no chunk was accumulated
+	 * or if the chunks do not cover a population (the accumulation is
+	 * also restarted in this case).
+	 * Parameters:
+	 * - penaltyCoefficients: penalty coefficients
+	 * calculated by the adaptive penalty method and which
+	 * are used by the penalty function.
+	 */
+	 void finalize( T* penaltyCoefficients );
+
+	/*
+	 * Name: scoreChunk
+	 * Description: Second phase of the evaluation of a population given
+	 * in chunks: calculate the fitness values of a chunk of candidate
+	 * solutions with the penalty coefficients calculated by 'finalize'.
+	 * The chunks may have any size and may be scored concurrently by
+	 * several threads.
+	 * Parameters:
+	 * - fitnessValues: the fitness values of the chunk calculated by this method;
+	 * - chunkSize: number of candidate solutions in the chunk;
+	 * - see 'calculateFitness' for the others.
+	 */
+	 void scoreChunk( 
+		T* fitnessValues, 
+		Index chunkSize, 
+		T* objectiveFunctionValues, 
+		T** constraintViolationValues,
+		T* penaltyCoefficients ) const;
+
+	/*
+	 * Name: scoreChunk
+	 * Description: Same as the method above for the constraint violation
+	 * values of the chunk in a contiguous matrix.
+	 */
+	 void scoreChunk( 
+		T* fitnessValues, 
+		Index chunkSize, 
+		const T* objectiveFunctionValues, 
+		const T* constraintViolationValues,
+		ViolationLayout layout,
+		std::size_t leadingDimension,
+		const T* penaltyCoefficients ) const;
+
+	/*
+	 * Name: calculateLocalSums
+	 * Description: First phase of the evaluation of a population sharded
+	 * across processes (see AdaptivePenaltyMethodMPI.hpp): calculate the
+	 * sums over the shard of the process, which are added to the ones of
+	 * the other shards (e.g. by MPI_Allreduce) and given to
+	 * 'calculatePenaltyCoefficientsFromSums'. Then, each process
+	 * calculates the fitness values of its shard with 'calculateFitness'.
+	 * Parameters:
+	 * - populationSize: the number of candidate solutions of the shard;
+	 * - objectiveFunctionValues, constraintViolationValues: values of the
+	 * candidate solutions of the shard (see 'calculatePenaltyCoefficients');
+	 * - sums: the 'numberOfConstraints + 1' sums calculated by this method,
+	 * the one of the objective function values followed by the ones of
+	 * the violations of each constraint.
+	 */
+	 void calculateLocalSums( 
+		Index populationSize, 
+		T* objectiveFunctionValues, 
+		T** constraintViolationValues,
+		Accumulator* sums );
+
+	/*
+	 * Name: calculateLocalSums
+	 * Description: Same as the method above for the constraint violation
+	 * values in a contiguous matrix.
+	 */
+	 void calculateLocalSums( 
+		Index populationSize, 
+		const T* objectiveFunctionValues, 
+		const T* constraintViolationValues,
+		ViolationLayout layout,
+		std::size_t leadingDimension,
+		Accumulator* sums );
+
+	/*
+	 * Name: calculatePenaltyCoefficientsFromSums
+	 * Description: Calculate the penalty coefficients and the average of
+	 * the objective function values from the sums over a population,
+	 * e.g. the sums of 'calculateLocalSums' added over all the shards.
+	 * Parameters:
+	 * - sums: the sums over the population (see 'calculateLocalSums');
+	 * - populationSize: the number of candidate solutions of the population;
+	 * - penaltyCoefficients: penalty coefficients
+	 * calculated by the adaptive penalty method and which
+	 * are used by the penalty function.
+	 */
+	 void calculatePenaltyCoefficientsFromSums( 
+		const Accumulator* sums, 
+		Index populationSize, 
+		T* penaltyCoefficients );
+
+	/*
+	 * Name: setCoefficientUpdate
+	 * Description: Set how the penalty coefficients owned by the object
+	 * (see 'getPenaltyCoefficients') are updated by 'updatePenaltyCoefficients'
+	 * and by the 'evaluateGeneration' methods without a 'penaltyCoefficients'
+	 * parameter. The coefficients are calculated only every 'interval'
+	 * generations ("sporadic" APM); in the other generations, the pass over
+	 * the population which calculates them is skipped and the coefficients
+	 * and the average of the objective function values of the last update
+	 * are used. The schedule restarts, so the next generation is updated.
+	 * The default is REPLACE_COEFFICIENTS every generation, i.e. the
+	 * original method. std::invalid_argument is thrown if 'interval' is 0
+	 * or if 'smoothingFactor' is not in (0, 1].
+	 * Parameters:
+	 * - update: how the new coefficients are combined with the current ones;
+	 * - interval: the number of generations between two updates;
+	 * - smoothingFactor: the weight of the new coefficients for
+	 * SMOOTH_COEFFICIENTS.
+	 */
+	 void setCoefficientUpdate( 
+		CoefficientUpdate update, 
+		std::size_t interval = 1, 
+		T smoothingFactor = (T) 0.5 );
+
+	/*
+	 * Name: getPenaltyCoefficients
+	 * Description: Return the penalty coefficients owned by the object
+	 * (all 0 before the first update).
+	 */
+	 const T* getPenaltyCoefficients( ) const {
+		 return this->coefficients.data( );
+	 }
+
+	/*
+	 * Name: isCoefficientUpdateDue
+	 * Description: Indicates if the next generation updates the penalty
+	 * coefficients owned by the object.
+	 */
+	 bool isCoefficientUpdateDue( ) const {
+		 return this->generation % this->updateInterval == 0;
+	 }
+
+	/*
+	 * Name: updatePenaltyCoefficients
+	 * Description: Count a generation and, if an update is due (see
+	 * 'setCoefficientUpdate'), update the penalty coefficients owned by
+	 * the object (see 'getPenaltyCoefficients') with the population.
+	 * Return true if they were updated.
+	 * Parameters:
+	 * - see 'calculatePenaltyCoefficients'.
+	 */
+	 bool updatePenaltyCoefficients( 
+		Index populationSize, 
+		T* objectiveFunctionValues, 
+		T** constraintViolationValues );
+
+	/*
+	 * Name: updatePenaltyCoefficients
+	 * Description: Same as the method above for the constraint violation
+	 * values in a contiguous matrix.
+	 */
+	 bool updatePenaltyCoefficients( 
+		Index populationSize, 
+		const T* objectiveFunctionValues, 
+		const T* constraintViolationValues,
+		ViolationLayout layout,
+		std::size_t leadingDimension );
+
+	/*
+	 * Name: evaluateGeneration
+	 * Description: Count a generation, update the penalty coefficients
+	 * owned by the object if an update is due (see 'setCoefficientUpdate')
+	 * and calculate the fitness values of the population with them. When
+	 * the coefficients are replaced every generation, the results are the
+	 * ones of the method with a 'penaltyCoefficients' parameter.
+	 * Parameters:
+	 * - see 'evaluateGeneration'.
+	 */
+	 void evaluateGeneration( 
+		T* fitnessValues, 
+		Index populationSize, 
+		T* objectiveFunctionValues, 
+		T** constraintViolationValues );
+
+	/*
+	 * Name: evaluateGeneration
+	 * Description: Same as the method above for the constraint violation
+	 * values in a contiguous matrix.
+	 */
+	 void evaluateGeneration( 
+		T* fitnessValues, 
+		Index populationSize, 
+		const T* objectiveFunctionValues, 
+		const T* constraintViolationValues,
+		ViolationLayout layout,
+		std::size_t leadingDimension );
+
+	/*
+	 * Name: setConstraintNormalization
+	 * Description: Set the factor of a constraint, by which its
+	 * violations are multiplied (e.g. the inverse of their typical
+	 * magnitude) so that the constraints of different scales have
+	 * comparable weights. The factors are applied to the sums when the
+	 * penalty coefficients are calculated, thus the violations are read
+	 * as given; the coefficients are the ones of the normalized
+	 * violations multiplied by the factors, so they are used with the
+	 * violations as given (e.g. by 'calculateFitness'). The results are
+	 * the ones of normalizing the violations before the method, up to
+	 * the rounding. std::invalid_argument is thrown if the constraint
+	 * does not exist or if the factor is not positive. The factors of
+	 * all the constraints are 1 initially.
+	 * Parameters:
+	 * - constraint: the index of the constraint;
+	 * - factor: the factor of the violations of the constraint.
+	 */
+	 void setConstraintNormalization( 
+		Index constraint, 
+		T factor );
+
+	/*
+	 * Name: getConstraintNormalization
+	 * Description: Return the factor of a constraint (see
+	 * 'setConstraintNormalization'), which is calculated from the
+	 * violations of the previous populations if the normalization
+	 * is adaptive (see 'setAdaptiveNormalization').
+	 */
+	 T getConstraintNormalization( Index constraint ) const {
+		 return this->normalizationFactors.empty( )? (T) 1: (T) this->normalizationFactors[ constraint ];
+	 }
+
+	/*
+	 * Name: setAdaptiveNormalization
+	 * Description: Enable or disable the adaptive normalization. When
+	 * it is enabled, each time the penalty coefficients of a whole
+	 * population are calculated, the factor of each constraint (see
+	 * 'setConstraintNormalization') becomes the inverse of the running
+	 * maximum of the average violation of the constraint, kept between
+	 * the generations:
+	 * 'maximum = max( decay * maximum, sumViolation / populationSize )'.
+	 * Thus, the maximum decays once per generation: the incremental
+	 * updates (see 'addIndividual') keep the factors of the last
+	 * population.
+	 * A constraint not violated yet keeps its factor. Enabling the
+	 * adaptive normalization restarts the running maxima; disabling it 
+	 * keeps the last factors. std::invalid_argument is thrown if the
+	 * decay is not in [0, 1].
+	 * Parameters:
+	 * - enabled: true to enable the adaptive normalization;
+	 * - decay: the factor of the previous maximum at each population
+	 * (1 keeps the maximum of all the generations and 0 uses only the
+	 * current one).
+	 */
+	 void setAdaptiveNormalization( 
+		bool enabled, 
+		T decay = 1 );
+
+	/*
+	 * Name: resetNormalization
+	 * Description: Remove the factors of the constraints (see
+	 * 'setConstraintNormalization') and disable the adaptive normalization.
+	 */
+	 void resetNormalization( );
+
+	/*
+	 * Name: setSummationPolicy
+	 * Description: Set how the sums over the populations are calculated
+	 * (see SummationPolicy) by the methods which calculate the penalty
+	 * coefficients of whole populations, including the chunks and the
+	 * batches. The incremental updates always add their terms in order.
+	 * The results of every policy still do not depend on the number of
+	 * threads. The default policy is NAIVE_SUMMATION.
+	 */
+	 void setSummationPolicy( SummationPolicy policy ) {
+		 this->summationPolicy = policy;
+	 }
+
+	 SummationPolicy getSummationPolicy( ) const {
+		 return this->summationPolicy;
+	 }
+
+	/*
+	 * Name: setConstraintKind
+	 * Description: Set the kind of a constraint (see ConstraintKind). All
+	 * the constraints are inequalities by default. The violations of the
+	 * equality constraints are calculated from the values given to the
+	 * other methods while they are read, so the values 'h(x)' are given
+	 * directly, in the place of the violations. std::invalid_argument is
+	 * thrown if the constraint does not exist or if 'tolerance' is negative.
+	 * Parameters:
+	 * - constraint: the index of the constraint;
+	 * - kind: the kind of the constraint;
+	 * - tolerance: the tolerance of an equality constraint (ignored
+	 * for an inequality constraint, whose tolerance is 0).
+	 */
+	 void setConstraintKind( 
+		Index constraint, 
+		ConstraintKind kind, 
+		T tolerance = 0 );
+
+	/*
+	 * Name: getConstraintKind
+	 * Description: Return the kind of a constraint.
+	 */
+	 ConstraintKind getConstraintKind( Index constraint ) const {
+		 return !this->constraintScales.empty( ) && this->constraintScales[ constraint ] != 0? EQUALITY_CONSTRAINT: INEQUALITY_CONSTRAINT;
+	 }
+
+	/*
+	 * Name: getTolerance
+	 * Description: Return the tolerance of a constraint (0 for an
+	 * inequality constraint).
+	 */
+	 T getTolerance( Index constraint ) const {
+		 return this->tolerances.empty( )? (T) 0: this->tolerances[ constraint ];
+	 }
+
+	/*
+	 * Name: setEqualityTolerance
+	 * Description: Set the tolerance of all the equality constraints.
+	 * std::invalid_argument is thrown if 'tolerance' is negative.
+	 */
+	 void setEqualityTolerance( T tolerance );
+
+	/*
+	 * Name: annealTolerances
+	 * Description: Multiply the tolerances of the equality constraints by
+	 * 'factor', without going below 'minimumTolerance'; a tolerance which
+	 * is already below 'minimumTolerance' is kept, so the annealing never
+	 * loosens a constraint. Called once per generation, it makes the
+	 * equality constraints stricter as the search progresses.
+	 * std::invalid_argument is thrown if 'factor' is not in [0, 1] or if
+	 * 'minimumTolerance' is negative.
+	 */
+	 void annealTolerances( 
+		T factor, 
+		T minimumTolerance = 0 );
+
+	/*
+	 * Name: getCoefficientVersion
+	 * Description: Return the version of the penalty coefficients and of
+	 * the average of the objective function values, which changes every
+	 * time they are calculated (also by the incremental updates and by
+	 * the updates of the coefficients owned by the object) and when the
+	 * kinds of the constraints change.
+	 */
+	 std::uint64_t getCoefficientVersion( ) const {
+		 return this->coefficientVersion;
+	 }
+
+	/*
+	 * Name: makeSnapshot
+	 * Description: Return a snapshot of the penalty coefficients, of the
+	 * average of the objective function values and of the kinds of the
+	 * constraints (see CoefficientSnapshot), whose version is the current
+	 * one. The snapshot is allocated from the memory resource of the object.
+	 * Parameters:
+	 * - penaltyCoefficients: the penalty coefficients of the current
+	 * version, i.e. the ones calculated last.
+	 */
+	 std::shared_ptr< const CoefficientSnapshot< T, Accumulator > > makeSnapshot( const T* penaltyCoefficients ) const;
+
+	/*
+	 * Name: makeSnapshot
+	 * Description: Same as the method above for the penalty coefficients
+	 * owned by the object (see 'getPenaltyCoefficients').
+	 */
+	 std::shared_ptr< const CoefficientSnapshot< T, Accumulator > > makeSnapshot( ) const {
+		 return this->makeSnapshot( this->coefficients.data( ) );
+	 }
+
+	/*
+	 * Name: setSelectionSize
+	 * Description: Set the number of candidate solutions with the smallest
+	 * fitness values (e.g. the elite of a genetic algorithm) which are
+	 * selected while the fitness values of a population are calculated,
+	 * so the fitness values do not need to be read again nor sorted (see
+	 * 'getBestIndividuals'). Each reduction block keeps its best candidate
+	 * solutions in a heap, in parallel, and the best of them are then
+	 * sorted; the cost is small when 'selectionSize' is much smaller than
+	 * the population. The ties are broken by the indices, so the selection
+	 * does not depend on the number of threads, and the NaN fitness values
+	 * are the worst ones. 0 (the default) disables the selection.
+	 * 'scoreChunk' and the batches do not select.
+	 * std::invalid_argument is thrown if 'selectionSize' is negative.
+	 */
+	 void setSelectionSize( Index selectionSize );
+
+	/*
+	 * Name: getSelectionSize
+	 * Description: Return the number of candidate solutions selected
+	 * with the fitness values.
+	 */
+	 Index getSelectionSize( ) const {
+		 return this->selectionSize;
+	 }
+
+	/*
+	 * Name: getBestIndividuals
+	 * Description: Return the indices of the candidate solutions selected
+	 * the last time the fitness values of a population were calculated,
+	 * from the smallest fitness value (see 'getNumberOfBestIndividuals').
+	 */
+	 const Index* getBestIndividuals( ) const {
+		 return this->bestIndividuals.data( );
+	 }
+
+	/*
+	 * Name: getNumberOfBestIndividuals
+	 * Description: Return the number of candidate solutions selected the
+	 * last time, i.e. the smallest of 'getSelectionSize' and the size of
+	 * the population.
+	 */
+	 Index getNumberOfBestIndividuals( ) const {
+		 return (Index) this->bestIndividuals.size( );
+	 }
 		
 	private:
-		double* sumViolation;
-		int numberOfConstraints;
-		double averageObjectiveFunctionValues;
+		typedef typename std::conditional< Instrumented, GenerationStatistics< Accumulator, Index >, detail::NoStatistics >::type Statistics;
+
+		/*
+		 * Leading dimension of a dense matrix with the given layout.
+		 */
+		std::size_t denseLeadingDimension( ViolationLayout layout, std::size_t populationSize ) const {
+			return layout == ROW_MAJOR ? (std::size_t) this->numberOfConstraints : populationSize;
+		}
+
+		/*
+		 * Kinds of the constraints given to the kernels.
+		 */
+		kernels::ConstraintKinds< T > constraintKinds( ) const {
+			//the kernels for inequalities only are selected by a null 'scales'
+			const kernels::ConstraintKinds< T > kinds = {
+				this->constraintScales.empty( )? 0: this->constraintScales.data( ),
+				this->tolerances.empty( )? 0: this->tolerances.data( ) };
+			return kinds;
+		}
+
+		/*
+		 * Calculate the average of the objective function values and
+		 * the penalty coefficients from the sums accumulated in 'sumViolation'.
+		 * The sum of the objective function values and the population size
+		 * are kept for the incremental updates.
+		 */
+		void finishPenaltyCoefficients( 
+			Accumulator sumObjectiveFunction, 
+			Index populationSize, 
+			T* penaltyCoefficients );
+
+		/*
+		 * Forbid the incremental updates until the sums are calculated
+		 * again: a candidate solution of the population would be removed
+		 * with violations which are not the ones that were added.
+		 */
+		void invalidateSums( ) {
+			if ( this->populationSize > 0 ) {
+				this->staleSums = true;
+			}
+		}
+		
+
+		/*
+		 * Accumulate the sums of the objective function and of the
+		 * constraint violation values (into 'sumViolation') block by block.
+		 * If 'recordFeasibility' is true, the feasibility of the candidate
+		 * solutions and their numbers of violated constraints are recorded.
+		 */
+		template< typename Violations >
+		Accumulator accumulate( 
+			Index populationSize, 
+			const T* objectiveFunctionValues, 
+			const Violations& constraintViolationValues,
+			bool recordFeasibility );
+
+		/*
+		 * Calculate the sums of each population of a batch into 'partialSums'
+		 * and, if 'penaltyCoefficients' is not null, the penalty coefficients
+		 * and the averages of the populations. Return the sums.
+		 */
+		const Accumulator* accumulateBatch( 
+			Index numberOfPopulations, 
+			const Index* populationOffsets,
+			const T* objectiveFunctionValues, 
+			const T* constraintViolationValues,
+			ViolationLayout layout,
+			std::size_t leadingDimension,
+			T* penaltyCoefficients,
+			Accumulator* averageObjectiveFunctionValues );
+
+		/*
+		 * Calculate the partial sums of the blocks of a chunk and store them
+		 * with the ones of the other chunks (see 'accumulateChunk').
+		 */
+		template< typename Violations >
+		void accumulateChunkOf( 
+			Index firstIndividual, 
+			Index chunkSize, 
+			const T* objectiveFunctionValues, 
+			const Violations& constraintViolationValues );
+
+		/*
+		 * Calculate the sums over a shard (see 'calculateLocalSums').
+		 */
+		template< typename Violations >
+		void calculateLocalSumsOf( 
+			Index populationSize, 
+			const T* objectiveFunctionValues, 
+			const Violations& constraintViolationValues,
+			Accumulator* sums );
+
+		/*
+		 * Count a generation and, if an update is due, calculate the
+		 * penalty coefficients of the population and combine them with
+		 * the ones owned by the object. Return true if they were updated.
+		 */
+		template< typename Violations >
+		bool updateCoefficients( 
+			Index populationSize, 
+			const T* objectiveFunctionValues, 
+			const Violations& constraintViolationValues,
+			bool recordFeasibility );
+
+		/*
+		 * Add ('sign' = 1) or subtract ('sign' = -1) the values of a candidate 
+		 * solution to the sums kept for the incremental updates.
+		 */
+		void updateSums( 
+			int sign, 
+			T objectiveFunctionValue, 
+			const T* constraintViolationValues );
+
+		/*
+		 * Calculate the fitness values of all the candidate solutions or,
+		 * if 'feasibility' is not null, only of the infeasible ones. If
+		 * 'statistics' is not null, the statistics of the penalties are
+		 * recorded in it. If 'bestIndividuals' is not null, the best
+		 * candidate solutions (see 'setSelectionSize') are stored in it.
+		 */
+		template< typename Violations >
+		void penalize( 
+			T* fitnessValues, 
+			Index populationSize, 
+			const T* objectiveFunctionValues, 
+			const Violations& constraintViolationValues,
+			const T* penaltyCoefficients,
+			const std::uint64_t* feasibility,
+			Statistics* statistics,
+			detail::Buffer< Index >* bestIndividuals ) const;
+
+		typename detail::ConstraintSums< Accumulator, Constraints >::Type sumViolation;
+		Index numberOfConstraints;
+		Accumulator averageObjectiveFunctionValues;
+		int threadCount;
+		//sums kept for the incremental updates
+		Accumulator sumObjectiveFunction;
+		Index populationSize;
+		std::size_t numberOfUpdates;
+		std::size_t resynchronizationInterval;
+		//true if the kinds or the tolerances of the constraints changed after the sums were calculated
+		bool staleSums;
+		//partial sums of the reduction blocks: the objective function followed by the constraints
+		detail::Buffer< Accumulator > partialSums;
+		//feasibility of the last population (see 'getFeasibility')
+		bool feasibilityTracking;
+		detail::Buffer< unsigned int > violatedConstraints;
+		detail::Buffer< std::uint64_t > feasibleCandidates;
+		//partial sums and sizes of the blocks of the chunks accumulated by 'accumulateChunk'
+		detail::Buffer< Accumulator > chunkSums;
+		detail::Buffer< Index > chunkBlockSizes;
+		detail::CopyableMutex chunkMutex;
+		//penalty coefficients owned by the object and their update schedule
+		detail::Buffer< T > coefficients;
+		detail::Buffer< T > newCoefficients;
+		CoefficientUpdate coefficientUpdate;
+		std::size_t updateInterval;
+		T smoothingFactor;
+		std::size_t generation;
+		std::size_t coefficientUpdates;
+		//statistics of the instrumented classes and, for each block in
+		//parallel, its numbers of feasible candidate solutions and of violations
+		Statistics statistics;
+		detail::Buffer< Index > blockCounts;
+		//kinds of the constraints: -1 (equality) or 0 (inequality) and the
+		//tolerances, both empty if all the constraints are inequalities
+		detail::Buffer< T > constraintScales;
+		detail::Buffer< T > tolerances;
+		//the best candidate solutions of the last population (see 'setSelectionSize')
+		Index selectionSize;
+		detail::Buffer< Index > bestIndividuals;
+		//version of the coefficients (see 'getCoefficientVersion')
+		std::uint64_t coefficientVersion;
+		SummationPolicy summationPolicy;
+		//factors of the violations of the constraints, empty if all of them are 1,
+		//and the running maxima of the average violations (see 'setAdaptiveNormalization')
+		detail::Buffer< Accumulator > normalizationFactors;
+		detail::Buffer< Accumulator > violationMaxima;
+		bool adaptiveNormalization;
+		T normalizationDecay;
 		
 	};
 
+/*
+ * The class with 'double' values.
+ */
+typedef BasicAdaptivePenaltyMethod< double > AdaptivePenaltyMethod;
+
+/*
+ * The class with 'double' values which collects statistics (see
+ * BasicAdaptivePenaltyMethod::getStatistics).
+ */
+typedef BasicAdaptivePenaltyMethod< double, double, int, 0, true > InstrumentedAdaptivePenaltyMethod;
+
+/*
+ * The class for a number of constraints 'M' known at compile time.
+ * The sums of the constraint violations are kept inside the object and
+ * the loops over the constraints of each candidate solution are fully
+ * unrolled. It is defined in "AdaptivePenaltyMethodImpl.hpp", which
+ * must be included to use it, e.g.:
+ * apm::FixedAdaptivePenaltyMethod< 8 > method( 8 );
+ */
+template< int M, typename T = double, typename Accumulator = T >
+using FixedAdaptivePenaltyMethod = BasicAdaptivePenaltyMethod< T, Accumulator, int, M >;
+
+#ifndef APM_HEADER_ONLY
+/*
+ * Instantiations compiled in AdaptivePenaltyMethod.cpp.
+ */
+extern template class CoefficientSnapshot< float >;
+extern template class CoefficientSnapshot< double >;
+extern template class CoefficientSnapshot< long double >;
+extern template class CoefficientSnapshot< float, double >;
+extern template class BasicAdaptivePenaltyMethod< float >;
+extern template class BasicAdaptivePenaltyMethod< double >;
+extern template class BasicAdaptivePenaltyMethod< long double >;
+extern template class BasicAdaptivePenaltyMethod< float, double >;
+extern template class BasicAdaptivePenaltyMethod< double, double, int, 0, true >;
+#endif
+
 
 
 
 }
 
+/*
+ * In the header-only mode, the definitions of the methods are included,
+ * so any combination of types is instantiated (and inlined) where it is used.
+ */
+#ifdef APM_HEADER_ONLY
+#include "AdaptivePenaltyMethodImpl.hpp"
+#endif
+
 
 #endif	/* F503ADAPTIVEPENALTYMETHOD_HPP */
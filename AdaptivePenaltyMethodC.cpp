@@ -0,0 +1,279 @@
+/*
+ * File:   AdaptivePenaltyMethodC.cpp
+ * Author: Heder Soares Bernardino
+ *
+ * Functions of the shared core of the C interface (see apm.h), which
+ * call the AdaptivePenaltyMethod class, so the C and C++ implementations
+ * share the blocked reductions, the threads and the SIMD kernels.
+ * No exception crosses the C interface: the failures are returned
+ * as the codes of APMStatus (see 'statusOfException').
+ *
+ * Compilation:
+ * Use the following command to compile this code:
+ * g++ -c -pthread AdaptivePenaltyMethodC.cpp
+ * This will generate a 'AdaptivePenaltyMethodC.o' object file, which
+ * must be linked together with the object files of the
+ * AdaptivePenaltyMethod class.
+ */
+
+/*
+ * Includes.
+ */
+#include <new>
+#include <stdexcept>
+
+#include "apm.h"
+#include "AdaptivePenaltyMethod.hpp"
+
+static_assert( (int) APM_ROW_MAJOR == (int) apm::ROW_MAJOR && (int) APM_COLUMN_MAJOR == (int) apm::COLUMN_MAJOR,
+	"the layouts of the C interface must be the ones of the class" );
+
+/*
+ * Return the code of the exception being handled: the failures to
+ * allocate memory, the invalid arguments (std::logic_error and the
+ * classes derived from it) and any other failure, e.g. of the creation
+ * of the threads. It must only be called from a 'catch' block.
+ */
+static int statusOfException( ) {
+
+	try {
+		throw;
+	} catch( const std::bad_alloc& ) {
+		return APM_OUT_OF_MEMORY;
+	} catch( const std::logic_error& ) {
+		return APM_INVALID_ARGUMENT;
+	} catch( ... ) {
+		return APM_FAILURE;
+	}
+
+}
+
+/*
+ * An object of the shared core.
+ */
+struct APMMethod {
+	apm::AdaptivePenaltyMethod method;
+
+	APMMethod( int numberOfConstraints ):
+		method( numberOfConstraints ) {
+	}
+};
+
+/*
+ * Check the size of a population and, for a contiguous matrix, that
+ * its leading dimension covers a row (APM_ROW_MAJOR) or a column
+ * (APM_COLUMN_MAJOR) of the matrix.
+ */
+static bool isValid( const APMMethod* method, int populationSize, APMLayout layout, size_t leadingDimension ) {
+
+	if ( populationSize < 0 ) {
+		return false;
+	}
+	if ( layout == APM_ROW_MAJOR ) {
+		return leadingDimension >= (size_t) method->method.getNumberOfConstraints( );
+	}
+	return layout == APM_COLUMN_MAJOR && leadingDimension >= (size_t) populationSize;
+
+}
+
+extern "C" {
+
+	/*
+	 * Function to create an object of the shared core.
+	 */
+	APMMethod* createMethod(
+		int numberOfConstraints ) {
+
+		if ( numberOfConstraints < 0 ) {
+			return 0;
+		}
+		//the constructor allocates the buffers of the object, which may also fail
+		try {
+			return new APMMethod( numberOfConstraints );
+		} catch( ... ) {
+			return 0;
+		}
+
+	}
+
+	/*
+	 * Function to release an object of the shared core.
+	 */
+	void destroyMethod(
+		APMMethod* method ) {
+
+		delete method;
+
+	}
+
+	/*
+	 * Function to set the number of threads of an object.
+	 */
+	void setMethodThreads(
+		APMMethod* method,
+		int numberOfThreads ) {
+
+		method->method.setThreadCount( numberOfThreads );
+
+	}
+
+	/*
+	 * Function to return the average of the objective function values of the last population.
+	 */
+	double getMethodAverageObjectiveFunctionValues(
+		const APMMethod* method ) {
+
+		return method->method.getAverageObjectiveFunctionValues( );
+
+	}
+
+	/*
+	 * Function to calculate the penalty coefficients.
+	 */
+	int calculatePenaltyCoefficientsWithMethod(
+		APMMethod* method,
+		int populationSize,
+		double* objectiveFunctionValues,
+		double** constraintViolationValues,
+		double* penaltyCoefficients ) {
+
+		if ( populationSize < 0 ) {
+			return APM_INVALID_ARGUMENT;
+		}
+		try {
+			method->method.calculatePenaltyCoefficients( populationSize, objectiveFunctionValues, constraintViolationValues,
+				penaltyCoefficients );
+		} catch( ... ) {
+			return statusOfException( );
+		}
+		return APM_SUCCESS;
+
+	}
+
+	/*
+	 * Function to calculate the penalty coefficients from a contiguous matrix.
+	 */
+	int calculatePenaltyCoefficientsContiguous(
+		APMMethod* method,
+		int populationSize,
+		const double* objectiveFunctionValues,
+		const double* constraintViolationValues,
+		APMLayout layout,
+		size_t leadingDimension,
+		double* penaltyCoefficients ) {
+
+		if ( !isValid( method, populationSize, layout, leadingDimension ) ) {
+			return APM_INVALID_ARGUMENT;
+		}
+		try {
+			method->method.calculatePenaltyCoefficients( populationSize, objectiveFunctionValues, constraintViolationValues,
+				(apm::ViolationLayout) layout, leadingDimension, penaltyCoefficients );
+		} catch( ... ) {
+			return statusOfException( );
+		}
+		return APM_SUCCESS;
+
+	}
+
+	/*
+	 * Function to calculate the fitness values of the candidate solutions.
+	 */
+	int calculateAllFitnessWithMethod(
+		const APMMethod* method,
+		double* fitnessValues,
+		int populationSize,
+		double* objectiveFunctionValues,
+		double** constraintViolationValues,
+		double* penaltyCoefficients ) {
+
+		//the fitness values do not change the object
+		if ( populationSize < 0 ) {
+			return APM_INVALID_ARGUMENT;
+		}
+		try {
+			method->method.scoreChunk( fitnessValues, populationSize, objectiveFunctionValues, constraintViolationValues,
+				penaltyCoefficients );
+		} catch( ... ) {
+			return statusOfException( );
+		}
+		return APM_SUCCESS;
+
+	}
+
+	/*
+	 * Function to calculate the fitness values of the candidate solutions from a contiguous matrix.
+	 */
+	int calculateAllFitnessContiguous(
+		const APMMethod* method,
+		double* fitnessValues,
+		int populationSize,
+		const double* objectiveFunctionValues,
+		const double* constraintViolationValues,
+		APMLayout layout,
+		size_t leadingDimension,
+		const double* penaltyCoefficients ) {
+
+		if ( !isValid( method, populationSize, layout, leadingDimension ) ) {
+			return APM_INVALID_ARGUMENT;
+		}
+		try {
+			method->method.scoreChunk( fitnessValues, populationSize, objectiveFunctionValues, constraintViolationValues,
+				(apm::ViolationLayout) layout, leadingDimension, penaltyCoefficients );
+		} catch( ... ) {
+			return statusOfException( );
+		}
+		return APM_SUCCESS;
+
+	}
+
+	/*
+	 * Function to calculate the penalty coefficients and the fitness values.
+	 */
+	int evaluateGenerationWithMethod(
+		APMMethod* method,
+		double* fitnessValues,
+		int populationSize,
+		double* objectiveFunctionValues,
+		double** constraintViolationValues,
+		double* penaltyCoefficients ) {
+
+		if ( populationSize < 0 ) {
+			return APM_INVALID_ARGUMENT;
+		}
+		try {
+			method->method.evaluateGeneration( fitnessValues, populationSize, objectiveFunctionValues, constraintViolationValues,
+				penaltyCoefficients );
+		} catch( ... ) {
+			return statusOfException( );
+		}
+		return APM_SUCCESS;
+
+	}
+
+	/*
+	 * Function to calculate the penalty coefficients and the fitness values from a contiguous matrix.
+	 */
+	int evaluateGenerationContiguous(
+		APMMethod* method,
+		double* fitnessValues,
+		int populationSize,
+		const double* objectiveFunctionValues,
+		const double* constraintViolationValues,
+		APMLayout layout,
+		size_t leadingDimension,
+		double* penaltyCoefficients ) {
+
+		if ( !isValid( method, populationSize, layout, leadingDimension ) ) {
+			return APM_INVALID_ARGUMENT;
+		}
+		try {
+			method->method.evaluateGeneration( fitnessValues, populationSize, objectiveFunctionValues, constraintViolationValues,
+				(apm::ViolationLayout) layout, leadingDimension, penaltyCoefficients );
+		} catch( ... ) {
+			return statusOfException( );
+		}
+		return APM_SUCCESS;
+
+	}
+
+}
@@ -0,0 +1,372 @@
+/*
+ * File:   AdaptivePenaltyMethodDevice.cu
+ * Author: Heder Soares Bernardino
+ *
+ * Implementation for GPUs (CUDA or HIP) of the Adaptive Penalty Method.
+ * Please, read AdaptivePenaltyMethodDevice.hpp file for more information.
+ *
+ * Compilation:
+ * Use one of the following commands to compile this code:
+ * nvcc -c -fmad=false AdaptivePenaltyMethodDevice.cu
+ * hipcc -c -ffp-contract=off -x hip AdaptivePenaltyMethodDevice.cu
+ */
+
+/*
+ * Includes.
+ */
+#include <stdexcept>
+#include <string>
+
+#if defined( __HIPCC__ )
+#include <hip/hip_runtime.h>
+#define APM_DEVICE( name ) hip##name
+typedef hipStream_t DeviceStream;
+typedef hipError_t DeviceError;
+#else
+#include <cuda_runtime.h>
+#define APM_DEVICE( name ) cuda##name
+typedef cudaStream_t DeviceStream;
+typedef cudaError_t DeviceError;
+#endif
+
+#include "AdaptivePenaltyMethodDevice.hpp"
+
+
+namespace apm {
+
+namespace device {
+
+	/*
+	 * Number of threads of the blocks of the kernels.
+	 */
+	const int THREADS = 256;
+
+	/*
+	 * Largest number of blocks of the second dimension of a grid.
+	 */
+	const int MAXIMUM_COLUMNS = 65535;
+
+	/*
+	 * Throw the error of the runtime, if any.
+	 */
+	void check( DeviceError error, const char* operation ) {
+		if ( error != APM_DEVICE( Success ) ) {
+			throw std::runtime_error( std::string( operation ) + ": " + APM_DEVICE( GetErrorString )( error ) );
+		}
+	}
+
+	/*
+	 * Reduction of a chunk of candidate solutions: block ( chunk, column )
+	 * sums the column of the chunk into 'partialSums'. Column 0 is the
+	 * objective function and column 'l + 1' is the constraint 'l'. Each
+	 * thread adds the candidate solutions 'THREADS' apart and the sums of
+	 * the threads are added by a tree of fixed shape.
+	 */
+	template< typename T, typename Accumulator >
+	__global__ void accumulateChunks(
+		int populationSize,
+		int numberOfConstraints,
+		const T* objectiveFunctionValues,
+		const T* constraintViolationValues,
+		std::size_t individualStride,
+		std::size_t constraintStride,
+		Accumulator* partialSums ) {
+
+		__shared__ Accumulator threadSums[ THREADS ];
+		const int begin = blockIdx.x * DEVICE_CHUNK_SIZE;
+		const int end = populationSize - begin < DEVICE_CHUNK_SIZE? populationSize: begin + DEVICE_CHUNK_SIZE;
+
+		for( int column=blockIdx.y; column <= numberOfConstraints; column += gridDim.y ) {
+
+			Accumulator sum = 0;
+			for( int i=begin + threadIdx.x; i < end; i += THREADS ) {
+				if ( column == 0 ) {
+					sum += (Accumulator) objectiveFunctionValues[ i ];
+				} else {
+					const T violation = constraintViolationValues[ i * individualStride + ( column - 1 ) * constraintStride ];
+					sum += violation > 0? (Accumulator) violation: (Accumulator) 0;
+				}
+			}
+			threadSums[ threadIdx.x ] = sum;
+			__syncthreads( );
+
+			for( int half=THREADS / 2; half > 0; half /= 2 ) {
+				if ( threadIdx.x < half ) {
+					threadSums[ threadIdx.x ] += threadSums[ threadIdx.x + half ];
+				}
+				__syncthreads( );
+			}
+			if ( threadIdx.x == 0 ) {
+				partialSums[ (std::size_t) blockIdx.x * ( numberOfConstraints + 1 ) + column ] = threadSums[ 0 ];
+			}
+			__syncthreads( );
+
+		}
+
+	}
+
+	/*
+	 * Addition of the partial sums of the chunks, in their order, and
+	 * calculation of the average of the objective function values and
+	 * of the penalty coefficients (a single block).
+	 */
+	template< typename T, typename Accumulator >
+	__global__ void finishPenaltyCoefficients(
+		int populationSize,
+		int numberOfConstraints,
+		int numberOfChunks,
+		const Accumulator* partialSums,
+		Accumulator* sums,
+		Accumulator* averageObjectiveFunctionValues,
+		T* penaltyCoefficients ) {
+
+		__shared__ Accumulator sumObjectiveFunction;
+		__shared__ Accumulator denominator;
+
+		for( int column=threadIdx.x; column <= numberOfConstraints; column += blockDim.x ) {
+
+			Accumulator sum = 0;
+			for( int chunk=0; chunk < numberOfChunks; chunk++ ) {
+				sum += partialSums[ (std::size_t) chunk * ( numberOfConstraints + 1 ) + column ];
+			}
+			sums[ column ] = sum;
+
+		}
+		__syncthreads( );
+
+		if ( threadIdx.x == 0 ) {
+
+			//the absolute of the sumObjectiveFunction
+			sumObjectiveFunction = sums[ 0 ] < 0? -sums[ 0 ]: sums[ 0 ];
+			//average of the objective function values
+			*averageObjectiveFunctionValues = sumObjectiveFunction / populationSize;
+			//the denominator of the equation of the penalty coefficients
+			denominator = 0;
+			for( int l=0; l < numberOfConstraints; l++ ) {
+				denominator += sums[ l + 1 ] * sums[ l + 1 ];
+			}
+
+		}
+		__syncthreads( );
+
+		//the penalty coefficients are calculated
+		for( int j=threadIdx.x; j < numberOfConstraints; j += blockDim.x ) {
+			penaltyCoefficients[ j ] = (T) ( denominator == 0? (Accumulator) 0: ( sumObjectiveFunction / denominator ) * sums[ j + 1 ] );
+		}
+
+	}
+
+	/*
+	 * Calculation of the fitness values, one thread per candidate solution.
+	 */
+	template< typename T, typename Accumulator >
+	__global__ void calculateFitness(
+		T* fitnessValues,
+		int populationSize,
+		int numberOfConstraints,
+		const T* objectiveFunctionValues,
+		const T* constraintViolationValues,
+		std::size_t individualStride,
+		std::size_t constraintStride,
+		const T* penaltyCoefficients,
+		const Accumulator* averageObjectiveFunctionValues ) {
+
+		const int i = blockIdx.x * blockDim.x + threadIdx.x;
+		if ( i >= populationSize ) {
+			return;
+		}
+
+		//indicates if the candidate solution is infeasible
+		bool infeasible = false;
+		//the penalty value
+		Accumulator penalty = 0;
+		const T* violations = constraintViolationValues + i * individualStride;
+		for( int j=0; j < numberOfConstraints; j++ ) {
+
+			const T violation = violations[ j * constraintStride ];
+			if ( violation > 0 ) {
+				//the candidate solution is infeasible if some constraint is violated
+				infeasible = true;
+				//the penalty value is updated
+				penalty += (Accumulator) penaltyCoefficients[ j ] * (Accumulator) violation;
+			}
+
+		}
+
+		//the fitness is the sum of the objective function and penalty values
+		//if the candidate solution is infeasible and just the objective function value,
+		//otherwise
+		const Accumulator average = *averageObjectiveFunctionValues;
+		const Accumulator objective = objectiveFunctionValues[ i ];
+		fitnessValues[ i ] = infeasible?
+			(T) ( objective > average? objective + penalty: average + penalty ):
+			objectiveFunctionValues[ i ];
+
+	}
+
+	std::size_t individualStride( ViolationLayout layout, std::size_t leadingDimension ) {
+		return layout == ROW_MAJOR? leadingDimension: 1;
+	}
+
+	std::size_t constraintStride( ViolationLayout layout, std::size_t leadingDimension ) {
+		return layout == ROW_MAJOR? 1: leadingDimension;
+	}
+
+}
+
+	/*
+	 * Constructor.
+	 */
+	template< typename T, typename Accumulator >
+	DeviceAdaptivePenaltyMethod< T, Accumulator >::DeviceAdaptivePenaltyMethod( const int numberOfConstraints, void* stream ):
+		numberOfConstraints( numberOfConstraints ),
+		stream( stream ),
+		partialSums( 0 ),
+		numberOfChunks( 0 ),
+		sums( 0 ),
+		averageObjectiveFunctionValues( 0 ) {
+
+		//the destructor is not called if the constructor throws, so the buffers are released here
+		device::check( APM_DEVICE( Malloc )( (void**) &this->sums, ( numberOfConstraints + 1 ) * sizeof( Accumulator ) ), "Malloc" );
+		DeviceError error = APM_DEVICE( Malloc )( (void**) &this->averageObjectiveFunctionValues, sizeof( Accumulator ) );
+		if ( error != APM_DEVICE( Success ) ) {
+			APM_DEVICE( Free )( this->sums );
+			device::check( error, "Malloc" );
+		}
+		error = APM_DEVICE( MemsetAsync )( this->averageObjectiveFunctionValues, 0, sizeof( Accumulator ), (DeviceStream) this->stream );
+		if ( error != APM_DEVICE( Success ) ) {
+			APM_DEVICE( Free )( this->averageObjectiveFunctionValues );
+			APM_DEVICE( Free )( this->sums );
+			device::check( error, "MemsetAsync" );
+		}
+
+	}
+
+	/*
+	 * Destructor.
+	 */
+	template< typename T, typename Accumulator >
+	DeviceAdaptivePenaltyMethod< T, Accumulator >::~DeviceAdaptivePenaltyMethod( ) {
+		APM_DEVICE( Free )( this->partialSums );
+		APM_DEVICE( Free )( this->sums );
+		APM_DEVICE( Free )( this->averageObjectiveFunctionValues );
+	}
+
+	/*
+	 * Method to calculate the penalty coefficients.
+	 */
+	template< typename T, typename Accumulator >
+	void DeviceAdaptivePenaltyMethod< T, Accumulator >::calculatePenaltyCoefficients(
+		int populationSize,
+		const T* objectiveFunctionValues,
+		const T* constraintViolationValues,
+		ViolationLayout layout,
+		std::size_t leadingDimension,
+		T* penaltyCoefficients ) {
+
+		const int chunks = ( populationSize + DEVICE_CHUNK_SIZE - 1 ) / DEVICE_CHUNK_SIZE;
+		const int columns = this->numberOfConstraints + 1 < device::MAXIMUM_COLUMNS? this->numberOfConstraints + 1: device::MAXIMUM_COLUMNS;
+		const DeviceStream stream = (DeviceStream) this->stream;
+
+		//the partial sums grow with the largest population
+		if ( chunks > this->numberOfChunks ) {
+			device::check( APM_DEVICE( StreamSynchronize )( stream ), "StreamSynchronize" );
+			APM_DEVICE( Free )( this->partialSums );
+			this->partialSums = 0;
+			this->numberOfChunks = 0;
+			device::check( APM_DEVICE( Malloc )( (void**) &this->partialSums,
+				(std::size_t) chunks * ( this->numberOfConstraints + 1 ) * sizeof( Accumulator ) ), "Malloc" );
+			this->numberOfChunks = chunks;
+		}
+
+		//a grid cannot be empty: for an empty population, only the sums are finished, which gives
+		//the coefficients 0 and the average 0 / 0, as the class does
+		if ( chunks > 0 ) {
+			device::accumulateChunks< T, Accumulator ><<< dim3( chunks, columns ), device::THREADS, 0, stream >>>( populationSize,
+				this->numberOfConstraints, objectiveFunctionValues, constraintViolationValues,
+				device::individualStride( layout, leadingDimension ), device::constraintStride( layout, leadingDimension ), this->partialSums );
+			device::check( APM_DEVICE( GetLastError )( ), "accumulateChunks" );
+		}
+
+		device::finishPenaltyCoefficients< T, Accumulator ><<< 1, device::THREADS, 0, stream >>>( populationSize,
+			this->numberOfConstraints, chunks, this->partialSums, this->sums, this->averageObjectiveFunctionValues, penaltyCoefficients );
+		device::check( APM_DEVICE( GetLastError )( ), "finishPenaltyCoefficients" );
+
+	}
+
+	/*
+	 * Method to calculate de fitness of the candidate solutions.
+	 */
+	template< typename T, typename Accumulator >
+	void DeviceAdaptivePenaltyMethod< T, Accumulator >::calculateFitness(
+		T* fitnessValues,
+		int populationSize,
+		const T* objectiveFunctionValues,
+		const T* constraintViolationValues,
+		ViolationLayout layout,
+		std::size_t leadingDimension,
+		const T* penaltyCoefficients ) {
+
+		const int blocks = ( populationSize + device::THREADS - 1 ) / device::THREADS;
+		//a grid cannot be empty
+		if ( blocks == 0 ) {
+			return;
+		}
+		device::calculateFitness< T, Accumulator ><<< blocks, device::THREADS, 0, (DeviceStream) this->stream >>>( fitnessValues,
+			populationSize, this->numberOfConstraints, objectiveFunctionValues, constraintViolationValues,
+			device::individualStride( layout, leadingDimension ), device::constraintStride( layout, leadingDimension ),
+			penaltyCoefficients, this->averageObjectiveFunctionValues );
+		device::check( APM_DEVICE( GetLastError )( ), "calculateFitness" );
+
+	}
+
+	/*
+	 * Method to calculate the penalty coefficients and the fitness of the candidate solutions.
+	 */
+	template< typename T, typename Accumulator >
+	void DeviceAdaptivePenaltyMethod< T, Accumulator >::evaluateGeneration(
+		T* fitnessValues,
+		int populationSize,
+		const T* objectiveFunctionValues,
+		const T* constraintViolationValues,
+		ViolationLayout layout,
+		std::size_t leadingDimension,
+		T* penaltyCoefficients ) {
+
+		this->calculatePenaltyCoefficients( populationSize, objectiveFunctionValues, constraintViolationValues,
+			layout, leadingDimension, penaltyCoefficients );
+		this->calculateFitness( fitnessValues, populationSize, objectiveFunctionValues, constraintViolationValues,
+			layout, leadingDimension, penaltyCoefficients );
+
+	}
+
+	/*
+	 * Method to copy the average of the objective function values to the host.
+	 */
+	template< typename T, typename Accumulator >
+	Accumulator DeviceAdaptivePenaltyMethod< T, Accumulator >::getAverageObjectiveFunctionValues( ) const {
+
+		Accumulator average;
+		device::check( APM_DEVICE( MemcpyAsync )( &average, this->averageObjectiveFunctionValues, sizeof( Accumulator ),
+			APM_DEVICE( MemcpyDeviceToHost ), (DeviceStream) this->stream ), "MemcpyAsync" );
+		this->synchronize( );
+		return average;
+
+	}
+
+	/*
+	 * Method to wait for the work enqueued on the stream.
+	 */
+	template< typename T, typename Accumulator >
+	void DeviceAdaptivePenaltyMethod< T, Accumulator >::synchronize( ) const {
+		device::check( APM_DEVICE( StreamSynchronize )( (DeviceStream) this->stream ), "StreamSynchronize" );
+	}
+
+	/*
+	 * Instantiations listed in AdaptivePenaltyMethodDevice.hpp.
+	 */
+	template class DeviceAdaptivePenaltyMethod< float >;
+	template class DeviceAdaptivePenaltyMethod< double >;
+	template class DeviceAdaptivePenaltyMethod< float, double >;
+
+}
@@ -0,0 +1,182 @@
+/*
+ * File:   AdaptivePenaltyMethodDevice.hpp
+ * Author: Heder Soares Bernardino
+ *
+ * Implementation of the Adaptive Penalty Method for GPUs (CUDA or HIP),
+ * for populations whose objective function and constraint violation
+ * values are already in the memory of the device. The penalty
+ * coefficients, the average of the objective function values and the
+ * fitness values are calculated and kept in the memory of the device,
+ * so nothing is copied to the host.
+ *
+ * The semantics are the ones of the AdaptivePenaltyMethod class
+ * (including the coefficients equal to 0 when no constraint is violated
+ * by the population). The sums over the population are calculated by
+ * chunks of DEVICE_CHUNK_SIZE candidate solutions, each one reduced by
+ * a tree of fixed shape, and the partial sums of the chunks are added
+ * in their order. Thus, the results are reproducible from run to run and
+ * for any device, but the additions are not in the order of the CPU class,
+ * whose results may differ in the last bits.
+ *
+ * This file only depends on the C++ standard library, so it can be
+ * included by code compiled by the host compiler.
+ *
+ * Compilation:
+ * Use one of the following commands to compile the implementation:
+ * nvcc -c -fmad=false AdaptivePenaltyMethodDevice.cu
+ * hipcc -c -ffp-contract=off -x hip AdaptivePenaltyMethodDevice.cu
+ * This will generate a 'AdaptivePenaltyMethodDevice.o' object file, which
+ * contains the classes with 'float' values, 'double' values and 'float'
+ * values with 'double' sums, and which must be linked with the CUDA (or
+ * HIP) runtime. The options disable the fused multiply-adds, which
+ * would change the rounding of the products of the formulas.
+ */
+
+#ifndef ADAPTIVEPENALTYMETHODDEVICE_HPP
+#define	ADAPTIVEPENALTYMETHODDEVICE_HPP
+
+/*
+ * Includes.
+ */
+#include <cstddef>
+
+#include "AdaptivePenaltyMethod.hpp"
+
+namespace apm {
+
+/*
+ * Number of candidate solutions reduced into each partial sum on the device.
+ */
+const int DEVICE_CHUNK_SIZE = 4096;
+
+/*
+ * The Adaptive Penalty Method on a GPU.
+ * - T: type of the objective function values, constraint violation
+ * values, penalty coefficients and fitness values;
+ * - Accumulator: type of the sums over the population and of the
+ * average of the objective function values.
+ * All the pointers given to the methods are device pointers. The work
+ * is enqueued on the stream given to the constructor and the methods
+ * return before it is finished (except 'getAverageObjectiveFunctionValues'
+ * and 'synchronize'). Errors of the runtime are thrown as std::runtime_error.
+ */
+template< typename T, typename Accumulator = T >
+class DeviceAdaptivePenaltyMethod {
+	public:
+		/*
+		 * Constructor.
+		 * Parameters:
+		 * - numberOfConstraints: the number of constraints of the problem;
+		 * - stream: the cudaStream_t (or hipStream_t) where the work is
+		 * enqueued; 0 is the default stream.
+		 */
+		DeviceAdaptivePenaltyMethod( const int numberOfConstraints, void* stream = 0 );
+
+		/*
+		 * Destructor.
+		 */
+		virtual ~DeviceAdaptivePenaltyMethod( );
+
+	/*
+	 * Name: calculatePenaltyCoefficients
+	 * Description: Calculate the penalty coefficients and the average
+	 * of the objective function values of a population. For an empty
+	 * population, the coefficients are 0 and the average is 0 / 0 (NaN),
+	 * as for AdaptivePenaltyMethod.
+	 * Parameters:
+	 * - populationSize: number of candidate solutions
+	 * in the population;
+	 * - objectiveFunctionValues: values of the objective
+	 * function obtained by evaluating the candidate solutions;
+	 * - constraintViolationValues: contiguous matrix with the values
+	 * of the constraint violations of the candidate solutions;
+	 * COLUMN_MAJOR is recommended, as the accesses of the threads
+	 * are then coalesced;
+	 * - layout, leadingDimension: the layout of the matrix (see
+	 * AdaptivePenaltyMethod::calculatePenaltyCoefficients);
+	 * - penaltyCoefficients: penalty coefficients
+	 * calculated by the adaptive penalty method and which
+	 * are used by the penalty function.
+	 */
+	 void calculatePenaltyCoefficients(
+		 int populationSize,
+		 const T* objectiveFunctionValues,
+		 const T* constraintViolationValues,
+		 ViolationLayout layout,
+		 std::size_t leadingDimension,
+		 T* penaltyCoefficients );
+
+	/*
+	 * Name: calculateFitness
+	 * Description: Calculate the fitness values of a population with
+	 * the penalty coefficients and the average of the objective function
+	 * values calculated by 'calculatePenaltyCoefficients' (one thread
+	 * per candidate solution).
+	 * Parameters:
+	 * - fitnessValues: the fitness values calculated by this method;
+	 * - see 'calculatePenaltyCoefficients' for the others.
+	 */
+	 void calculateFitness(
+		T* fitnessValues,
+		int populationSize,
+		const T* objectiveFunctionValues,
+		const T* constraintViolationValues,
+		ViolationLayout layout,
+		std::size_t leadingDimension,
+		const T* penaltyCoefficients );
+
+	/*
+	 * Name: evaluateGeneration
+	 * Description: Calculate the penalty coefficients and the fitness
+	 * values of a population (see 'calculatePenaltyCoefficients'
+	 * and 'calculateFitness').
+	 */
+	 void evaluateGeneration(
+		T* fitnessValues,
+		int populationSize,
+		const T* objectiveFunctionValues,
+		const T* constraintViolationValues,
+		ViolationLayout layout,
+		std::size_t leadingDimension,
+		T* penaltyCoefficients );
+
+	/*
+	 * Name: getAverageObjectiveFunctionValues
+	 * Description: Copy the average of the objective function values
+	 * of the last population to the host. It waits for the stream.
+	 */
+	 Accumulator getAverageObjectiveFunctionValues( ) const;
+
+	/*
+	 * Name: getDeviceAverageObjectiveFunctionValues
+	 * Description: Return the device pointer to the average of the
+	 * objective function values of the last population.
+	 */
+	 const Accumulator* getDeviceAverageObjectiveFunctionValues( ) const {
+		 return this->averageObjectiveFunctionValues;
+	 }
+
+	/*
+	 * Name: synchronize
+	 * Description: Wait for the work enqueued on the stream.
+	 */
+	 void synchronize( ) const;
+
+	private:
+		DeviceAdaptivePenaltyMethod( const DeviceAdaptivePenaltyMethod& ) = delete;
+		DeviceAdaptivePenaltyMethod& operator=( const DeviceAdaptivePenaltyMethod& ) = delete;
+
+		int numberOfConstraints;
+		void* stream;
+		//device memory: the partial sums of the chunks (the objective function
+		//followed by the constraints), the sums and the average
+		Accumulator* partialSums;
+		int numberOfChunks;
+		Accumulator* sums;
+		Accumulator* averageObjectiveFunctionValues;
+
+};
+
+}
+
+#endif	/* ADAPTIVEPENALTYMETHODDEVICE_HPP */
@@ -0,0 +1,269 @@
+/*
+ * File:   AdaptivePenaltyMethodIO.cpp
+ * Author: Heder Soares Bernardino
+ *
+ * Binary files of populations.
+ * Please, read AdaptivePenaltyMethodIO.hpp file for more information.
+ *
+ * Compilation:
+ * Use the following command to compile this code:
+ * g++ -c AdaptivePenaltyMethodIO.cpp
+ */
+
+/*
+ * Includes.
+ */
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "AdaptivePenaltyMethodIO.hpp"
+
+
+namespace apm {
+
+namespace {
+
+	const char MAGIC[ 8 ] = { 'A', 'P', 'M', 'P', 'O', 'P', 0, 0 };
+	const std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+	const std::uint16_t VERSION = 1;
+
+	/*
+	 * Alignment, in bytes, of the values in a file.
+	 */
+	const std::uint64_t ALIGNMENT = 64;
+
+	std::uint64_t aligned( std::uint64_t position ) {
+		return ( position + ALIGNMENT - 1 ) / ALIGNMENT * ALIGNMENT;
+	}
+
+	std::size_t sizeOf( std::uint8_t valueType ) {
+		return valueType == FLOAT32? sizeof( float ): sizeof( double );
+	}
+
+	void fail( const std::string& message, const char* fileName ) {
+		throw std::runtime_error( message + ": " + fileName );
+	}
+
+	PopulationHeader headerOf(
+		ValueType valueType,
+		ViolationLayout layout,
+		std::uint64_t populationSize,
+		std::uint64_t numberOfConstraints ) {
+
+		PopulationHeader header;
+		std::memset( &header, 0, sizeof( header ) );
+		std::memcpy( header.magic, MAGIC, sizeof( MAGIC ) );
+		header.byteOrder = BYTE_ORDER_MARK;
+		header.version = VERSION;
+		header.valueType = (std::uint8_t) valueType;
+		header.layout = (std::uint8_t) layout;
+		header.populationSize = populationSize;
+		header.numberOfConstraints = numberOfConstraints;
+		header.leadingDimension = layout == ROW_MAJOR? numberOfConstraints: populationSize;
+		header.objectiveFunctionOffset = aligned( sizeof( PopulationHeader ) );
+		header.constraintViolationOffset = aligned( header.objectiveFunctionOffset + populationSize * sizeOf( header.valueType ) );
+		return header;
+
+	}
+
+	void writeAll( std::FILE* file, const void* values, std::size_t size, const char* fileName ) {
+		if ( size > 0 && std::fwrite( values, 1, size, file ) != size ) {
+			std::fclose( file );
+			fail( "cannot write the file", fileName );
+		}
+	}
+
+	void writePadding( std::FILE* file, std::uint64_t position, const char* fileName ) {
+		static const unsigned char zeros[ ALIGNMENT ] = { 0 };
+		writeAll( file, zeros, (std::size_t) ( aligned( position ) - position ), fileName );
+	}
+
+}
+
+	/*
+	 * Constructor.
+	 */
+	MappedPopulation::MappedPopulation( const char* fileName ):
+		data( 0 ),
+		size( 0 ),
+		header( 0 ) {
+
+		const int descriptor = open( fileName, O_RDONLY );
+		if ( descriptor < 0 ) {
+			fail( "cannot open the file", fileName );
+		}
+		struct stat status;
+		if ( fstat( descriptor, &status ) != 0 || (std::size_t) status.st_size < sizeof( PopulationHeader ) ) {
+			::close( descriptor );
+			fail( "not a file of a population", fileName );
+		}
+		this->size = (std::size_t) status.st_size;
+		void* mapping = mmap( 0, this->size, PROT_READ, MAP_SHARED, descriptor, 0 );
+		::close( descriptor );
+		if ( mapping == MAP_FAILED ) {
+			fail( "cannot map the file", fileName );
+		}
+		//the values are usually read once, in order
+		madvise( mapping, this->size, MADV_SEQUENTIAL );
+		this->data = (const unsigned char*) mapping;
+		this->header = (const PopulationHeader*) mapping;
+
+		//the header is checked, and the values must be inside the file
+		const PopulationHeader& header = *this->header;
+		const std::uint64_t rows = header.layout == ROW_MAJOR? header.populationSize: header.numberOfConstraints;
+		const std::uint64_t columns = header.layout == ROW_MAJOR? header.numberOfConstraints: header.populationSize;
+		bool valid = std::memcmp( header.magic, MAGIC, sizeof( MAGIC ) ) == 0 && header.byteOrder == BYTE_ORDER_MARK &&
+			header.version == VERSION && ( header.valueType == FLOAT32 || header.valueType == FLOAT64 ) &&
+			( header.layout == ROW_MAJOR || header.layout == COLUMN_MAJOR ) &&
+			header.objectiveFunctionOffset % ALIGNMENT == 0 && header.constraintViolationOffset % ALIGNMENT == 0 &&
+			header.leadingDimension >= columns && header.objectiveFunctionOffset <= this->size;
+		if ( valid ) {
+
+			const std::uint64_t value = sizeOf( header.valueType );
+			valid = header.populationSize <= ( this->size - header.objectiveFunctionOffset ) / value;
+			//the last value of the matrix is at '( rows - 1 ) * leadingDimension + columns - 1'
+			if ( rows > 0 && columns > 0 ) {
+				const std::uint64_t available = header.constraintViolationOffset <= this->size?
+					( this->size - header.constraintViolationOffset ) / value: 0;
+				valid = valid && columns <= available && rows - 1 <= ( available - columns ) / header.leadingDimension;
+			}
+
+		}
+		if ( !valid ) {
+			munmap( mapping, this->size );
+			fail( "not a valid file of a population", fileName );
+		}
+
+	}
+
+	/*
+	 * Destructor.
+	 */
+	MappedPopulation::~MappedPopulation( ) {
+		munmap( (void*) this->data, this->size );
+	}
+
+	void MappedPopulation::checkValueType( ValueType valueType ) const {
+		if ( valueType != this->header->valueType ) {
+			throw std::logic_error( "the type of the values differs from the one of the file" );
+		}
+	}
+
+
+	/*
+	 * Function to write a population in a file.
+	 */
+	template< typename T >
+	void writePopulation(
+		const char* fileName,
+		std::size_t populationSize,
+		std::size_t numberOfConstraints,
+		const T* objectiveFunctionValues,
+		const T* constraintViolationValues,
+		ViolationLayout layout,
+		std::size_t leadingDimension ) {
+
+		std::size_t i;
+		std::size_t j;
+		std::FILE* file = std::fopen( fileName, "wb" );
+		if ( !file ) {
+			fail( "cannot create the file", fileName );
+		}
+		const PopulationHeader header = headerOf( valueTypeOf< T >( ), layout, populationSize, numberOfConstraints );
+		writeAll( file, &header, sizeof( header ), fileName );
+		writePadding( file, sizeof( header ), fileName );
+		writeAll( file, objectiveFunctionValues, populationSize * sizeof( T ), fileName );
+		writePadding( file, header.objectiveFunctionOffset + populationSize * sizeof( T ), fileName );
+
+		//the matrix is written densely, row by row (ROW_MAJOR) or column by column (COLUMN_MAJOR)
+		if ( layout == ROW_MAJOR ) {
+			for( i=0; i < populationSize; i++ ) {
+				writeAll( file, constraintViolationValues + i * leadingDimension, numberOfConstraints * sizeof( T ), fileName );
+			}
+		} else {
+			for( j=0; j < numberOfConstraints; j++ ) {
+				writeAll( file, constraintViolationValues + j * leadingDimension, populationSize * sizeof( T ), fileName );
+			}
+		}
+		if ( std::fclose( file ) != 0 ) {
+			fail( "cannot write the file", fileName );
+		}
+
+	}
+
+
+	/*
+	 * Constructor.
+	 */
+	template< typename T >
+	FitnessWriter< T >::FitnessWriter( const char* fileName ):
+		file( std::fopen( fileName, "wb" ) ),
+		count( 0 ) {
+
+		if ( !this->file ) {
+			fail( "cannot create the file", fileName );
+		}
+		//the header is written again by 'close', with the number of fitness values
+		const PopulationHeader header = headerOf( valueTypeOf< T >( ), ROW_MAJOR, 0, 0 );
+		writeAll( this->file, &header, sizeof( header ), fileName );
+		writePadding( this->file, sizeof( header ), fileName );
+
+	}
+
+	/*
+	 * Destructor.
+	 */
+	template< typename T >
+	FitnessWriter< T >::~FitnessWriter( ) {
+		if ( this->file ) {
+			try {
+				this->close( );
+			} catch( const std::exception& ) {
+			}
+		}
+	}
+
+	/*
+	 * Method to append fitness values to the file.
+	 */
+	template< typename T >
+	void FitnessWriter< T >::write( const T* fitnessValues, std::size_t count ) {
+
+		if ( count > 0 && std::fwrite( fitnessValues, sizeof( T ), count, this->file ) != count ) {
+			throw std::runtime_error( "cannot write the fitness values" );
+		}
+		this->count += count;
+
+	}
+
+	/*
+	 * Method to complete and close the file.
+	 */
+	template< typename T >
+	void FitnessWriter< T >::close( ) {
+
+		std::FILE* file = this->file;
+		this->file = 0;
+		const PopulationHeader header = headerOf( valueTypeOf< T >( ), ROW_MAJOR, this->count, 0 );
+		const bool written = std::fseek( file, 0, SEEK_SET ) == 0 && std::fwrite( &header, sizeof( header ), 1, file ) == 1;
+		if ( std::fclose( file ) != 0 || !written ) {
+			throw std::runtime_error( "cannot write the fitness values" );
+		}
+
+	}
+
+	/*
+	 * Instantiations for the types of the values of the files.
+	 */
+	template void writePopulation< float >( const char*, std::size_t, std::size_t, const float*, const float*, ViolationLayout, std::size_t );
+	template void writePopulation< double >( const char*, std::size_t, std::size_t, const double*, const double*, ViolationLayout, std::size_t );
+	template class FitnessWriter< float >;
+	template class FitnessWriter< double >;
+
+}
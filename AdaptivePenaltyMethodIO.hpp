@@ -0,0 +1,255 @@
+/*
+ * File:   AdaptivePenaltyMethodIO.hpp
+ * Author: Heder Soares Bernardino
+ *
+ * Binary files of populations, so that archived generations can be
+ * scored again without parsing them: a file is memory-mapped by
+ * 'MappedPopulation' and its buffers are given directly to the methods
+ * of the AdaptivePenaltyMethod class over contiguous matrices, e.g.:
+ * apm::MappedPopulation population( "generation.apm" );
+ * method.evaluateGeneration( fitnessValues, population.getPopulationSize( ),
+ *     population.objectiveFunctionValues< double >( ),
+ *     population.constraintViolationValues< double >( ),
+ *     population.getLayout( ), population.getLeadingDimension( ), penaltyCoefficients );
+ *
+ * Format of a file (all the values in the byte order of the machine
+ * which wrote it, which is checked by the reader):
+ * - a PopulationHeader;
+ * - the objective function values, 'populationSize' values starting
+ * at byte 'objectiveFunctionOffset';
+ * - the constraint violation values, a dense matrix with the layout of
+ * the header ('leadingDimension' is the number of constraints for
+ * ROW_MAJOR and the population size for COLUMN_MAJOR) starting at
+ * byte 'constraintViolationOffset'.
+ * Both offsets are multiples of 64 bytes. A file of fitness values
+ * (see FitnessWriter) is a file without constraints whose values are
+ * the fitness values.
+ *
+ * The memory mapping uses the POSIX interface (mmap).
+ *
+ * Compilation:
+ * Use the following command to compile the implementation:
+ * g++ -c AdaptivePenaltyMethodIO.cpp
+ * This will generate a 'AdaptivePenaltyMethodIO.o' object file.
+ */
+
+#ifndef ADAPTIVEPENALTYMETHODIO_HPP
+#define	ADAPTIVEPENALTYMETHODIO_HPP
+
+/*
+ * Includes.
+ */
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#include "AdaptivePenaltyMethod.hpp"
+
+namespace apm {
+
+/*
+ * Types of the values of a file.
+ */
+enum ValueType {
+	FLOAT32 = 1,
+	FLOAT64 = 2
+};
+
+/*
+ * Name: valueTypeOf
+ * Description: Return the ValueType of 'T' ('float' or 'double').
+ */
+template< typename T >
+ValueType valueTypeOf( );
+
+template< >
+inline ValueType valueTypeOf< float >( ) {
+	return FLOAT32;
+}
+
+template< >
+inline ValueType valueTypeOf< double >( ) {
+	return FLOAT64;
+}
+
+/*
+ * Header of a file of a population (64 bytes).
+ * - magic: "APMPOP" followed by two 0 bytes;
+ * - byteOrder: 0x01020304, written in the byte order of the machine;
+ * - version: the version of the format (1);
+ * - valueType: a ValueType;
+ * - layout: a ViolationLayout;
+ * - populationSize, numberOfConstraints, leadingDimension: the sizes
+ * of the population and of the matrix of constraint violation values;
+ * - objectiveFunctionOffset, constraintViolationOffset: positions, in
+ * bytes from the beginning of the file, of the values;
+ * - reserved: 0.
+ */
+struct PopulationHeader {
+	char magic[ 8 ];
+	std::uint32_t byteOrder;
+	std::uint16_t version;
+	std::uint8_t valueType;
+	std::uint8_t layout;
+	std::uint64_t populationSize;
+	std::uint64_t numberOfConstraints;
+	std::uint64_t leadingDimension;
+	std::uint64_t objectiveFunctionOffset;
+	std::uint64_t constraintViolationOffset;
+	std::uint64_t reserved;
+};
+
+/*
+ * A file of a population mapped into memory (read only). The values
+ * are read from the file by the operating system when they are used,
+ * so the population does not need to fit in memory.
+ * std::runtime_error is thrown if the file cannot be mapped or is not
+ * a valid file of a population.
+ */
+class MappedPopulation {
+	public:
+		/*
+		 * Constructor.
+		 * Parameters:
+		 * - fileName: the name of the file.
+		 */
+		explicit MappedPopulation( const char* fileName );
+
+		/*
+		 * Destructor.
+		 */
+		virtual ~MappedPopulation( );
+
+		std::size_t getPopulationSize( ) const {
+			return (std::size_t) this->header->populationSize;
+		}
+
+		std::size_t getNumberOfConstraints( ) const {
+			return (std::size_t) this->header->numberOfConstraints;
+		}
+
+		ViolationLayout getLayout( ) const {
+			return (ViolationLayout) this->header->layout;
+		}
+
+		std::size_t getLeadingDimension( ) const {
+			return (std::size_t) this->header->leadingDimension;
+		}
+
+		ValueType getValueType( ) const {
+			return (ValueType) this->header->valueType;
+		}
+
+	/*
+	 * Name: objectiveFunctionValues
+	 * Description: Return the objective function values of the candidate
+	 * solutions. 'T' must be the type of the values of the file
+	 * (std::logic_error is thrown otherwise).
+	 */
+	 template< typename T >
+	 const T* objectiveFunctionValues( ) const {
+		 this->checkValueType( valueTypeOf< T >( ) );
+		 return (const T*) ( this->data + this->header->objectiveFunctionOffset );
+	 }
+
+	/*
+	 * Name: constraintViolationValues
+	 * Description: Return the matrix of constraint violation values
+	 * (see 'getLayout' and 'getLeadingDimension'). 'T' must be the type
+	 * of the values of the file (std::logic_error is thrown otherwise).
+	 */
+	 template< typename T >
+	 const T* constraintViolationValues( ) const {
+		 this->checkValueType( valueTypeOf< T >( ) );
+		 return (const T*) ( this->data + this->header->constraintViolationOffset );
+	 }
+
+	private:
+		MappedPopulation( const MappedPopulation& ) = delete;
+		MappedPopulation& operator=( const MappedPopulation& ) = delete;
+
+		void checkValueType( ValueType valueType ) const;
+
+		const unsigned char* data;
+		std::size_t size;
+		const PopulationHeader* header;
+
+};
+
+/*
+ * Name: writePopulation
+ * Description: Write a population in a file (which is replaced).
+ * std::runtime_error is thrown if the file cannot be written.
+ * Parameters:
+ * - fileName: the name of the file;
+ * - populationSize: number of candidate solutions
+ * in the population;
+ * - numberOfConstraints: the number of constraints of the problem;
+ * - objectiveFunctionValues: values of the objective
+ * function obtained by evaluating the candidate solutions;
+ * - constraintViolationValues, layout, leadingDimension: contiguous
+ * matrix with the constraint violation values (see
+ * AdaptivePenaltyMethod::calculatePenaltyCoefficients); the matrix is
+ * written densely, with the same layout.
+ */
+template< typename T >
+void writePopulation(
+	const char* fileName,
+	std::size_t populationSize,
+	std::size_t numberOfConstraints,
+	const T* objectiveFunctionValues,
+	const T* constraintViolationValues,
+	ViolationLayout layout,
+	std::size_t leadingDimension );
+
+/*
+ * A file of fitness values written in pieces, e.g. while the archived
+ * populations are scored, so the fitness values of the whole population
+ * do not need to be in memory. The file is a file of a population
+ * without constraints (see MappedPopulation), which is complete after
+ * 'close' is called. std::runtime_error is thrown if the file cannot
+ * be written.
+ */
+template< typename T >
+class FitnessWriter {
+	public:
+		/*
+		 * Constructor.
+		 * Parameters:
+		 * - fileName: the name of the file (which is replaced).
+		 */
+		explicit FitnessWriter( const char* fileName );
+
+		/*
+		 * Destructor. It closes the file if 'close' was not called.
+		 */
+		virtual ~FitnessWriter( );
+
+	/*
+	 * Name: write
+	 * Description: Append fitness values to the file.
+	 * Parameters:
+	 * - fitnessValues: the fitness values;
+	 * - count: the number of fitness values.
+	 */
+	 void write( const T* fitnessValues, std::size_t count );
+
+	/*
+	 * Name: close
+	 * Description: Write the number of fitness values in the header
+	 * and close the file.
+	 */
+	 void close( );
+
+	private:
+		FitnessWriter( const FitnessWriter& ) = delete;
+		FitnessWriter& operator=( const FitnessWriter& ) = delete;
+
+		std::FILE* file;
+		std::size_t count;
+
+};
+
+}
+
+#endif	/* ADAPTIVEPENALTYMETHODIO_HPP */
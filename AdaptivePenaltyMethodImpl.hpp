@@ -0,0 +1,2257 @@
+/*
+ * File:   AdaptivePenaltyMethodImpl.hpp
+ * Author: Heder Soares Bernardino
+ *
+ *
+ * Definitions of the methods of the BasicAdaptivePenaltyMethod class.
+ * AdaptivePenaltyMethod.cpp includes this file to compile the
+ * instantiations declared in AdaptivePenaltyMethod.hpp. Include this
+ * file instead of AdaptivePenaltyMethod.hpp to use other combinations
+ * of types (e.g. 'BasicAdaptivePenaltyMethod< double, long double, long >').
+ * The object files of the library must still be linked (the kernels
+ * and the thread pool are compiled in their own files).
+ * AdaptivePenaltyMethod.hpp includes this file if APM_HEADER_ONLY is defined.
+ */
+
+#ifndef ADAPTIVEPENALTYMETHODIMPL_HPP
+#define	ADAPTIVEPENALTYMETHODIMPL_HPP
+
+/*
+ * Includes.
+ */
+#include "AdaptivePenaltyMethod.hpp"
+#include "AdaptivePenaltyMethodKernels.hpp"
+#include "AdaptivePenaltyMethodParallel.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+
+
+namespace apm {
+
+	namespace detail {
+
+		/*
+		 * Number of candidate solutions processed together when
+		 * a contiguous matrix is traversed. This keeps the per-individual
+		 * accumulators in the cache.
+		 */
+		const int TILE_SIZE = 256;
+
+		/*
+		 * Number of candidate solutions in a reduction block
+		 * (see BasicAdaptivePenaltyMethod::REDUCTION_BLOCK_SIZE).
+		 */
+		const int BLOCK_SIZE = 4096;
+
+		/*
+		 * Distance between the violations of two consecutive
+		 * candidate solutions in a contiguous matrix.
+		 */
+		inline std::size_t individualStride( ViolationLayout layout, std::size_t leadingDimension ) {
+			return layout == ROW_MAJOR? leadingDimension: 1;
+		}
+
+		/*
+		 * Distance between the violations of two consecutive
+		 * constraints in a contiguous matrix.
+		 */
+		inline std::size_t constraintStride( ViolationLayout layout, std::size_t leadingDimension ) {
+			return layout == ROW_MAJOR? 1: leadingDimension;
+		}
+
+		/*
+		 * Constraint violation values given as a table of pointers
+		 * to the rows. The rows are processed one by one, so the kernels
+		 * for a fixed number of constraints are used if 'Constraints' is not 0.
+		 */
+		template< typename T, typename Index, int Constraints >
+		struct RowTable {
+			T* const* rows;
+			kernels::ConstraintKinds< T > kinds;
+
+			template< typename Accumulator, int >
+			Accumulator penalty( Index i, Index numberOfConstraints, const T* penaltyCoefficients, bool& infeasible ) const {
+				return penaltyOf< Accumulator, Constraints >( this->rows[ i ], 1, numberOfConstraints, penaltyCoefficients,
+					this->kinds, infeasible );
+			}
+
+			template< typename Accumulator >
+			void accumulate( const kernels::Kernels< T, Accumulator >& kernel, Accumulator* sumViolation, unsigned int* violatedConstraints,
+				Index begin, Index count, Index numberOfConstraints ) const {
+
+				for( Index k=0; k < count; k++ ) {
+					if ( Constraints > 0 ) {
+						kernels::accumulateViolationsFixed< T, Accumulator, Constraints >( sumViolation, violatedConstraints? violatedConstraints + k: 0,
+							this->rows[ begin + k ], 1, 0, 1, Constraints, this->kinds );
+					} else {
+						kernel.accumulateViolations( sumViolation, violatedConstraints? violatedConstraints + k: 0,
+							this->rows[ begin + k ], 1, 0, 1, numberOfConstraints, this->kinds );
+					}
+				}
+
+			}
+
+			void countViolations( Index* violations, Index begin, Index count, Index numberOfConstraints ) const {
+				for( Index k=0; k < count; k++ ) {
+					for( Index j=0; j < numberOfConstraints; j++ ) {
+						violations[ j ] += kernels::violationOf( this->rows[ begin + k ][ j ], this->kinds, j ) > 0;
+					}
+				}
+			}
+
+			template< typename Accumulator >
+			void penalties( const kernels::Kernels< T, Accumulator >& kernel, Accumulator* penalty, unsigned char* infeasible,
+				Index begin, Index count, Index numberOfConstraints, const T* penaltyCoefficients ) const {
+
+				for( Index k=0; k < count; k++ ) {
+					if ( Constraints > 0 ) {
+						kernels::calculatePenaltiesFixed< T, Accumulator, Constraints >( penalty + k, infeasible + k,
+							this->rows[ begin + k ], 1, 0, 1, Constraints, penaltyCoefficients, this->kinds );
+					} else {
+						kernel.calculatePenalties( penalty + k, infeasible + k,
+							this->rows[ begin + k ], 1, 0, 1, numberOfConstraints, penaltyCoefficients, this->kinds );
+					}
+				}
+
+			}
+		};
+
+		/*
+		 * Constraint violation values given as a contiguous matrix.
+		 */
+		template< typename T, typename Index >
+		struct StridedMatrix {
+			const T* values;
+			std::size_t individuals;
+			std::size_t constraints;
+			kernels::ConstraintKinds< T > kinds;
+
+			StridedMatrix( const T* values, ViolationLayout layout, std::size_t leadingDimension, const kernels::ConstraintKinds< T >& kinds ):
+				values( values ),
+				individuals( individualStride( layout, leadingDimension ) ),
+				constraints( detail::constraintStride( layout, leadingDimension ) ),
+				kinds( kinds ) {
+			}
+
+			const T* individual( Index i ) const {
+				return this->values + i * this->individuals;
+			}
+
+			template< typename Accumulator, int Constraints >
+			Accumulator penalty( Index i, Index numberOfConstraints, const T* penaltyCoefficients, bool& infeasible ) const {
+				return penaltyOf< Accumulator, Constraints >( this->individual( i ), this->constraints, numberOfConstraints, penaltyCoefficients,
+					this->kinds, infeasible );
+			}
+
+			/*
+			 * The matrix formed by the candidate solutions from 'first' on.
+			 */
+			StridedMatrix from( Index first ) const {
+				StridedMatrix matrix( *this );
+				matrix.values += first * this->individuals;
+				return matrix;
+			}
+
+			template< typename Accumulator >
+			void accumulate( const kernels::Kernels< T, Accumulator >& kernel, Accumulator* sumViolation, unsigned int* violatedConstraints,
+				Index begin, Index count, Index numberOfConstraints ) const {
+
+				kernel.accumulateViolations( sumViolation, violatedConstraints, this->individual( begin ), count,
+					this->individuals, this->constraints, numberOfConstraints, this->kinds );
+
+			}
+
+			void countViolations( Index* violations, Index begin, Index count, Index numberOfConstraints ) const {
+				for( Index j=0; j < numberOfConstraints; j++ ) {
+					const T* values = this->individual( begin ) + j * this->constraints;
+					for( Index k=0; k < count; k++ ) {
+						violations[ j ] += kernels::violationOf( values[ k * this->individuals ], this->kinds, j ) > 0;
+					}
+				}
+			}
+
+			template< typename Accumulator >
+			void penalties( const kernels::Kernels< T, Accumulator >& kernel, Accumulator* penalty, unsigned char* infeasible,
+				Index begin, Index count, Index numberOfConstraints, const T* penaltyCoefficients ) const {
+
+				kernel.calculatePenalties( penalty, infeasible, this->individual( begin ), count,
+					this->individuals, this->constraints, numberOfConstraints, penaltyCoefficients, this->kinds );
+
+			}
+		};
+
+		/*
+		 * Constraint violation values given in a compressed sparse row
+		 * structure: only the violations of each candidate solution are
+		 * visited. The violations of a candidate solution are added in the
+		 * given order, which is the order of the constraints for the dense
+		 * inputs when the constraints are given in increasing order. The
+		 * equality constraints which are not given are satisfied.
+		 */
+		template< typename T, typename Index >
+		struct SparseRows {
+			const Index* offsets;
+			const Index* constraints;
+			const T* values;
+			kernels::ConstraintKinds< T > kinds;
+
+			template< typename Accumulator, int >
+			Accumulator penalty( Index i, Index, const T* penaltyCoefficients, bool& infeasible ) const {
+
+				Accumulator penalty = 0;
+				infeasible = false;
+				for( Index e=this->offsets[ i ]; e < this->offsets[ i + 1 ]; e++ ) {
+
+					const T violation = kernels::violationOf( this->values[ e ], this->kinds, this->constraints[ e ] );
+					if ( violation > 0 ) {
+						infeasible = true;
+						penalty += (Accumulator) penaltyCoefficients[ this->constraints[ e ] ] * (Accumulator) violation;
+					}
+
+				}
+				return penalty;
+
+			}
+
+			template< typename Accumulator >
+			void accumulate( const kernels::Kernels< T, Accumulator >&, Accumulator* sumViolation, unsigned int* violatedConstraints,
+				Index begin, Index count, Index ) const {
+
+				for( Index k=0; k < count; k++ ) {
+
+					unsigned int violated = 0;
+					for( Index e=this->offsets[ begin + k ]; e < this->offsets[ begin + k + 1 ]; e++ ) {
+
+						const T violation = kernels::violationOf( this->values[ e ], this->kinds, this->constraints[ e ] );
+						if ( violation > 0 ) {
+							violated++;
+							sumViolation[ this->constraints[ e ] ] += (Accumulator) violation;
+						}
+
+					}
+					if ( violatedConstraints ) {
+						violatedConstraints[ k ] = violated;
+					}
+
+				}
+
+			}
+
+			void countViolations( Index* violations, Index begin, Index count, Index ) const {
+				for( Index e=this->offsets[ begin ]; e < this->offsets[ begin + count ]; e++ ) {
+					violations[ this->constraints[ e ] ] += kernels::violationOf( this->values[ e ], this->kinds, this->constraints[ e ] ) > 0;
+				}
+			}
+
+			template< typename Accumulator >
+			void penalties( const kernels::Kernels< T, Accumulator >&, Accumulator* penalty, unsigned char* infeasible,
+				Index begin, Index count, Index numberOfConstraints, const T* penaltyCoefficients ) const {
+
+				bool violated;
+				for( Index k=0; k < count; k++ ) {
+					penalty[ k ] = this->template penalty< Accumulator, 0 >( begin + k, numberOfConstraints, penaltyCoefficients, violated );
+					infeasible[ k ] = violated;
+				}
+
+			}
+		};
+
+		/*
+		 * Position of the lowest bit set in 'bits' (which is not 0).
+		 */
+		inline int lowestBit( std::uint64_t bits ) {
+#if defined( __GNUC__ )
+			return __builtin_ctzll( bits );
+#else
+			int position = 0;
+			for( ; !( bits & 1 ); bits >>= 1 ) {
+				position++;
+			}
+			return position;
+#endif
+		}
+
+		/*
+		 * Number of reduction blocks of a population.
+		 */
+		template< typename Index >
+		inline Index numberOfBlocks( Index populationSize ) {
+			return ( populationSize + BLOCK_SIZE - 1 ) / BLOCK_SIZE;
+		}
+
+		/*
+		 * First candidate solution after a reduction block.
+		 */
+		template< typename Index >
+		inline Index endOfBlock( Index block, Index populationSize ) {
+			const Index end = ( block + 1 ) * BLOCK_SIZE;
+			return end < populationSize? end: populationSize;
+		}
+
+		/*
+		 * Number of penalized candidate solutions of a block and the
+		 * smallest and the largest of their penalties.
+		 */
+		template< typename Accumulator, typename Index >
+		struct PenaltyRange {
+			Index count;
+			Accumulator minimum;
+			Accumulator maximum;
+
+			void add( Accumulator penalty ) {
+				if ( this->count == 0 || penalty < this->minimum ) {
+					this->minimum = penalty;
+				}
+				if ( this->count == 0 || penalty > this->maximum ) {
+					this->maximum = penalty;
+				}
+				this->count++;
+			}
+
+			void merge( const PenaltyRange& range ) {
+				if ( range.count > 0 ) {
+					if ( this->count == 0 || range.minimum < this->minimum ) {
+						this->minimum = range.minimum;
+					}
+					if ( this->count == 0 || range.maximum > this->maximum ) {
+						this->maximum = range.maximum;
+					}
+					this->count += range.count;
+				}
+			}
+		};
+
+		/*
+		 * Order of the candidate solutions by their fitness values (the
+		 * smallest first) and then by their indices, so the selected
+		 * candidate solutions do not depend on the order in which they are
+		 * visited. The values which are not numbers come last.
+		 */
+		template< typename T, typename Index >
+		struct FitnessOrder {
+			const T* fitnessValues;
+
+			bool operator()( Index a, Index b ) const {
+				const T first = this->fitnessValues[ a ];
+				const T second = this->fitnessValues[ b ];
+				if ( first < second ) {
+					return true;
+				}
+				if ( second < first ) {
+					return false;
+				}
+				if ( first == second || ( first != first && second != second ) ) {
+					return a < b;
+				}
+				return second != second;
+			}
+		};
+
+		/*
+		 * Sums of rows of 'size' values added one by one with a summation
+		 * policy (see SummationPolicy). The rows are added in place in
+		 * 'rows', a buffer of 'rowsOf( policy, terms )' rows given by the
+		 * caller: the levels of the tree for PAIRWISE_SUMMATION (a row is
+		 * added to the level of the lowest zero bit of the number of rows
+		 * already added, with the carries, thus the tree depends only on
+		 * the number of rows), and the sums followed by their compensations
+		 * for COMPENSATED_SUMMATION.
+		 */
+		template< typename Accumulator >
+		struct Summation {
+			SummationPolicy policy;
+			std::size_t size;
+			Accumulator* rows;
+			std::size_t count;
+
+			static std::size_t rowsOf( SummationPolicy policy, std::size_t terms ) {
+				std::size_t levels = 1;
+				if ( policy == COMPENSATED_SUMMATION ) {
+					return 2;
+				}
+				if ( policy == PAIRWISE_SUMMATION ) {
+					for( ; terms > 1; terms >>= 1 ) {
+						levels++;
+					}
+				}
+				return levels;
+			}
+
+			Summation( SummationPolicy policy, std::size_t size, Accumulator* rows ):
+				policy( policy ),
+				size( size ),
+				rows( rows ),
+				count( 0 ) {
+
+				if ( policy == COMPENSATED_SUMMATION ) {
+					std::fill( rows, rows + 2 * size, (Accumulator) 0 );
+				}
+
+			}
+
+			void add( const Accumulator* values ) {
+
+				std::size_t level = 0;
+				if ( this->policy == COMPENSATED_SUMMATION ) {
+
+					Accumulator* sums = this->rows;
+					Accumulator* compensations = this->rows + this->size;
+					for( std::size_t l=0; l < this->size; l++ ) {
+						const Accumulator sum = sums[ l ] + values[ l ];
+						compensations[ l ] += ( sums[ l ] >= 0? sums[ l ]: -sums[ l ] ) >= ( values[ l ] >= 0? values[ l ]: -values[ l ] ) ?
+							( sums[ l ] - sum ) + values[ l ] :
+							( values[ l ] - sum ) + sums[ l ];
+						sums[ l ] = sum;
+					}
+
+				} else {
+
+					//the row is carried up while the levels are complete
+					const Accumulator* carry = values;
+					for( ; this->count >> level & 1; level++ ) {
+						Accumulator* sums = this->rows + level * this->size;
+						for( std::size_t l=0; l < this->size; l++ ) {
+							sums[ l ] += carry[ l ];
+						}
+						carry = sums;
+					}
+					std::copy( carry, carry + this->size, this->rows + level * this->size );
+
+				}
+				this->count++;
+
+			}
+
+			/*
+			 * The sum of all the rows added: the levels of the tree are added
+			 * from the lowest one, each one as the left operand.
+			 */
+			void result( Accumulator* sums ) const {
+
+				std::size_t level;
+				if ( this->policy == COMPENSATED_SUMMATION ) {
+					for( std::size_t l=0; l < this->size; l++ ) {
+						sums[ l ] = this->rows[ l ] + this->rows[ this->size + l ];
+					}
+					return;
+				}
+				std::fill( sums, sums + this->size, (Accumulator) 0 );
+				bool empty = true;
+				for( level=0; this->count >> level; level++ ) {
+					if ( this->count >> level & 1 ) {
+						const Accumulator* row = this->rows + level * this->size;
+						for( std::size_t l=0; l < this->size; l++ ) {
+							sums[ l ] = empty? row[ l ]: row[ l ] + sums[ l ];
+						}
+						empty = false;
+					}
+				}
+
+			}
+		};
+
+		/*
+		 * Number of rows of the scratch of a reduction block (see
+		 * BlockAccumulation): the sums of a tile followed by the rows
+		 * of their summation.
+		 */
+		inline std::size_t blockScratchRows( SummationPolicy policy ) {
+			return policy == NAIVE_SUMMATION? 0: 1 + Summation< double >::rowsOf( policy, BLOCK_SIZE / TILE_SIZE );
+		}
+
+		/*
+		 * Accumulation of the sums of one reduction block into its partial
+		 * sums (the objective function followed by the constraints).
+		 */
+		template< typename T, typename Accumulator, typename Index, typename Violations >
+		struct BlockAccumulation {
+			const kernels::Kernels< T, Accumulator >& kernel;
+			Index populationSize;
+			Index numberOfConstraints;
+			const T* objectiveFunctionValues;
+			const Violations& constraintViolationValues;
+			//if not null, the numbers of violated constraints and the
+			//feasibility bitmap are recorded
+			unsigned int* violatedConstraints;
+			std::uint64_t* feasibleCandidates;
+			//if not null, the number of feasible candidate solutions followed by
+			//the numbers of violations of the constraints (which requires
+			//'violatedConstraints'), with the same layout as the partial sums
+			//but without the objective function
+			Index* counts;
+			Accumulator* partialSums;
+			//distance between the partial sums of two blocks (0 if all the blocks share them)
+			std::size_t partialStride;
+			//unless the policy is NAIVE_SUMMATION, the tiles are added with the
+			//policy in a scratch of 'blockScratchRows' rows for each block, with
+			//the layout of the partial sums
+			SummationPolicy summation;
+			Accumulator* scratch;
+
+			void operator()( int block ) const {
+
+				Accumulator* partial = this->partialSums + block * this->partialStride;
+				const Index begin = (Index) block * BLOCK_SIZE;
+				const Index end = endOfBlock( (Index) block, this->populationSize );
+				const std::size_t partialSize = (std::size_t) this->numberOfConstraints + 1;
+				const bool naive = this->summation == NAIVE_SUMMATION;
+				Accumulator* tileSums = naive? partial:
+					this->scratch + ( this->partialStride? block * blockScratchRows( this->summation ) * partialSize: 0 );
+				Summation< Accumulator > tiles( this->summation, partialSize, tileSums + partialSize );
+
+				Index* counts = this->counts? this->counts + block * this->partialStride: 0;
+				for( Index l=0; l <= this->numberOfConstraints; l++ ) {
+					partial[ l ] = 0;
+					if ( counts ) {
+						counts[ l ] = 0;
+					}
+				}
+				if ( naive ) {
+					for( Index i=begin; i < end; i++ ) {
+						partial[ 0 ] += (Accumulator) this->objectiveFunctionValues[ i ];
+					}
+				}
+
+				//the block is read in tiles, which preserves the order of the sums of each constraint
+				for( Index tile=begin; tile < end; tile += TILE_SIZE ) {
+
+					const Index size = end - tile < TILE_SIZE? end - tile: TILE_SIZE;
+					unsigned int* violated = this->violatedConstraints? this->violatedConstraints + tile: 0;
+					if ( !naive ) {
+						std::fill( tileSums, tileSums + partialSize, (Accumulator) 0 );
+						for( Index i=tile; i < tile + size; i++ ) {
+							tileSums[ 0 ] += (Accumulator) this->objectiveFunctionValues[ i ];
+						}
+					}
+					this->constraintViolationValues.accumulate( this->kernel, tileSums + 1, violated, tile, size, this->numberOfConstraints );
+					if ( !naive ) {
+						tiles.add( tileSums );
+					}
+					if ( !violated ) {
+						continue;
+					}
+					if ( counts ) {
+						//the tile is still in the cache
+						this->constraintViolationValues.countViolations( counts + 1, tile, size, this->numberOfConstraints );
+						for( Index k=0; k < size; k++ ) {
+							counts[ 0 ] += violated[ k ] == 0;
+						}
+					}
+
+					//the tiles start at multiples of 64, thus the words of the bitmap are not shared by two blocks
+					for( Index k=0; k < size; k += 64 ) {
+
+						std::uint64_t word = 0;
+						const Index bits = size - k < 64? size - k: 64;
+						for( Index bit=0; bit < bits; bit++ ) {
+							word |= (std::uint64_t) ( violated[ k + bit ] == 0 ) << bit;
+						}
+						this->feasibleCandidates[ ( tile + k ) / 64 ] = word;
+
+					}
+
+				}
+				if ( !naive ) {
+					tiles.result( partial );
+				}
+
+			}
+		};
+
+		/*
+		 * Calculation of the fitness values of one reduction block.
+		 */
+		template< typename T, typename Accumulator, typename Index, int Constraints, typename Violations >
+		struct BlockPenalization {
+			const kernels::Kernels< T, Accumulator >& kernel;
+			Index populationSize;
+			Index numberOfConstraints;
+			const T* objectiveFunctionValues;
+			const Violations& constraintViolationValues;
+			const T* penaltyCoefficients;
+			//if not null, only the infeasible candidate solutions are penalized
+			const std::uint64_t* feasibleCandidates;
+			Accumulator averageObjectiveFunctionValues;
+			T* fitnessValues;
+			//if not null, the penalties of each block are recorded
+			PenaltyRange< Accumulator, Index >* penaltyRanges;
+			//if not null, the 'selectionSize' best candidate solutions of each
+			//block ('selectionSize' apart, at most BLOCK_SIZE) and their numbers are recorded
+			Index selectionSize;
+			Index* selections;
+			Index* selectionCounts;
+
+			/*
+			 * Select the best candidate solutions of a block, whose fitness
+			 * values are still in the cache, with a heap whose top is the
+			 * worst one selected.
+			 */
+			void select( int block, Index begin, Index end ) const {
+
+				const FitnessOrder< T, Index > order = { this->fitnessValues };
+				Index* selected = this->selections + (std::size_t) block * (std::size_t) this->selectionSize;
+				Index count = 0;
+				for( Index i=begin; i < end; i++ ) {
+
+					if ( count < this->selectionSize ) {
+						selected[ count++ ] = i;
+						std::push_heap( selected, selected + count, order );
+					} else if ( order( i, selected[ 0 ] ) ) {
+						std::pop_heap( selected, selected + count, order );
+						selected[ count - 1 ] = i;
+						std::push_heap( selected, selected + count, order );
+					}
+
+				}
+				this->selectionCounts[ block ] = count;
+
+			}
+
+			void operator()( int block ) const {
+
+				const Index begin = (Index) block * BLOCK_SIZE;
+				const Index end = endOfBlock( (Index) block, this->populationSize );
+				const Accumulator average = this->averageObjectiveFunctionValues;
+				PenaltyRange< Accumulator, Index >* range = this->penaltyRanges? this->penaltyRanges + block: 0;
+				if ( range ) {
+					range->count = 0;
+				}
+
+				if ( this->feasibleCandidates ) {
+
+					bool violated;
+					//the fitness of a feasible candidate solution is a copy of its objective
+					//function value; only the violations of the infeasible ones are read
+					for( Index first=begin; first < end; first += 64 ) {
+
+						const Index bits = end - first < 64? end - first: 64;
+						const std::uint64_t valid = bits < 64? ( (std::uint64_t) 1 << bits ) - 1: ~(std::uint64_t) 0;
+						std::uint64_t feasible = this->feasibleCandidates[ first / 64 ] & valid;
+						std::uint64_t infeasible = ~feasible & valid;
+						for( ; feasible; feasible &= feasible - 1 ) {
+							const Index i = first + lowestBit( feasible );
+							this->fitnessValues[ i ] = this->objectiveFunctionValues[ i ];
+						}
+						for( ; infeasible; infeasible &= infeasible - 1 ) {
+
+							const Index i = first + lowestBit( infeasible );
+							const Accumulator penalty = this->constraintViolationValues.template penalty< Accumulator, Constraints >( i,
+								this->numberOfConstraints, this->penaltyCoefficients, violated );
+							const Accumulator objective = this->objectiveFunctionValues[ i ];
+							this->fitnessValues[ i ] = (T) ( objective > average? objective + penalty: average + penalty );
+							if ( range ) {
+								range->add( penalty );
+							}
+
+						}
+
+					}
+					if ( this->selections ) {
+						this->select( block, begin, end );
+					}
+					return;
+
+				}
+
+				//the penalties of a tile of candidate solutions are calculated together;
+				//each penalty receives its terms in the order of the constraints
+				Accumulator penalty[ TILE_SIZE ];
+				unsigned char violated[ TILE_SIZE ];
+				for( Index tile=begin; tile < end; tile += TILE_SIZE ) {
+
+					const Index size = end - tile < TILE_SIZE? end - tile: TILE_SIZE;
+					this->constraintViolationValues.penalties( this->kernel, penalty, violated, tile, size,
+						this->numberOfConstraints, this->penaltyCoefficients );
+
+					for( Index k=0; k < size; k++ ) {
+
+						//the fitness is the sum of the objective function and penalty values
+						//if the candidate solution is infeasible and just the objective function value,
+						//otherwise
+						const T objective = this->objectiveFunctionValues[ tile + k ];
+						this->fitnessValues[ tile + k ] = violated[ k ] ?
+							(T) ( (Accumulator) objective > average? (Accumulator) objective + penalty[ k ]: average + penalty[ k ] ) :
+							objective;
+
+					}
+					if ( range ) {
+						for( Index k=0; k < size; k++ ) {
+							if ( violated[ k ] ) {
+								range->add( penalty[ k ] );
+							}
+						}
+					}
+
+				}
+				if ( this->selections ) {
+					this->select( block, begin, end );
+				}
+
+			}
+		};
+
+		/*
+		 * Calculate the average of the objective function values and the
+		 * penalty coefficients from the sums over a population. Return the average.
+		 * If 'normalizationFactors' is not null, the coefficients are the ones
+		 * of the violations multiplied by the factors, multiplied by the factors
+		 * (see BasicAdaptivePenaltyMethod::setConstraintNormalization).
+		 */
+		template< typename T, typename Accumulator, typename Index >
+		Accumulator penaltyCoefficientsOf(
+			Accumulator sumObjectiveFunction,
+			Index populationSize,
+			Index numberOfConstraints,
+			const Accumulator* sumViolation,
+			T* penaltyCoefficients,
+			const Accumulator* normalizationFactors = 0 ) {
+
+			Index j;
+			Index l;
+			//the absolute of the sumObjectiveFunction
+			if ( sumObjectiveFunction < 0 ) {
+				sumObjectiveFunction = -sumObjectiveFunction;
+			}
+
+			//the denominator of the equation of the penalty coefficients
+			Accumulator denominator = 0;
+			for( l=0; l < numberOfConstraints; l++ ) {
+				const Accumulator sum = normalizationFactors? normalizationFactors[ l ] * sumViolation[ l ]: sumViolation[ l ];
+				denominator += sum * sum;
+			}
+
+			//the penalty coefficients are calculated
+			for( j=0; j < numberOfConstraints; j++ ) {
+
+				if ( normalizationFactors ) {
+					//the sum of the normalized violations and the factor of the violations as given
+					penaltyCoefficients[ j ] = (T) ( denominator == 0? 0:
+						( ( sumObjectiveFunction / denominator ) * ( normalizationFactors[ j ] * sumViolation[ j ] ) ) * normalizationFactors[ j ] );
+				} else {
+					penaltyCoefficients[ j ] = (T) ( denominator == 0? 0: ( sumObjectiveFunction / denominator ) * sumViolation[ j ] );
+				}
+
+			}
+
+			//average of the objective function values
+			return sumObjectiveFunction / populationSize;
+
+		}
+
+		/*
+		 * Accumulation of the sums of one population of a batch: the
+		 * objective function followed by the constraints. The blocks of
+		 * the population are added in order, as for a single population.
+		 */
+		template< typename T, typename Accumulator, typename Index >
+		struct PopulationAccumulation {
+			const kernels::Kernels< T, Accumulator >& kernel;
+			Index numberOfConstraints;
+			const Index* populationOffsets;
+			const T* objectiveFunctionValues;
+			const StridedMatrix< T, Index >& constraintViolationValues;
+			//the partial sums of a block and the sums of each population
+			Accumulator* partialSums;
+			Accumulator* populationSums;
+			//if not null, the coefficients and the averages are also calculated
+			T* penaltyCoefficients;
+			Accumulator* averageObjectiveFunctionValues;
+			//the factors of the constraints, if not null (see 'penaltyCoefficientsOf')
+			const Accumulator* normalizationFactors;
+			//unless the policy is NAIVE_SUMMATION, the scratch of the blocks
+			//followed by the rows of the summation of the blocks, for each
+			//population ('scratchStride' values apart)
+			SummationPolicy summation;
+			Accumulator* scratch;
+			std::size_t scratchStride;
+
+			void operator()( int population ) const {
+
+				const std::size_t size = (std::size_t) this->numberOfConstraints + 1;
+				const Index first = this->populationOffsets[ population ];
+				const Index populationSize = this->populationOffsets[ population + 1 ] - first;
+				const StridedMatrix< T, Index > matrix = this->constraintViolationValues.from( first );
+				Accumulator* partial = this->partialSums + population * size;
+				Accumulator* sums = this->populationSums + population * size;
+				Accumulator* scratch = this->scratch? this->scratch + population * this->scratchStride: 0;
+				const BlockAccumulation< T, Accumulator, Index, StridedMatrix< T, Index > > accumulation = { this->kernel,
+					populationSize, this->numberOfConstraints, this->objectiveFunctionValues + first, matrix, 0, 0, 0, partial, 0,
+					this->summation, scratch };
+				Summation< Accumulator > summation( this->summation, size, scratch? scratch + blockScratchRows( this->summation ) * size: 0 );
+
+				for( Index l=0; l <= this->numberOfConstraints; l++ ) {
+					sums[ l ] = 0;
+				}
+				const Index blocks = numberOfBlocks( populationSize );
+				for( Index b=0; b < blocks; b++ ) {
+
+					accumulation( (int) b );
+					if ( this->summation != NAIVE_SUMMATION ) {
+						summation.add( partial );
+						continue;
+					}
+					for( Index l=0; l <= this->numberOfConstraints; l++ ) {
+						sums[ l ] += partial[ l ];
+					}
+
+				}
+				if ( this->summation != NAIVE_SUMMATION ) {
+					summation.result( sums );
+				}
+
+				if ( this->penaltyCoefficients ) {
+					this->averageObjectiveFunctionValues[ population ] = penaltyCoefficientsOf( sums[ 0 ], populationSize,
+						this->numberOfConstraints, sums + 1, this->penaltyCoefficients + population * this->numberOfConstraints,
+						this->normalizationFactors );
+				}
+
+			}
+		};
+
+		/*
+		 * Calculation of the fitness values of one population of a batch.
+		 */
+		template< typename T, typename Accumulator, typename Index, int Constraints >
+		struct PopulationPenalization {
+			const kernels::Kernels< T, Accumulator >& kernel;
+			Index numberOfConstraints;
+			const Index* populationOffsets;
+			const T* objectiveFunctionValues;
+			const StridedMatrix< T, Index >& constraintViolationValues;
+			const T* penaltyCoefficients;
+			//distance between the coefficients of two populations (0 if they are shared)
+			std::size_t coefficientStride;
+			const Accumulator* averageObjectiveFunctionValues;
+			Accumulator sharedAverage;
+			T* fitnessValues;
+
+			void operator()( int population ) const {
+
+				const Index first = this->populationOffsets[ population ];
+				const Index populationSize = this->populationOffsets[ population + 1 ] - first;
+				const StridedMatrix< T, Index > matrix = this->constraintViolationValues.from( first );
+				const BlockPenalization< T, Accumulator, Index, Constraints, StridedMatrix< T, Index > > penalization = { this->kernel,
+					populationSize, this->numberOfConstraints, this->objectiveFunctionValues + first, matrix,
+					this->penaltyCoefficients + population * this->coefficientStride, 0,
+					this->averageObjectiveFunctionValues? this->averageObjectiveFunctionValues[ population ]: this->sharedAverage,
+					this->fitnessValues + first, 0, 0, 0, 0 };
+
+				const Index blocks = numberOfBlocks( populationSize );
+				for( Index b=0; b < blocks; b++ ) {
+					penalization( (int) b );
+				}
+
+			}
+		};
+
+	}
+
+	/*
+	 * Method to calculate the fitness of a population with the snapshot.
+	 */
+	template< typename T, typename Accumulator >
+	void CoefficientSnapshot< T, Accumulator >::calculateFitness(
+		T* fitnessValues,
+		std::size_t populationSize,
+		const T* objectiveFunctionValues,
+		const T* const* constraintViolationValues,
+		int threadCount ) const {
+
+		const detail::RowTable< T, std::ptrdiff_t, 0 > rows = { const_cast< T* const* >( constraintViolationValues ), this->constraintKinds( ) };
+		this->penalize( fitnessValues, populationSize, objectiveFunctionValues, rows, threadCount );
+
+	}
+
+
+	/*
+	 * Method to calculate the fitness of a population from a contiguous matrix with the snapshot.
+	 */
+	template< typename T, typename Accumulator >
+	void CoefficientSnapshot< T, Accumulator >::calculateFitness(
+		T* fitnessValues,
+		std::size_t populationSize,
+		const T* objectiveFunctionValues,
+		const T* constraintViolationValues,
+		ViolationLayout layout,
+		std::size_t leadingDimension,
+		int threadCount ) const {
+
+		const detail::StridedMatrix< T, std::ptrdiff_t > matrix( constraintViolationValues, layout, leadingDimension, this->constraintKinds( ) );
+		this->penalize( fitnessValues, populationSize, objectiveFunctionValues, matrix, threadCount );
+
+	}
+
+
+	/*
+	 * Method to calculate the fitness values block by block with the snapshot.
+	 */
+	template< typename T, typename Accumulator >
+	template< typename Violations >
+	void CoefficientSnapshot< T, Accumulator >::penalize(
+		T* fitnessValues,
+		std::size_t populationSize,
+		const T* objectiveFunctionValues,
+		const Violations& constraintViolationValues,
+		int threadCount ) const {
+
+		//the blocks are the ones of BasicAdaptivePenaltyMethod::penalize, without statistics nor selection
+		const std::ptrdiff_t blocks = detail::numberOfBlocks( (std::ptrdiff_t) populationSize );
+		detail::BlockPenalization< T, Accumulator, std::ptrdiff_t, 0, Violations > penalization = { kernels::active< T, Accumulator >( ),
+			(std::ptrdiff_t) populationSize, (std::ptrdiff_t) this->penaltyCoefficients.size( ), objectiveFunctionValues,
+			constraintViolationValues, this->penaltyCoefficients.data( ), 0, this->averageObjectiveFunctionValues, fitnessValues,
+			0, 0, 0, 0 };
+		ThreadPool::shared( ).run( threadCount > 0? threadCount: ThreadPool::hardwareConcurrency( ), (int) blocks, penalization );
+
+	}
+
+
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	const int BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::REDUCTION_BLOCK_SIZE;
+
+	static_assert( detail::BLOCK_SIZE == BasicAdaptivePenaltyMethod< double >::REDUCTION_BLOCK_SIZE,
+		"the size of the reduction blocks must be the same" );
+
+	static_assert( std::is_nothrow_move_constructible< BasicAdaptivePenaltyMethod< double > >::value &&
+		std::is_nothrow_move_assignable< BasicAdaptivePenaltyMethod< double > >::value,
+		"the objects must be moved without allocations, e.g. by std::vector" );
+
+	/*
+	 * Constructor.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::BasicAdaptivePenaltyMethod(
+		const Index numberOfConstraints,
+		std::pmr::memory_resource* resource ):
+		sumViolation( detail::ConstraintSums< Accumulator, Constraints >::allocate( numberOfConstraints, resource ) ),
+		numberOfConstraints( numberOfConstraints ),
+		averageObjectiveFunctionValues(0),
+		threadCount( 1 ),
+		sumObjectiveFunction( 0 ),
+		populationSize( 0 ),
+		numberOfUpdates( 0 ),
+		resynchronizationInterval( 0 ),
+		staleSums( false ),
+		partialSums( resource ),
+		feasibilityTracking( false ),
+		violatedConstraints( resource ),
+		feasibleCandidates( resource ),
+		chunkSums( resource ),
+		chunkBlockSizes( resource ),
+		coefficients( numberOfConstraints, (T) 0, resource ),
+		newCoefficients( numberOfConstraints, resource ),
+		coefficientUpdate( REPLACE_COEFFICIENTS ),
+		updateInterval( 1 ),
+		smoothingFactor( (T) 0.5 ),
+		generation( 0 ),
+		coefficientUpdates( 0 ),
+		statistics( numberOfConstraints, resource ),
+		blockCounts( resource ),
+		constraintScales( resource ),
+		tolerances( resource ),
+		selectionSize( 0 ),
+		bestIndividuals( resource ),
+		coefficientVersion( 0 ),
+		summationPolicy( NAIVE_SUMMATION ),
+		normalizationFactors( resource ),
+		violationMaxima( resource ),
+		adaptiveNormalization( false ),
+		normalizationDecay( 1 ) {
+
+		if ( Constraints > 0 && numberOfConstraints != Constraints ) {
+			throw std::invalid_argument( "the number of constraints differs from the one of the class" );
+		}
+
+	}
+
+	/*
+	 * Destructor.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::~BasicAdaptivePenaltyMethod( ) {
+	}
+
+
+	/*
+	 * Method to set the number of threads.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::setThreadCount( int threadCount ) {
+		this->threadCount = threadCount > 0? threadCount: ThreadPool::hardwareConcurrency( );
+	}
+
+
+	/*
+	 * Method to accumulate the sums over the population block by block.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	template< typename Violations >
+	Accumulator BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::accumulate(
+		Index populationSize,
+		const T* objectiveFunctionValues,
+		const Violations& constraintViolationValues,
+		bool recordFeasibility ) {
+
+		Index b;
+		Index l;
+		const detail::Stopwatch< Instrumented > stopwatch;
+		const Index blocks = detail::numberOfBlocks( populationSize );
+		const Index partialSize = this->numberOfConstraints + 1;
+		const bool parallel = this->threadCount > 1 && blocks > 1;
+
+		//the instrumented classes count the violations with the feasibility
+		recordFeasibility = recordFeasibility || Instrumented;
+		if ( Instrumented ) {
+			this->blockCounts.resize( ( parallel? blocks: 1 ) * partialSize );
+		}
+		if ( recordFeasibility ) {
+			this->violatedConstraints.resize( populationSize );
+			this->feasibleCandidates.resize( ( populationSize + 63 ) / 64 );
+		}
+
+		//in parallel, each block has its own partial sums; otherwise,
+		//the blocks are added as soon as they are calculated. Unless the
+		//summation is naive, they are followed by the scratch of the blocks
+		//and by the rows of the summation of the blocks
+		const std::size_t partials = (std::size_t) ( parallel? blocks: 1 ) * partialSize;
+		const std::size_t scratchSize = partials * detail::blockScratchRows( this->summationPolicy );
+		const bool naive = this->summationPolicy == NAIVE_SUMMATION;
+		this->partialSums.resize( partials + ( naive? 0: scratchSize +
+			detail::Summation< Accumulator >::rowsOf( this->summationPolicy, blocks ) * partialSize ) );
+		detail::BlockAccumulation< T, Accumulator, Index, Violations > accumulation = { kernels::active< T, Accumulator >( ),
+			populationSize, this->numberOfConstraints, objectiveFunctionValues, constraintViolationValues,
+			recordFeasibility? this->violatedConstraints.data( ): 0, recordFeasibility? this->feasibleCandidates.data( ): 0,
+			Instrumented? this->blockCounts.data( ): 0, &this->partialSums[ 0 ], parallel? (std::size_t) partialSize: 0,
+			this->summationPolicy, naive? 0: &this->partialSums[ partials ] };
+		detail::Summation< Accumulator > summation( this->summationPolicy, partialSize,
+			naive? 0: &this->partialSums[ partials + scratchSize ] );
+
+		Accumulator sumObjectiveFunction = 0;
+		for( l=0; l < this->numberOfConstraints; l++ ) {
+			this->sumViolation[ l ] = 0;
+		}
+		//the sums become exact again
+		this->numberOfUpdates = 0;
+		this->staleSums = false;
+
+		if ( parallel ) {
+			ThreadPool::shared( ).run( this->threadCount, (int) blocks, accumulation );
+		}
+		//the partial sums are added in the order of the blocks
+		for( b=0; b < blocks; b++ ) {
+
+			if ( !parallel ) {
+				accumulation( (int) b );
+			}
+			const Accumulator* partial = &this->partialSums[ parallel? b * partialSize: 0 ];
+			if ( naive ) {
+				sumObjectiveFunction += partial[ 0 ];
+				for( l=0; l < this->numberOfConstraints; l++ ) {
+					this->sumViolation[ l ] += partial[ l + 1 ];
+				}
+			} else {
+				summation.add( partial );
+			}
+			if constexpr ( Instrumented ) {
+				const Index* counts = &this->blockCounts[ parallel? b * partialSize: 0 ];
+				if ( b == 0 ) {
+					this->statistics.feasibleCandidates = 0;
+					std::fill( this->statistics.violatingCandidates.begin( ), this->statistics.violatingCandidates.end( ), 0 );
+				}
+				this->statistics.feasibleCandidates += counts[ 0 ];
+				for( l=0; l < this->numberOfConstraints; l++ ) {
+					this->statistics.violatingCandidates[ l ] += counts[ l + 1 ];
+				}
+			}
+
+		}
+
+		if ( !naive ) {
+			//the first partial sums receive the sums of the population
+			summation.result( &this->partialSums[ 0 ] );
+			sumObjectiveFunction = this->partialSums[ 0 ];
+			for( l=0; l < this->numberOfConstraints; l++ ) {
+				this->sumViolation[ l ] = this->partialSums[ l + 1 ];
+			}
+		}
+
+		if constexpr ( Instrumented ) {
+			this->statistics.accumulationTime = stopwatch.elapsed( );
+		}
+		return sumObjectiveFunction;
+
+	}
+
+
+	/*
+	 * Method to calculate the fitness values block by block.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	template< typename Violations >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::penalize(
+		T* fitnessValues,
+		Index populationSize,
+		const T* objectiveFunctionValues,
+		const Violations& constraintViolationValues,
+		const T* penaltyCoefficients,
+		const std::uint64_t* feasibility,
+		Statistics* statistics,
+		detail::Buffer< Index >* bestIndividuals ) const {
+
+		const detail::Stopwatch< Instrumented > stopwatch;
+		const Index blocks = detail::numberOfBlocks( populationSize );
+		detail::Buffer< detail::PenaltyRange< Accumulator, Index > > ranges( this->partialSums.get_allocator( ) );
+		if ( Instrumented && statistics ) {
+			ranges.resize( blocks );
+		}
+		//each block selects its best candidate solutions, and the best of them are selected;
+		//a block has at most BLOCK_SIZE candidate solutions, so the buffer is not larger than the population
+		const Index selectionSize = bestIndividuals? std::min( this->selectionSize, populationSize ): 0;
+		const Index selectionStride = std::min( selectionSize, (Index) detail::BLOCK_SIZE );
+		detail::Buffer< Index > selections( this->partialSums.get_allocator( ) );
+		detail::Buffer< Index > selectionCounts( this->partialSums.get_allocator( ) );
+		if ( selectionSize > 0 ) {
+			selections.resize( (std::size_t) blocks * (std::size_t) selectionStride );
+			selectionCounts.resize( blocks );
+		}
+		detail::BlockPenalization< T, Accumulator, Index, Constraints, Violations > penalization = { kernels::active< T, Accumulator >( ),
+			populationSize, this->numberOfConstraints, objectiveFunctionValues, constraintViolationValues, penaltyCoefficients, feasibility,
+			this->averageObjectiveFunctionValues, fitnessValues, ranges.empty( )? 0: ranges.data( ),
+			selectionStride, selections.empty( )? 0: selections.data( ), selectionCounts.empty( )? 0: selectionCounts.data( ) };
+		ThreadPool::shared( ).run( this->threadCount, (int) blocks, penalization );
+
+		if ( bestIndividuals ) {
+
+			std::size_t b;
+			Index count = 0;
+			const detail::FitnessOrder< T, Index > order = { fitnessValues };
+			//the selections of the blocks are gathered (in place) and the best ones are sorted
+			for( b=0; b < selectionCounts.size( ); b++ ) {
+				count = (Index) ( std::copy( selections.begin( ) + b * (std::size_t) selectionStride,
+					selections.begin( ) + b * (std::size_t) selectionStride + selectionCounts[ b ], selections.begin( ) + count ) - selections.begin( ) );
+			}
+			std::partial_sort( selections.begin( ), selections.begin( ) + selectionSize, selections.begin( ) + count, order );
+			bestIndividuals->assign( selections.begin( ), selections.begin( ) + selectionSize );
+
+		}
+
+		if constexpr ( Instrumented ) {
+			if ( statistics ) {
+
+				//the ranges of the blocks are combined
+				detail::PenaltyRange< Accumulator, Index > range = { 0, 0, 0 };
+				for( const detail::PenaltyRange< Accumulator, Index >& block : ranges ) {
+					range.merge( block );
+				}
+				statistics->penalizedCandidates = range.count;
+				statistics->minimumPenalty = range.minimum;
+				statistics->maximumPenalty = range.maximum;
+				statistics->fitnessTime = stopwatch.elapsed( );
+
+			}
+		}
+
+	}
+
+
+	/*
+	 * Method to calculate the penalty coefficients.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::calculatePenaltyCoefficients (
+		Index populationSize,
+		T* objectiveFunctionValues,
+		T** constraintViolationValues,
+		T* penaltyCoefficients ) {
+
+		//the violations are accumulated row by row, which reads each row
+		//contiguously; each constraint still receives the violations in
+		//the order of the candidate solutions
+		const detail::RowTable< T, Index, Constraints > rows = { constraintViolationValues, this->constraintKinds( ) };
+		const Accumulator sumObjectiveFunction = this->accumulate( populationSize, objectiveFunctionValues, rows, this->feasibilityTracking );
+
+		this->finishPenaltyCoefficients( sumObjectiveFunction, populationSize, penaltyCoefficients );
+
+	}
+
+
+	/*
+	 * Method to calculate de fitness of the candidate solutions.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::calculateFitness(
+		T* fitnessValues,
+		Index populationSize,
+		T* objectiveFunctionValues,
+		T** constraintViolationValues,
+		T* penaltyCoefficients ) {
+
+		const detail::RowTable< T, Index, Constraints > rows = { constraintViolationValues, this->constraintKinds( ) };
+		this->penalize( fitnessValues, populationSize, objectiveFunctionValues, rows, penaltyCoefficients, 0, &this->statistics, &this->bestIndividuals );
+
+	}
+
+
+	/*
+	 * Method to calculate de fitness of the candidate solutions whose feasibility is known.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::calculateFitness(
+		T* fitnessValues,
+		Index populationSize,
+		T* objectiveFunctionValues,
+		T** constraintViolationValues,
+		T* penaltyCoefficients,
+		const std::uint64_t* feasibility ) {
+
+		const detail::RowTable< T, Index, Constraints > rows = { constraintViolationValues, this->constraintKinds( ) };
+		this->penalize( fitnessValues, populationSize, objectiveFunctionValues, rows, penaltyCoefficients, feasibility, &this->statistics, &this->bestIndividuals );
+
+	}
+
+
+	/*
+	 * Method to calculate de fitness of the candidate solutions whose feasibility
+	 * is known from a contiguous matrix.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::calculateFitness(
+		T* fitnessValues,
+		Index populationSize,
+		const T* objectiveFunctionValues,
+		const T* constraintViolationValues,
+		ViolationLayout layout,
+		std::size_t leadingDimension,
+		const T* penaltyCoefficients,
+		const std::uint64_t* feasibility ) {
+
+		const detail::StridedMatrix< T, Index > matrix( constraintViolationValues, layout, leadingDimension, this->constraintKinds( ) );
+		this->penalize( fitnessValues, populationSize, objectiveFunctionValues, matrix, penaltyCoefficients, feasibility, &this->statistics, &this->bestIndividuals );
+
+	}
+
+
+	/*
+	 * Method to calculate the penalty coefficients and the fitness
+	 * of the candidate solutions reading the constraint violations once.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::evaluateGeneration(
+		T* fitnessValues,
+		Index populationSize,
+		T* objectiveFunctionValues,
+		T** constraintViolationValues,
+		T* penaltyCoefficients ) {
+
+		//the feasible candidate solutions receive their fitness values while
+		//the violations are accumulated; only the infeasible ones are visited again
+		const detail::RowTable< T, Index, Constraints > rows = { constraintViolationValues, this->constraintKinds( ) };
+		const Accumulator sumObjectiveFunction = this->accumulate( populationSize, objectiveFunctionValues, rows, true );
+
+		this->finishPenaltyCoefficients( sumObjectiveFunction, populationSize, penaltyCoefficients );
+
+		this->penalize( fitnessValues, populationSize, objectiveFunctionValues, rows, penaltyCoefficients,
+			this->feasibleCandidates.data( ), &this->statistics, &this->bestIndividuals );
+
+	}
+
+
+	/*
+	 * Method to calculate the average of the objective function values
+	 * and the penalty coefficients from the accumulated sums.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::finishPenaltyCoefficients(
+		Accumulator sumObjectiveFunction,
+		Index populationSize,
+		T* penaltyCoefficients ) {
+
+		Index l;
+		const detail::Stopwatch< Instrumented > stopwatch;
+		this->sumObjectiveFunction = sumObjectiveFunction;
+		this->populationSize = populationSize;
+		this->coefficientVersion++;
+
+		//the incremental updates keep the factors, so the maxima decay once per population
+		if ( this->adaptiveNormalization && populationSize > 0 && this->numberOfUpdates == 0 ) {
+			//the running maxima of the average violations give the factors
+			for( l=0; l < this->numberOfConstraints; l++ ) {
+				const Accumulator average = this->sumViolation[ l ] / populationSize;
+				const Accumulator maximum = this->normalizationDecay * this->violationMaxima[ l ];
+				this->violationMaxima[ l ] = average > maximum? average: maximum;
+				if ( this->violationMaxima[ l ] > 0 ) {
+					this->normalizationFactors[ l ] = 1 / this->violationMaxima[ l ];
+				}
+			}
+		}
+		const Accumulator* factors = this->normalizationFactors.empty( )? 0: this->normalizationFactors.data( );
+		this->averageObjectiveFunctionValues = detail::penaltyCoefficientsOf( sumObjectiveFunction, populationSize,
+			this->numberOfConstraints, this->sumViolation.data( ), penaltyCoefficients, factors );
+
+		if constexpr ( Instrumented ) {
+
+			//the denominator is calculated as in 'penaltyCoefficientsOf'
+			this->statistics.denominator = 0;
+			for( l=0; l < this->numberOfConstraints; l++ ) {
+				const Accumulator sum = factors? factors[ l ] * this->sumViolation[ l ]: this->sumViolation[ l ];
+				this->statistics.sumViolation[ l ] = this->sumViolation[ l ];
+				this->statistics.denominator += sum * sum;
+			}
+			this->statistics.averageObjectiveFunctionValues = this->averageObjectiveFunctionValues;
+			this->statistics.coefficientTime = stopwatch.elapsed( );
+
+		}
+
+	}
+
+
+	/*
+	 * Method to update the sums with a candidate solution.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::updateSums(
+		int sign,
+		T objectiveFunctionValue,
+		const T* constraintViolationValues ) {
+
+		Index l;
+		if ( this->staleSums ) {
+			throw std::logic_error( "the sums must be recalculated after a change of the constraints" );
+		}
+		const kernels::ConstraintKinds< T > kinds = this->constraintKinds( );
+		if ( sign > 0 ) {
+			this->sumObjectiveFunction += (Accumulator) objectiveFunctionValue;
+			this->populationSize++;
+		} else {
+			this->sumObjectiveFunction -= (Accumulator) objectiveFunctionValue;
+			this->populationSize--;
+		}
+		for( l=0; l < this->numberOfConstraints; l++ ) {
+
+			const T violation = kernels::violationOf( constraintViolationValues[ l ], kinds, l );
+			if ( violation > 0 ) {
+				if ( sign > 0 ) {
+					this->sumViolation[ l ] += (Accumulator) violation;
+				} else {
+					this->sumViolation[ l ] -= (Accumulator) violation;
+					//the rounding errors must not make a sum negative
+					if ( this->sumViolation[ l ] < 0 ) {
+						this->sumViolation[ l ] = 0;
+					}
+				}
+			}
+
+		}
+		this->numberOfUpdates++;
+
+	}
+
+
+	/*
+	 * Method to update the penalty coefficients after an insertion.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::addIndividual(
+		T objectiveFunctionValue,
+		const T* constraintViolationValues,
+		T* penaltyCoefficients ) {
+
+		this->updateSums( 1, objectiveFunctionValue, constraintViolationValues );
+		this->finishPenaltyCoefficients( this->sumObjectiveFunction, this->populationSize, penaltyCoefficients );
+
+	}
+
+
+	/*
+	 * Method to update the penalty coefficients after a removal.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::removeIndividual(
+		T objectiveFunctionValue,
+		const T* constraintViolationValues,
+		T* penaltyCoefficients ) {
+
+		if ( this->populationSize <= 1 ) {
+			throw std::logic_error( "the population would become empty" );
+		}
+		this->updateSums( -1, objectiveFunctionValue, constraintViolationValues );
+		this->finishPenaltyCoefficients( this->sumObjectiveFunction, this->populationSize, penaltyCoefficients );
+
+	}
+
+
+	/*
+	 * Method to update the penalty coefficients after a replacement.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::replaceIndividual(
+		T oldObjectiveFunctionValue,
+		const T* oldConstraintViolationValues,
+		T newObjectiveFunctionValue,
+		const T* newConstraintViolationValues,
+		T* penaltyCoefficients ) {
+
+		this->updateSums( -1, oldObjectiveFunctionValue, oldConstraintViolationValues );
+		this->updateSums( 1, newObjectiveFunctionValue, newConstraintViolationValues );
+		//a replacement counts as a single update
+		this->numberOfUpdates--;
+		this->finishPenaltyCoefficients( this->sumObjectiveFunction, this->populationSize, penaltyCoefficients );
+
+	}
+
+
+	/*
+	 * Method to calculate the penalty coefficients from a contiguous matrix.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::calculatePenaltyCoefficients (
+		Index populationSize,
+		const T* objectiveFunctionValues,
+		const T* constraintViolationValues,
+		ViolationLayout layout,
+		std::size_t leadingDimension,
+		T* penaltyCoefficients ) {
+
+		//the rows (ROW_MAJOR) are read contiguously and the columns (COLUMN_MAJOR)
+		//are gathered; each constraint receives the violations in the order
+		//of the candidate solutions
+		const detail::StridedMatrix< T, Index > matrix( constraintViolationValues, layout, leadingDimension, this->constraintKinds( ) );
+		const Accumulator sumObjectiveFunction = this->accumulate( populationSize, objectiveFunctionValues, matrix, this->feasibilityTracking );
+
+		this->finishPenaltyCoefficients( sumObjectiveFunction, populationSize, penaltyCoefficients );
+
+	}
+
+
+	/*
+	 * Method to calculate de fitness of the candidate solutions from a contiguous matrix.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::calculateFitness(
+		T* fitnessValues,
+		Index populationSize,
+		const T* objectiveFunctionValues,
+		const T* constraintViolationValues,
+		ViolationLayout layout,
+		std::size_t leadingDimension,
+		const T* penaltyCoefficients ) {
+
+		const detail::StridedMatrix< T, Index > matrix( constraintViolationValues, layout, leadingDimension, this->constraintKinds( ) );
+		this->penalize( fitnessValues, populationSize, objectiveFunctionValues, matrix, penaltyCoefficients, 0, &this->statistics, &this->bestIndividuals );
+
+	}
+
+
+	/*
+	 * Method to calculate the penalty coefficients and the fitness of the
+	 * candidate solutions from a contiguous matrix reading it once.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::evaluateGeneration(
+		T* fitnessValues,
+		Index populationSize,
+		const T* objectiveFunctionValues,
+		const T* constraintViolationValues,
+		ViolationLayout layout,
+		std::size_t leadingDimension,
+		T* penaltyCoefficients ) {
+
+		const detail::StridedMatrix< T, Index > matrix( constraintViolationValues, layout, leadingDimension, this->constraintKinds( ) );
+		const Accumulator sumObjectiveFunction = this->accumulate( populationSize, objectiveFunctionValues, matrix, true );
+
+		this->finishPenaltyCoefficients( sumObjectiveFunction, populationSize, penaltyCoefficients );
+
+		this->penalize( fitnessValues, populationSize, objectiveFunctionValues, matrix, penaltyCoefficients,
+			this->feasibleCandidates.data( ), &this->statistics, &this->bestIndividuals );
+
+	}
+
+
+	/*
+	 * Method to calculate the penalty coefficients from sparse violations.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::calculatePenaltyCoefficients (
+		Index populationSize,
+		const T* objectiveFunctionValues,
+		const Index* violationOffsets,
+		const Index* violatedConstraints,
+		const T* violationValues,
+		T* penaltyCoefficients ) {
+
+		const detail::SparseRows< T, Index > violations = { violationOffsets, violatedConstraints, violationValues, this->constraintKinds( ) };
+		const Accumulator sumObjectiveFunction = this->accumulate( populationSize, objectiveFunctionValues, violations, this->feasibilityTracking );
+
+		this->finishPenaltyCoefficients( sumObjectiveFunction, populationSize, penaltyCoefficients );
+
+	}
+
+
+	/*
+	 * Method to calculate de fitness of the candidate solutions from sparse violations.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::calculateFitness(
+		T* fitnessValues,
+		Index populationSize,
+		const T* objectiveFunctionValues,
+		const Index* violationOffsets,
+		const Index* violatedConstraints,
+		const T* violationValues,
+		const T* penaltyCoefficients ) {
+
+		const detail::SparseRows< T, Index > violations = { violationOffsets, violatedConstraints, violationValues, this->constraintKinds( ) };
+		this->penalize( fitnessValues, populationSize, objectiveFunctionValues, violations, penaltyCoefficients, 0, &this->statistics, &this->bestIndividuals );
+
+	}
+
+
+	/*
+	 * Method to calculate the penalty coefficients and the fitness of the
+	 * candidate solutions from sparse violations reading them once.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::evaluateGeneration(
+		T* fitnessValues,
+		Index populationSize,
+		const T* objectiveFunctionValues,
+		const Index* violationOffsets,
+		const Index* violatedConstraints,
+		const T* violationValues,
+		T* penaltyCoefficients ) {
+
+		const detail::SparseRows< T, Index > violations = { violationOffsets, violatedConstraints, violationValues, this->constraintKinds( ) };
+		const Accumulator sumObjectiveFunction = this->accumulate( populationSize, objectiveFunctionValues, violations, true );
+
+		this->finishPenaltyCoefficients( sumObjectiveFunction, populationSize, penaltyCoefficients );
+
+		this->penalize( fitnessValues, populationSize, objectiveFunctionValues, violations, penaltyCoefficients,
+			this->feasibleCandidates.data( ), &this->statistics, &this->bestIndividuals );
+
+	}
+
+
+	/*
+	 * Method to calculate the sums of the populations of a batch.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	const Accumulator* BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::accumulateBatch(
+		Index numberOfPopulations,
+		const Index* populationOffsets,
+		const T* objectiveFunctionValues,
+		const T* constraintViolationValues,
+		ViolationLayout layout,
+		std::size_t leadingDimension,
+		T* penaltyCoefficients,
+		Accumulator* averageObjectiveFunctionValues ) {
+
+		const std::size_t size = (std::size_t) numberOfPopulations * ( this->numberOfConstraints + 1 );
+		const detail::StridedMatrix< T, Index > matrix( constraintViolationValues, layout, leadingDimension, this->constraintKinds( ) );
+
+		//the partial sums of the blocks followed by the sums of the populations
+		//and, unless the summation is naive, by the scratch of the populations
+		Index p;
+		Index blocks = 0;
+		for( p=0; p < numberOfPopulations; p++ ) {
+			blocks = std::max( blocks, detail::numberOfBlocks( populationOffsets[ p + 1 ] - populationOffsets[ p ] ) );
+		}
+		const std::size_t scratchStride = this->summationPolicy == NAIVE_SUMMATION? 0:
+			( detail::blockScratchRows( this->summationPolicy ) + detail::Summation< Accumulator >::rowsOf( this->summationPolicy, blocks ) ) *
+			( this->numberOfConstraints + 1 );
+		this->partialSums.resize( 2 * size + 1 + numberOfPopulations * scratchStride );
+		detail::PopulationAccumulation< T, Accumulator, Index > accumulation = { kernels::active< T, Accumulator >( ),
+			this->numberOfConstraints, populationOffsets, objectiveFunctionValues, matrix,
+			&this->partialSums[ 0 ], &this->partialSums[ size ], penaltyCoefficients, averageObjectiveFunctionValues,
+			this->normalizationFactors.empty( )? 0: this->normalizationFactors.data( ), this->summationPolicy, scratchStride? &this->partialSums[ 2 * size + 1 ]: 0, scratchStride };
+		ThreadPool::shared( ).run( this->threadCount, (int) numberOfPopulations, accumulation );
+
+		return &this->partialSums[ size ];
+
+	}
+
+
+	/*
+	 * Method to calculate the penalty coefficients of the populations of a batch.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::calculateBatchPenaltyCoefficients(
+		Index numberOfPopulations,
+		const Index* populationOffsets,
+		const T* objectiveFunctionValues,
+		const T* constraintViolationValues,
+		ViolationLayout layout,
+		std::size_t leadingDimension,
+		T* penaltyCoefficients,
+		Accumulator* averageObjectiveFunctionValues ) {
+
+		this->accumulateBatch( numberOfPopulations, populationOffsets, objectiveFunctionValues, constraintViolationValues,
+			layout, leadingDimension, penaltyCoefficients, averageObjectiveFunctionValues );
+
+	}
+
+
+	/*
+	 * Method to calculate the penalty coefficients of the union of the populations of a batch.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::calculatePooledPenaltyCoefficients(
+		Index numberOfPopulations,
+		const Index* populationOffsets,
+		const T* objectiveFunctionValues,
+		const T* constraintViolationValues,
+		ViolationLayout layout,
+		std::size_t leadingDimension,
+		T* penaltyCoefficients ) {
+
+		Index p;
+		Index l;
+		const Accumulator* sums = this->accumulateBatch( numberOfPopulations, populationOffsets, objectiveFunctionValues,
+			constraintViolationValues, layout, leadingDimension, 0, 0 );
+
+		//the sums of the populations are added in their order
+		Accumulator sumObjectiveFunction = 0;
+		Index populationSize = 0;
+		for( l=0; l < this->numberOfConstraints; l++ ) {
+			this->sumViolation[ l ] = 0;
+		}
+		for( p=0; p < numberOfPopulations; p++ ) {
+
+			const Accumulator* population = sums + p * ( this->numberOfConstraints + 1 );
+			sumObjectiveFunction += population[ 0 ];
+			populationSize += populationOffsets[ p + 1 ] - populationOffsets[ p ];
+			for( l=0; l < this->numberOfConstraints; l++ ) {
+				this->sumViolation[ l ] += population[ l + 1 ];
+			}
+
+		}
+		this->numberOfUpdates = 0;
+		this->staleSums = false;
+
+		this->finishPenaltyCoefficients( sumObjectiveFunction, populationSize, penaltyCoefficients );
+
+	}
+
+
+	/*
+	 * Method to calculate the fitness values of the populations of a batch.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::calculateBatchFitness(
+		T* fitnessValues,
+		Index numberOfPopulations,
+		const Index* populationOffsets,
+		const T* objectiveFunctionValues,
+		const T* constraintViolationValues,
+		ViolationLayout layout,
+		std::size_t leadingDimension,
+		const T* penaltyCoefficients,
+		const Accumulator* averageObjectiveFunctionValues ) {
+
+		const detail::StridedMatrix< T, Index > matrix( constraintViolationValues, layout, leadingDimension, this->constraintKinds( ) );
+		detail::PopulationPenalization< T, Accumulator, Index, Constraints > penalization = { kernels::active< T, Accumulator >( ),
+			this->numberOfConstraints, populationOffsets, objectiveFunctionValues, matrix, penaltyCoefficients,
+			averageObjectiveFunctionValues? (std::size_t) this->numberOfConstraints: 0,
+			averageObjectiveFunctionValues, this->averageObjectiveFunctionValues, fitnessValues };
+		ThreadPool::shared( ).run( this->threadCount, (int) numberOfPopulations, penalization );
+
+	}
+
+
+	/*
+	 * Method to accumulate the sums of a chunk of candidate solutions.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	template< typename Violations >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::accumulateChunkOf(
+		Index firstIndividual,
+		Index chunkSize,
+		const T* objectiveFunctionValues,
+		const Violations& constraintViolationValues ) {
+
+		Index b;
+		if ( firstIndividual < 0 || firstIndividual % detail::BLOCK_SIZE != 0 || chunkSize <= 0 ) {
+			throw std::invalid_argument( "a chunk must start at the beginning of a reduction block" );
+		}
+		const Index blocks = detail::numberOfBlocks( chunkSize );
+		const Index firstBlock = firstIndividual / detail::BLOCK_SIZE;
+		const std::size_t partialSize = (std::size_t) this->numberOfConstraints + 1;
+
+		//the blocks of the chunk are the ones of the population, so their
+		//partial sums are calculated outside the lock
+		//unless the summation is naive, the partial sums are followed by the scratch of the blocks
+		const std::size_t partials = blocks * partialSize;
+		detail::Buffer< Accumulator > partial( partials * ( 1 + detail::blockScratchRows( this->summationPolicy ) ),
+			this->chunkSums.get_allocator( ) );
+		detail::BlockAccumulation< T, Accumulator, Index, Violations > accumulation = { kernels::active< T, Accumulator >( ),
+			chunkSize, this->numberOfConstraints, objectiveFunctionValues, constraintViolationValues, 0, 0, 0, &partial[ 0 ], partialSize,
+			this->summationPolicy, this->summationPolicy == NAIVE_SUMMATION? 0: &partial[ partials ] };
+		ThreadPool::shared( ).run( this->threadCount, (int) blocks, accumulation );
+
+		std::lock_guard< std::mutex > lock( this->chunkMutex.mutex );
+		//the chunk is checked against the accumulated blocks before any of them is changed:
+		//only the last block of the population may be incomplete
+		const bool incomplete = chunkSize % detail::BLOCK_SIZE != 0;
+		for( b=0; b < (Index) this->chunkBlockSizes.size( ); b++ ) {
+
+			const Index size = this->chunkBlockSizes[ b ];
+			if ( size == 0 ) {
+				continue;
+			}
+			if ( b >= firstBlock && b < firstBlock + blocks ) {
+				throw std::invalid_argument( "a reduction block was already accumulated" );
+			}
+			if ( ( b < firstBlock && size != detail::BLOCK_SIZE ) || ( b >= firstBlock + blocks && incomplete ) ) {
+				throw std::invalid_argument( "only the last chunk may end inside a reduction block" );
+			}
+
+		}
+		if ( this->chunkBlockSizes.size( ) < (std::size_t) ( firstBlock + blocks ) ) {
+			this->chunkBlockSizes.resize( firstBlock + blocks, 0 );
+			this->chunkSums.resize( ( firstBlock + blocks ) * partialSize );
+		}
+		for( b=0; b < blocks; b++ ) {
+			this->chunkBlockSizes[ firstBlock + b ] = detail::endOfBlock( b, chunkSize ) - b * detail::BLOCK_SIZE;
+		}
+		std::copy( partial.begin( ), partial.begin( ) + partials, this->chunkSums.begin( ) + firstBlock * partialSize );
+
+	}
+
+
+	/*
+	 * Method to accumulate the sums of a chunk of candidate solutions.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::accumulateChunk(
+		Index firstIndividual,
+		Index chunkSize,
+		T* objectiveFunctionValues,
+		T** constraintViolationValues ) {
+
+		const detail::RowTable< T, Index, Constraints > rows = { constraintViolationValues, this->constraintKinds( ) };
+		this->accumulateChunkOf( firstIndividual, chunkSize, objectiveFunctionValues, rows );
+
+	}
+
+
+	/*
+	 * Method to accumulate the sums of a chunk of candidate solutions from a contiguous matrix.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::accumulateChunk(
+		Index firstIndividual,
+		Index chunkSize,
+		const T* objectiveFunctionValues,
+		const T* constraintViolationValues,
+		ViolationLayout layout,
+		std::size_t leadingDimension ) {
+
+		const detail::StridedMatrix< T, Index > matrix( constraintViolationValues, layout, leadingDimension, this->constraintKinds( ) );
+		this->accumulateChunkOf( firstIndividual, chunkSize, objectiveFunctionValues, matrix );
+
+	}
+
+
+	/*
+	 * Method to calculate the penalty coefficients from the accumulated chunks.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::finalize( T* penaltyCoefficients ) {
+
+		Index b;
+		Index l;
+		detail::Buffer< Accumulator > sums( this->chunkSums.get_allocator( ) );
+		detail::Buffer< Index > sizes( this->chunkBlockSizes.get_allocator( ) );
+		{
+			//the accumulation is restarted
+			std::lock_guard< std::mutex > lock( this->chunkMutex.mutex );
+			sums.swap( this->chunkSums );
+			sizes.swap( this->chunkBlockSizes );
+		}
+
+		//all the blocks but the last one must be complete
+		const Index blocks = (Index) sizes.size( );
+		Index populationSize = 0;
+		for( b=0; b < blocks; b++ ) {
+			if ( sizes[ b ] == 0 || ( b + 1 < blocks && sizes[ b ] != detail::BLOCK_SIZE ) ) {
+				throw std::logic_error( "the accumulated chunks do not form a population" );
+			}
+			populationSize += sizes[ b ];
+		}
+		if ( populationSize == 0 ) {
+			throw std::logic_error( "no chunk was accumulated" );
+		}
+
+		//the partial sums are added in the order of the blocks, as in 'accumulate'
+		const std::size_t partialSize = (std::size_t) this->numberOfConstraints + 1;
+		Accumulator sumObjectiveFunction = 0;
+		for( l=0; l < this->numberOfConstraints; l++ ) {
+			this->sumViolation[ l ] = 0;
+		}
+		this->numberOfUpdates = 0;
+		this->staleSums = false;
+		if ( this->summationPolicy != NAIVE_SUMMATION ) {
+
+			//the sums of the population are stored after the rows of the summation
+			const std::size_t rows = detail::Summation< Accumulator >::rowsOf( this->summationPolicy, blocks );
+			detail::Buffer< Accumulator > summed( ( rows + 1 ) * partialSize, sums.get_allocator( ) );
+			detail::Summation< Accumulator > summation( this->summationPolicy, partialSize, &summed[ 0 ] );
+			for( b=0; b < blocks; b++ ) {
+				summation.add( &sums[ b * partialSize ] );
+			}
+			summation.result( &summed[ rows * partialSize ] );
+			sumObjectiveFunction = summed[ rows * partialSize ];
+			for( l=0; l < this->numberOfConstraints; l++ ) {
+				this->sumViolation[ l ] = summed[ rows * partialSize + l + 1 ];
+			}
+			this->finishPenaltyCoefficients( sumObjectiveFunction, populationSize, penaltyCoefficients );
+			return;
+
+		}
+		for( b=0; b < blocks; b++ ) {
+
+			const Accumulator* partial = &sums[ b * partialSize ];
+			sumObjectiveFunction += partial[ 0 ];
+			for( l=0; l < this->numberOfConstraints; l++ ) {
+				this->sumViolation[ l ] += partial[ l + 1 ];
+			}
+
+		}
+
+		this->finishPenaltyCoefficients( sumObjectiveFunction, populationSize, penaltyCoefficients );
+
+	}
+
+
+	/*
+	 * Method to calculate de fitness of a chunk of candidate solutions.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::scoreChunk(
+		T* fitnessValues,
+		Index chunkSize,
+		T* objectiveFunctionValues,
+		T** constraintViolationValues,
+		T* penaltyCoefficients ) const {
+
+		const detail::RowTable< T, Index, Constraints > rows = { constraintViolationValues, this->constraintKinds( ) };
+		this->penalize( fitnessValues, chunkSize, objectiveFunctionValues, rows, penaltyCoefficients, 0, 0, 0 );
+
+	}
+
+
+	/*
+	 * Method to calculate de fitness of a chunk of candidate solutions from a contiguous matrix.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::scoreChunk(
+		T* fitnessValues,
+		Index chunkSize,
+		const T* objectiveFunctionValues,
+		const T* constraintViolationValues,
+		ViolationLayout layout,
+		std::size_t leadingDimension,
+		const T* penaltyCoefficients ) const {
+
+		const detail::StridedMatrix< T, Index > matrix( constraintViolationValues, layout, leadingDimension, this->constraintKinds( ) );
+		this->penalize( fitnessValues, chunkSize, objectiveFunctionValues, matrix, penaltyCoefficients, 0, 0, 0 );
+
+	}
+
+
+
+	/*
+	 * Method to calculate the sums over a shard of a population.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	template< typename Violations >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::calculateLocalSumsOf(
+		Index populationSize,
+		const T* objectiveFunctionValues,
+		const Violations& constraintViolationValues,
+		Accumulator* sums ) {
+
+		Index l;
+		sums[ 0 ] = this->accumulate( populationSize, objectiveFunctionValues, constraintViolationValues, this->feasibilityTracking );
+		for( l=0; l < this->numberOfConstraints; l++ ) {
+			sums[ l + 1 ] = this->sumViolation[ l ];
+		}
+
+	}
+
+
+	/*
+	 * Method to calculate the sums over a shard of a population.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::calculateLocalSums(
+		Index populationSize,
+		T* objectiveFunctionValues,
+		T** constraintViolationValues,
+		Accumulator* sums ) {
+
+		const detail::RowTable< T, Index, Constraints > rows = { constraintViolationValues, this->constraintKinds( ) };
+		this->calculateLocalSumsOf( populationSize, objectiveFunctionValues, rows, sums );
+
+	}
+
+
+	/*
+	 * Method to calculate the sums over a shard of a population from a contiguous matrix.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::calculateLocalSums(
+		Index populationSize,
+		const T* objectiveFunctionValues,
+		const T* constraintViolationValues,
+		ViolationLayout layout,
+		std::size_t leadingDimension,
+		Accumulator* sums ) {
+
+		const detail::StridedMatrix< T, Index > matrix( constraintViolationValues, layout, leadingDimension, this->constraintKinds( ) );
+		this->calculateLocalSumsOf( populationSize, objectiveFunctionValues, matrix, sums );
+
+	}
+
+
+	/*
+	 * Method to calculate the penalty coefficients from the sums over a population.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::calculatePenaltyCoefficientsFromSums(
+		const Accumulator* sums,
+		Index populationSize,
+		T* penaltyCoefficients ) {
+
+		Index l;
+		for( l=0; l < this->numberOfConstraints; l++ ) {
+			this->sumViolation[ l ] = sums[ l + 1 ];
+		}
+		//the sums are exact, as the ones of 'accumulate'
+		this->numberOfUpdates = 0;
+		this->staleSums = false;
+		this->finishPenaltyCoefficients( sums[ 0 ], populationSize, penaltyCoefficients );
+
+	}
+
+
+	/*
+	 * Method to set the update of the penalty coefficients owned by the object.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::setCoefficientUpdate(
+		CoefficientUpdate update,
+		std::size_t interval,
+		T smoothingFactor ) {
+
+		if ( interval == 0 ) {
+			throw std::invalid_argument( "the interval between two updates must be positive" );
+		}
+		if ( !( smoothingFactor > 0 && smoothingFactor <= 1 ) ) {
+			throw std::invalid_argument( "the smoothing factor must be in (0, 1]" );
+		}
+		this->coefficientUpdate = update;
+		this->updateInterval = interval;
+		this->smoothingFactor = smoothingFactor;
+		this->generation = 0;
+
+	}
+
+
+	/*
+	 * Method to update the penalty coefficients owned by the object.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	template< typename Violations >
+	bool BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::updateCoefficients(
+		Index populationSize,
+		const T* objectiveFunctionValues,
+		const Violations& constraintViolationValues,
+		bool recordFeasibility ) {
+
+		Index j;
+		const bool due = this->isCoefficientUpdateDue( );
+		this->generation++;
+		if ( !due ) {
+			//the pass over the population is skipped
+			return false;
+		}
+
+		const Accumulator sumObjectiveFunction = this->accumulate( populationSize, objectiveFunctionValues,
+			constraintViolationValues, recordFeasibility );
+		this->finishPenaltyCoefficients( sumObjectiveFunction, populationSize, this->newCoefficients.data( ) );
+
+		//the new coefficients are combined with the current ones
+		for( j=0; j < this->numberOfConstraints; j++ ) {
+
+			const T current = this->coefficients[ j ];
+			const T calculated = this->newCoefficients[ j ];
+			if ( this->coefficientUpdates == 0 || this->coefficientUpdate == REPLACE_COEFFICIENTS ) {
+				this->coefficients[ j ] = calculated;
+			} else if ( this->coefficientUpdate == SMOOTH_COEFFICIENTS ) {
+				this->coefficients[ j ] = this->smoothingFactor * calculated + ( 1 - this->smoothingFactor ) * current;
+			} else {
+				this->coefficients[ j ] = calculated > current? calculated: current;
+			}
+
+		}
+		this->coefficientUpdates++;
+		return true;
+
+	}
+
+
+	/*
+	 * Method to update the penalty coefficients owned by the object.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	bool BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::updatePenaltyCoefficients(
+		Index populationSize,
+		T* objectiveFunctionValues,
+		T** constraintViolationValues ) {
+
+		const detail::RowTable< T, Index, Constraints > rows = { constraintViolationValues, this->constraintKinds( ) };
+		return this->updateCoefficients( populationSize, objectiveFunctionValues, rows, this->feasibilityTracking );
+
+	}
+
+
+	/*
+	 * Method to update the penalty coefficients owned by the object from a contiguous matrix.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	bool BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::updatePenaltyCoefficients(
+		Index populationSize,
+		const T* objectiveFunctionValues,
+		const T* constraintViolationValues,
+		ViolationLayout layout,
+		std::size_t leadingDimension ) {
+
+		const detail::StridedMatrix< T, Index > matrix( constraintViolationValues, layout, leadingDimension, this->constraintKinds( ) );
+		return this->updateCoefficients( populationSize, objectiveFunctionValues, matrix, this->feasibilityTracking );
+
+	}
+
+
+	/*
+	 * Method to calculate the fitness of the candidate solutions with the
+	 * penalty coefficients owned by the object.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::evaluateGeneration(
+		T* fitnessValues,
+		Index populationSize,
+		T* objectiveFunctionValues,
+		T** constraintViolationValues ) {
+
+		//when the coefficients are updated, only the infeasible candidate solutions are visited again
+		const detail::RowTable< T, Index, Constraints > rows = { constraintViolationValues, this->constraintKinds( ) };
+		const bool updated = this->updateCoefficients( populationSize, objectiveFunctionValues, rows, true );
+		this->penalize( fitnessValues, populationSize, objectiveFunctionValues, rows, this->coefficients.data( ),
+			updated? this->feasibleCandidates.data( ): 0, &this->statistics, &this->bestIndividuals );
+
+	}
+
+
+	/*
+	 * Method to calculate the fitness of the candidate solutions from a contiguous
+	 * matrix with the penalty coefficients owned by the object.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::evaluateGeneration(
+		T* fitnessValues,
+		Index populationSize,
+		const T* objectiveFunctionValues,
+		const T* constraintViolationValues,
+		ViolationLayout layout,
+		std::size_t leadingDimension ) {
+
+		const detail::StridedMatrix< T, Index > matrix( constraintViolationValues, layout, leadingDimension, this->constraintKinds( ) );
+		const bool updated = this->updateCoefficients( populationSize, objectiveFunctionValues, matrix, true );
+		this->penalize( fitnessValues, populationSize, objectiveFunctionValues, matrix, this->coefficients.data( ),
+			updated? this->feasibleCandidates.data( ): 0, &this->statistics, &this->bestIndividuals );
+
+	}
+
+
+	/*
+	 * Method to make a snapshot of the coefficients.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	std::shared_ptr< const CoefficientSnapshot< T, Accumulator > > BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::makeSnapshot(
+		const T* penaltyCoefficients ) const {
+
+		const kernels::ConstraintKinds< T > kinds = this->constraintKinds( );
+		const detail::ResourceAllocator< CoefficientSnapshot< T, Accumulator > > allocator( this->coefficients.get_allocator( ) );
+		return std::allocate_shared< CoefficientSnapshot< T, Accumulator > >( allocator, (std::size_t) this->numberOfConstraints,
+			penaltyCoefficients, this->averageObjectiveFunctionValues, this->coefficientVersion, kinds.scales, kinds.tolerances,
+			this->coefficients.get_allocator( ).resource );
+
+	}
+
+
+	/*
+	 * Method to set the number of candidate solutions selected with the fitness values.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::setSelectionSize( Index selectionSize ) {
+
+		if ( selectionSize < 0 ) {
+			throw std::invalid_argument( "the number of selected candidate solutions must not be negative" );
+		}
+		this->selectionSize = selectionSize;
+		this->bestIndividuals.clear( );
+
+	}
+
+
+	/*
+	 * Method to set the kind of a constraint.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::setConstraintKind(
+		Index constraint,
+		ConstraintKind kind,
+		T tolerance ) {
+
+		Index j;
+		if ( constraint < 0 || constraint >= this->numberOfConstraints ) {
+			throw std::invalid_argument( "the constraint does not exist" );
+		}
+		if ( !( tolerance >= 0 ) ) {
+			throw std::invalid_argument( "the tolerance must not be negative" );
+		}
+		if ( kind == EQUALITY_CONSTRAINT && this->constraintScales.empty( ) ) {
+			//all the constraints were inequalities
+			this->constraintScales.assign( this->numberOfConstraints, (T) 0 );
+			this->tolerances.assign( this->numberOfConstraints, (T) 0 );
+		}
+		if ( this->constraintScales.empty( ) ) {
+			return;
+		}
+		this->constraintScales[ constraint ] = kind == EQUALITY_CONSTRAINT? (T) -1: (T) 0;
+		this->tolerances[ constraint ] = kind == EQUALITY_CONSTRAINT? tolerance: (T) 0;
+		this->coefficientVersion++;
+		this->invalidateSums( );
+
+		//the kernels for inequalities only are used again if there are no equalities
+		for( j=0; j < this->numberOfConstraints; j++ ) {
+			if ( this->constraintScales[ j ] != 0 ) {
+				return;
+			}
+		}
+		this->constraintScales.clear( );
+		this->tolerances.clear( );
+
+	}
+
+
+	/*
+	 * Method to set the factor of the violations of a constraint.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::setConstraintNormalization(
+		Index constraint,
+		T factor ) {
+
+		if ( constraint < 0 || constraint >= this->numberOfConstraints ) {
+			throw std::invalid_argument( "the constraint does not exist" );
+		}
+		if ( !( factor > 0 ) ) {
+			throw std::invalid_argument( "the factor must be positive" );
+		}
+		if ( this->normalizationFactors.empty( ) ) {
+			this->normalizationFactors.assign( this->numberOfConstraints, (Accumulator) 1 );
+		}
+		this->normalizationFactors[ constraint ] = factor;
+		this->coefficientVersion++;
+
+	}
+
+
+	/*
+	 * Method to enable or disable the adaptive normalization of the constraints.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::setAdaptiveNormalization(
+		bool enabled,
+		T decay ) {
+
+		if ( !( decay >= 0 && decay <= 1 ) ) {
+			throw std::invalid_argument( "the decay must be in [0, 1]" );
+		}
+		this->adaptiveNormalization = enabled;
+		this->normalizationDecay = decay;
+		if ( enabled ) {
+			if ( this->normalizationFactors.empty( ) ) {
+				this->normalizationFactors.assign( this->numberOfConstraints, (Accumulator) 1 );
+			}
+			this->violationMaxima.assign( this->numberOfConstraints, (Accumulator) 0 );
+		}
+
+	}
+
+
+	/*
+	 * Method to remove the factors of the constraints.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::resetNormalization( ) {
+
+		this->normalizationFactors.clear( );
+		this->violationMaxima.clear( );
+		this->adaptiveNormalization = false;
+		this->coefficientVersion++;
+
+	}
+
+
+	/*
+	 * Method to set the tolerance of all the equality constraints.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::setEqualityTolerance( T tolerance ) {
+
+		Index j;
+		if ( !( tolerance >= 0 ) ) {
+			throw std::invalid_argument( "the tolerance must not be negative" );
+		}
+		for( j=0; j < (Index) this->constraintScales.size( ); j++ ) {
+			if ( this->constraintScales[ j ] != 0 ) {
+				this->tolerances[ j ] = tolerance;
+			}
+		}
+		this->coefficientVersion++;
+		this->invalidateSums( );
+
+	}
+
+
+	/*
+	 * Method to reduce the tolerances of the equality constraints.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	void BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >::annealTolerances(
+		T factor,
+		T minimumTolerance ) {
+
+		Index j;
+		if ( !( factor >= 0 && factor <= 1 ) || !( minimumTolerance >= 0 ) ) {
+			throw std::invalid_argument( "the factor must be in [0, 1] and the minimum tolerance must not be negative" );
+		}
+		for( j=0; j < (Index) this->constraintScales.size( ); j++ ) {
+			if ( this->constraintScales[ j ] != 0 ) {
+				//a tolerance already below the minimum is kept
+				const T tolerance = this->tolerances[ j ] * factor;
+				this->tolerances[ j ] = std::max( tolerance, std::min( this->tolerances[ j ], minimumTolerance ) );
+			}
+		}
+		this->coefficientVersion++;
+		this->invalidateSums( );
+
+	}
+
+}
+
+
+#endif	/* ADAPTIVEPENALTYMETHODIMPL_HPP */
@@ -0,0 +1,463 @@
+/*
+ * File:   AdaptivePenaltyMethodKernels.cpp
+ * Author: Heder Soares Bernardino
+ *
+ * Vectorized kernels used by the AdaptivePenaltyMethod class.
+ * Please, read AdaptivePenaltyMethodKernels.hpp file for more
+ * information about the kernels.
+ *
+ * Compilation:
+ * Use the following command to compile this code:
+ * g++ -c AdaptivePenaltyMethodKernels.cpp
+ * No special flag is needed: the AVX2 and AVX-512 kernels are
+ * compiled in regions with their own target options and are only
+ * called if the processor supports them.
+ */
+
+/*
+ * Includes.
+ */
+#include "AdaptivePenaltyMethodKernels.hpp"
+
+#include <atomic>
+
+#if !defined( APM_DISABLE_SIMD ) && defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#define APM_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+#if !defined( APM_DISABLE_SIMD ) && defined( __aarch64__ ) && defined( __ARM_NEON )
+#define APM_KERNELS_NEON 1
+#include <arm_neon.h>
+#endif
+
+
+namespace apm {
+
+namespace kernels {
+
+	namespace {
+
+		//the kernels for a fixed number of constraints are evaluated at compile
+		//time: a violated inequality, a satisfied one and a violated equality
+		constexpr double checkedViolations[ 3 ] = { 0.5, -1.0, -0.25 };
+		constexpr double checkedCoefficients[ 3 ] = { 2.0, 4.0, 8.0 };
+		constexpr double checkedScales[ 3 ] = { 0.0, 0.0, -1.0 };
+		constexpr double checkedTolerances[ 3 ] = { 0.0, 0.0, 0.125 };
+		static_assert( fitnessFixed< double, double, 3 >( 1.0, checkedViolations, 1, checkedCoefficients, 3.0,
+			ConstraintKinds< double >{ 0, 0 } ) == 4.0, "the fixed kernels must be constexpr" );
+		static_assert( fitnessFixed< double, double, 3 >( 1.0, checkedViolations, 1, checkedCoefficients, 3.0,
+			ConstraintKinds< double >{ checkedScales, checkedTolerances } ) == 5.0, "the fixed kernels must be constexpr" );
+		static_assert( fitnessFixed< double, double, 1 >( 1.0, checkedViolations + 1, 1, checkedCoefficients, 3.0,
+			ConstraintKinds< double >{ 0, 0 } ) == 1.0, "the fixed kernels must be constexpr" );
+
+	}
+
+#ifdef APM_KERNELS_X86
+
+	/*
+	 * AVX2 kernels: four doubles or eight floats per vector.
+	 */
+	namespace avx2 {
+
+#pragma GCC push_options
+#pragma GCC target( "avx2" )
+		//the scalar kernels inlined for the remainders must not be contracted
+		//into fused multiply-adds, which would change their rounding
+#pragma GCC optimize( "fp-contract=off" )
+
+		struct DoubleTraits {
+			typedef double Value;
+			typedef __m256d Vector;
+			typedef __m256d Mask;
+			typedef __m256i Offsets;
+			static const int WIDTH = 4;
+
+			static Vector zero( ) { return _mm256_setzero_pd( ); }
+			static Vector load( const Value* values ) { return _mm256_loadu_pd( values ); }
+			static void store( Value* values, Vector vector ) { _mm256_storeu_pd( values, vector ); }
+			static Vector broadcast( Value value ) { return _mm256_set1_pd( value ); }
+			static Vector add( Vector a, Vector b ) { return _mm256_add_pd( a, b ); }
+			static Vector subtract( Vector a, Vector b ) { return _mm256_sub_pd( a, b ); }
+			static Vector maximum( Vector a, Vector b ) { return _mm256_max_pd( a, b ); }
+			static Vector multiply( Vector a, Vector b ) { return _mm256_mul_pd( a, b ); }
+			static Offsets offsets( std::size_t stride ) {
+				const long long s = (long long) stride;
+				return _mm256_set_epi64x( 3 * s, 2 * s, s, 0 );
+			}
+			static Vector gather( const Value* values, Offsets offsets ) { return _mm256_i64gather_pd( values, offsets, 8 ); }
+			static Mask greater( Vector a, Vector b ) { return _mm256_cmp_pd( a, b, _CMP_GT_OQ ); }
+			static Mask none( ) { return _mm256_setzero_pd( ); }
+			static Mask either( Mask a, Mask b ) { return _mm256_or_pd( a, b ); }
+			static Vector select( Mask mask, Vector vector ) { return _mm256_and_pd( mask, vector ); }
+			static unsigned bits( Mask mask ) { return (unsigned) _mm256_movemask_pd( mask ); }
+		};
+
+		struct FloatTraits {
+			typedef float Value;
+			typedef __m256 Vector;
+			typedef __m256 Mask;
+			//the offsets are 64-bit wide, so any stride can be gathered
+			struct Offsets {
+				__m256i low;
+				__m256i high;
+			};
+			static const int WIDTH = 8;
+
+			static Vector zero( ) { return _mm256_setzero_ps( ); }
+			static Vector load( const Value* values ) { return _mm256_loadu_ps( values ); }
+			static void store( Value* values, Vector vector ) { _mm256_storeu_ps( values, vector ); }
+			static Vector broadcast( Value value ) { return _mm256_set1_ps( value ); }
+			static Vector add( Vector a, Vector b ) { return _mm256_add_ps( a, b ); }
+			static Vector subtract( Vector a, Vector b ) { return _mm256_sub_ps( a, b ); }
+			static Vector maximum( Vector a, Vector b ) { return _mm256_max_ps( a, b ); }
+			static Vector multiply( Vector a, Vector b ) { return _mm256_mul_ps( a, b ); }
+			static Offsets offsets( std::size_t stride ) {
+				const long long s = (long long) stride;
+				Offsets offsets = { _mm256_set_epi64x( 3 * s, 2 * s, s, 0 ), _mm256_set_epi64x( 7 * s, 6 * s, 5 * s, 4 * s ) };
+				return offsets;
+			}
+			static Vector gather( const Value* values, const Offsets& offsets ) {
+				return _mm256_set_m128( _mm256_i64gather_ps( values, offsets.high, 4 ), _mm256_i64gather_ps( values, offsets.low, 4 ) );
+			}
+			static Mask greater( Vector a, Vector b ) { return _mm256_cmp_ps( a, b, _CMP_GT_OQ ); }
+			static Mask none( ) { return _mm256_setzero_ps( ); }
+			static Mask either( Mask a, Mask b ) { return _mm256_or_ps( a, b ); }
+			static Vector select( Mask mask, Vector vector ) { return _mm256_and_ps( mask, vector ); }
+			static unsigned bits( Mask mask ) { return (unsigned) _mm256_movemask_ps( mask ); }
+		};
+
+#include "AdaptivePenaltyMethodKernels.inl"
+
+		const Kernels< double, double > doubleKernels = {
+			accumulateViolationsVector< DoubleTraits >, calculatePenaltiesVector< DoubleTraits > };
+		const Kernels< float, float > floatKernels = {
+			accumulateViolationsVector< FloatTraits >, calculatePenaltiesVector< FloatTraits > };
+
+#pragma GCC pop_options
+
+	}
+
+	/*
+	 * AVX-512 kernels: eight doubles or sixteen floats per vector.
+	 */
+	namespace avx512 {
+
+#pragma GCC push_options
+#pragma GCC target( "avx512f" )
+#pragma GCC optimize( "fp-contract=off" )
+		//the gather intrinsics of some GCC versions trigger false positives
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+		struct DoubleTraits {
+			typedef double Value;
+			typedef __m512d Vector;
+			typedef __mmask8 Mask;
+			typedef __m512i Offsets;
+			static const int WIDTH = 8;
+
+			static Vector zero( ) { return _mm512_setzero_pd( ); }
+			static Vector load( const Value* values ) { return _mm512_loadu_pd( values ); }
+			static void store( Value* values, Vector vector ) { _mm512_storeu_pd( values, vector ); }
+			static Vector broadcast( Value value ) { return _mm512_set1_pd( value ); }
+			static Vector add( Vector a, Vector b ) { return _mm512_add_pd( a, b ); }
+			static Vector subtract( Vector a, Vector b ) { return _mm512_sub_pd( a, b ); }
+			static Vector maximum( Vector a, Vector b ) { return _mm512_max_pd( a, b ); }
+			static Vector multiply( Vector a, Vector b ) { return _mm512_mul_pd( a, b ); }
+			static Offsets offsets( std::size_t stride ) {
+				const long long s = (long long) stride;
+				return _mm512_set_epi64( 7 * s, 6 * s, 5 * s, 4 * s, 3 * s, 2 * s, s, 0 );
+			}
+			static Vector gather( const Value* values, Offsets offsets ) { return _mm512_i64gather_pd( offsets, values, 8 ); }
+			static Mask greater( Vector a, Vector b ) { return _mm512_cmp_pd_mask( a, b, _CMP_GT_OQ ); }
+			static Mask none( ) { return 0; }
+			static Mask either( Mask a, Mask b ) { return a | b; }
+			static Vector select( Mask mask, Vector vector ) { return _mm512_maskz_mov_pd( mask, vector ); }
+			static unsigned bits( Mask mask ) { return (unsigned) mask; }
+		};
+
+		struct FloatTraits {
+			typedef float Value;
+			typedef __m512 Vector;
+			typedef __mmask16 Mask;
+			struct Offsets {
+				__m512i low;
+				__m512i high;
+			};
+			static const int WIDTH = 16;
+
+			static Vector zero( ) { return _mm512_setzero_ps( ); }
+			static Vector load( const Value* values ) { return _mm512_loadu_ps( values ); }
+			static void store( Value* values, Vector vector ) { _mm512_storeu_ps( values, vector ); }
+			static Vector broadcast( Value value ) { return _mm512_set1_ps( value ); }
+			static Vector add( Vector a, Vector b ) { return _mm512_add_ps( a, b ); }
+			static Vector subtract( Vector a, Vector b ) { return _mm512_sub_ps( a, b ); }
+			static Vector maximum( Vector a, Vector b ) { return _mm512_max_ps( a, b ); }
+			static Vector multiply( Vector a, Vector b ) { return _mm512_mul_ps( a, b ); }
+			static Offsets offsets( std::size_t stride ) {
+				const long long s = (long long) stride;
+				Offsets offsets = {
+					_mm512_set_epi64( 7 * s, 6 * s, 5 * s, 4 * s, 3 * s, 2 * s, s, 0 ),
+					_mm512_set_epi64( 15 * s, 14 * s, 13 * s, 12 * s, 11 * s, 10 * s, 9 * s, 8 * s ) };
+				return offsets;
+			}
+			static Vector gather( const Value* values, const Offsets& offsets ) {
+				const __m256 low = _mm512_i64gather_ps( offsets.low, values, 4 );
+				const __m256 high = _mm512_i64gather_ps( offsets.high, values, 4 );
+				return _mm512_castpd_ps( _mm512_insertf64x4( _mm512_castps_pd( _mm512_castps256_ps512( low ) ), _mm256_castps_pd( high ), 1 ) );
+			}
+			static Mask greater( Vector a, Vector b ) { return _mm512_cmp_ps_mask( a, b, _CMP_GT_OQ ); }
+			static Mask none( ) { return 0; }
+			static Mask either( Mask a, Mask b ) { return a | b; }
+			static Vector select( Mask mask, Vector vector ) { return _mm512_maskz_mov_ps( mask, vector ); }
+			static unsigned bits( Mask mask ) { return (unsigned) mask; }
+		};
+
+#include "AdaptivePenaltyMethodKernels.inl"
+
+		const Kernels< double, double > doubleKernels = {
+			accumulateViolationsVector< DoubleTraits >, calculatePenaltiesVector< DoubleTraits > };
+		const Kernels< float, float > floatKernels = {
+			accumulateViolationsVector< FloatTraits >, calculatePenaltiesVector< FloatTraits > };
+
+#pragma GCC diagnostic pop
+#pragma GCC pop_options
+
+	}
+
+#endif
+
+#ifdef APM_KERNELS_NEON
+
+	/*
+	 * NEON kernels: two doubles or four floats per vector.
+	 */
+	namespace neon {
+
+		struct DoubleTraits {
+			typedef double Value;
+			typedef float64x2_t Vector;
+			typedef uint64x2_t Mask;
+			typedef std::size_t Offsets;
+			static const int WIDTH = 2;
+
+			static Vector zero( ) { return vdupq_n_f64( 0.0 ); }
+			static Vector load( const Value* values ) { return vld1q_f64( values ); }
+			static void store( Value* values, Vector vector ) { vst1q_f64( values, vector ); }
+			static Vector broadcast( Value value ) { return vdupq_n_f64( value ); }
+			static Vector add( Vector a, Vector b ) { return vaddq_f64( a, b ); }
+			static Vector subtract( Vector a, Vector b ) { return vsubq_f64( a, b ); }
+			//vmaxq would return a lane which is not a number
+			static Vector maximum( Vector a, Vector b ) { return vbslq_f64( vcgtq_f64( a, b ), a, b ); }
+			static Vector multiply( Vector a, Vector b ) { return vmulq_f64( a, b ); }
+			static Offsets offsets( std::size_t stride ) { return stride; }
+			static Vector gather( const Value* values, Offsets stride ) {
+				return vsetq_lane_f64( values[ stride ], vdupq_n_f64( values[ 0 ] ), 1 );
+			}
+			static Mask greater( Vector a, Vector b ) { return vcgtq_f64( a, b ); }
+			static Mask none( ) { return vdupq_n_u64( 0 ); }
+			static Mask either( Mask a, Mask b ) { return vorrq_u64( a, b ); }
+			static Vector select( Mask mask, Vector vector ) {
+				return vreinterpretq_f64_u64( vandq_u64( mask, vreinterpretq_u64_f64( vector ) ) );
+			}
+			static unsigned bits( Mask mask ) {
+				return (unsigned) ( ( vgetq_lane_u64( mask, 0 ) & 1 ) | ( ( vgetq_lane_u64( mask, 1 ) & 1 ) << 1 ) );
+			}
+		};
+
+		struct FloatTraits {
+			typedef float Value;
+			typedef float32x4_t Vector;
+			typedef uint32x4_t Mask;
+			typedef std::size_t Offsets;
+			static const int WIDTH = 4;
+
+			static Vector zero( ) { return vdupq_n_f32( 0.0f ); }
+			static Vector load( const Value* values ) { return vld1q_f32( values ); }
+			static void store( Value* values, Vector vector ) { vst1q_f32( values, vector ); }
+			static Vector broadcast( Value value ) { return vdupq_n_f32( value ); }
+			static Vector add( Vector a, Vector b ) { return vaddq_f32( a, b ); }
+			static Vector subtract( Vector a, Vector b ) { return vsubq_f32( a, b ); }
+			//vmaxq would return a lane which is not a number
+			static Vector maximum( Vector a, Vector b ) { return vbslq_f32( vcgtq_f32( a, b ), a, b ); }
+			static Vector multiply( Vector a, Vector b ) { return vmulq_f32( a, b ); }
+			static Offsets offsets( std::size_t stride ) { return stride; }
+			static Vector gather( const Value* values, Offsets stride ) {
+				Vector vector = vdupq_n_f32( values[ 0 ] );
+				vector = vsetq_lane_f32( values[ stride ], vector, 1 );
+				vector = vsetq_lane_f32( values[ 2 * stride ], vector, 2 );
+				return vsetq_lane_f32( values[ 3 * stride ], vector, 3 );
+			}
+			static Mask greater( Vector a, Vector b ) { return vcgtq_f32( a, b ); }
+			static Mask none( ) { return vdupq_n_u32( 0 ); }
+			static Mask either( Mask a, Mask b ) { return vorrq_u32( a, b ); }
+			static Vector select( Mask mask, Vector vector ) {
+				return vreinterpretq_f32_u32( vandq_u32( mask, vreinterpretq_u32_f32( vector ) ) );
+			}
+			static unsigned bits( Mask mask ) {
+				return (unsigned) ( ( vgetq_lane_u32( mask, 0 ) & 1 ) | ( ( vgetq_lane_u32( mask, 1 ) & 1 ) << 1 ) |
+					( ( vgetq_lane_u32( mask, 2 ) & 1 ) << 2 ) | ( ( vgetq_lane_u32( mask, 3 ) & 1 ) << 3 ) );
+			}
+		};
+
+#include "AdaptivePenaltyMethodKernels.inl"
+
+		const Kernels< double, double > doubleKernels = {
+			accumulateViolationsVector< DoubleTraits >, calculatePenaltiesVector< DoubleTraits > };
+		const Kernels< float, float > floatKernels = {
+			accumulateViolationsVector< FloatTraits >, calculatePenaltiesVector< FloatTraits > };
+
+	}
+
+#endif
+
+	namespace {
+
+		/*
+		 * Check if an instruction set was compiled in and
+		 * is supported by the processor.
+		 */
+		bool isSupported( InstructionSet instructionSet ) {
+
+			switch ( instructionSet ) {
+				case SCALAR:
+					return true;
+#ifdef APM_KERNELS_NEON
+				case NEON:
+					return true;
+#endif
+#ifdef APM_KERNELS_X86
+				case AVX2:
+					__builtin_cpu_init( );
+					return __builtin_cpu_supports( "avx2" );
+				case AVX512:
+					__builtin_cpu_init( );
+					return __builtin_cpu_supports( "avx512f" );
+#endif
+				default:
+					return false;
+			}
+
+		}
+
+		/*
+		 * Return the kernels of a type for an instruction set
+		 * (the scalar kernels if there are no vectorized ones).
+		 */
+		template< typename T >
+		const Kernels< T, T >* kernelsOf( InstructionSet instructionSet, const Kernels< T, T >* avx2Kernels,
+			const Kernels< T, T >* avx512Kernels, const Kernels< T, T >* neonKernels ) {
+
+			static const Kernels< T, T > scalar = { accumulateViolationsScalar< T, T >, calculatePenaltiesScalar< T, T > };
+			switch ( instructionSet ) {
+				case AVX2:
+					return avx2Kernels;
+				case AVX512:
+					return avx512Kernels;
+				case NEON:
+					return neonKernels;
+				default:
+					return &scalar;
+			}
+
+		}
+
+		const Kernels< double, double >* doubleKernelsOf( InstructionSet instructionSet ) {
+#if defined( APM_KERNELS_X86 )
+			return kernelsOf< double >( instructionSet, &avx2::doubleKernels, &avx512::doubleKernels, 0 );
+#elif defined( APM_KERNELS_NEON )
+			return kernelsOf< double >( instructionSet, 0, 0, &neon::doubleKernels );
+#else
+			return kernelsOf< double >( instructionSet, 0, 0, 0 );
+#endif
+		}
+
+		const Kernels< float, float >* floatKernelsOf( InstructionSet instructionSet ) {
+#if defined( APM_KERNELS_X86 )
+			return kernelsOf< float >( instructionSet, &avx2::floatKernels, &avx512::floatKernels, 0 );
+#elif defined( APM_KERNELS_NEON )
+			return kernelsOf< float >( instructionSet, 0, 0, &neon::floatKernels );
+#else
+			return kernelsOf< float >( instructionSet, 0, 0, 0 );
+#endif
+		}
+
+		/*
+		 * The best instruction set supported by the processor.
+		 */
+		InstructionSet detectInstructionSet( ) {
+
+			const InstructionSet candidates[] = { AVX512, AVX2, NEON };
+			for( int i=0; i < 3; i++ ) {
+				if ( isSupported( candidates[ i ] ) ) {
+					return candidates[ i ];
+				}
+			}
+			return SCALAR;
+
+		}
+
+		struct Selection {
+			std::atomic< InstructionSet > instructionSet;
+			std::atomic< const Kernels< double, double >* > doubleKernels;
+			std::atomic< const Kernels< float, float >* > floatKernels;
+
+			Selection( ):
+				instructionSet( detectInstructionSet( ) ),
+				doubleKernels( doubleKernelsOf( instructionSet.load( ) ) ),
+				floatKernels( floatKernelsOf( instructionSet.load( ) ) ) {
+			}
+		};
+
+		Selection& selection( ) {
+			static Selection selected;
+			return selected;
+		}
+
+	}
+
+	template< >
+	const Kernels< double, double >& active< double, double >( ) {
+		return *selection( ).doubleKernels.load( std::memory_order_relaxed );
+	}
+
+	template< >
+	const Kernels< float, float >& active< float, float >( ) {
+		return *selection( ).floatKernels.load( std::memory_order_relaxed );
+	}
+
+}
+
+	InstructionSet instructionSet( ) {
+		return kernels::selection( ).instructionSet.load( );
+	}
+
+	bool selectInstructionSet( InstructionSet instructionSet ) {
+
+		if ( !kernels::isSupported( instructionSet ) ) {
+			return false;
+		}
+		kernels::selection( ).instructionSet.store( instructionSet );
+		kernels::selection( ).doubleKernels.store( kernels::doubleKernelsOf( instructionSet ) );
+		kernels::selection( ).floatKernels.store( kernels::floatKernelsOf( instructionSet ) );
+		return true;
+
+	}
+
+	const char* instructionSetName( InstructionSet instructionSet ) {
+
+		switch ( instructionSet ) {
+			case NEON:
+				return "neon";
+			case AVX2:
+				return "avx2";
+			case AVX512:
+				return "avx512";
+			default:
+				return "scalar";
+		}
+
+	}
+
+}
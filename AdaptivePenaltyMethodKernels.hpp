@@ -0,0 +1,480 @@
+/*
+ * File:   AdaptivePenaltyMethodKernels.hpp
+ * Author: Heder Soares Bernardino
+ *
+ * Vectorized kernels used by the AdaptivePenaltyMethod class.
+ * The kernels are compiled for several instruction sets
+ * (AVX2 and AVX-512 on x86, NEON on AArch64) and the best one
+ * supported by the processor is selected at run time; the
+ * scalar kernels are used otherwise.
+ *
+ * The kernels are templates on the type of the values ('T') and
+ * on the type of the sums ('Accumulator'). The vectorized kernels
+ * are available when both types are 'float' (twice as many lanes
+ * as for 'double') or both are 'double'; any other combination
+ * uses the scalar kernels defined in this file.
+ *
+ * The vectorized kernels keep the order of the additions of the
+ * scalar code (the lanes hold different constraints or different
+ * candidate solutions, never two terms of the same sum) and use
+ * separate multiplications and additions, thus all the kernels
+ * produce the same results. Define APM_DISABLE_SIMD when compiling
+ * AdaptivePenaltyMethodKernels.cpp to build only the scalar kernels.
+ *
+ * The kinds of the constraints (see ConstraintKinds) are applied to
+ * the values as they are read, so the violations of the equality
+ * constraints are never stored.
+ *
+ * Compilation:
+ * g++ -c AdaptivePenaltyMethodKernels.cpp
+ * This will generate a 'AdaptivePenaltyMethodKernels.o' object file,
+ * which must be linked together with 'AdaptivePenaltyMethod.o'.
+ */
+
+#ifndef ADAPTIVEPENALTYMETHODKERNELS_HPP
+#define	ADAPTIVEPENALTYMETHODKERNELS_HPP
+
+/*
+ * Includes.
+ */
+#include <cstddef>
+
+/*
+ * Requests the full unrolling of the following loop.
+ */
+#if defined( __clang__ )
+#define APM_UNROLL _Pragma( "unroll" )
+#elif defined( __GNUC__ )
+#define APM_UNROLL _Pragma( "GCC unroll 64" )
+#else
+#define APM_UNROLL
+#endif
+
+namespace apm {
+
+/*
+ * Instruction sets for which the kernels are available.
+ */
+enum InstructionSet {
+	SCALAR,
+	NEON,
+	AVX2,
+	AVX512
+};
+
+/*
+ * Name: instructionSet
+ * Description: Return the instruction set of the kernels
+ * currently in use.
+ */
+InstructionSet instructionSet( );
+
+/*
+ * Name: selectInstructionSet
+ * Description: Select the instruction set of the kernels.
+ * This is useful to compare or to benchmark the kernels.
+ * Returns false (and keeps the current kernels) if the
+ * instruction set is not supported by the processor or
+ * was not compiled in.
+ * Parameters:
+ * - instructionSet: the instruction set to be used.
+ */
+bool selectInstructionSet( InstructionSet instructionSet );
+
+/*
+ * Name: instructionSetName
+ * Description: Return a printable name of an instruction set.
+ */
+const char* instructionSetName( InstructionSet instructionSet );
+
+namespace kernels {
+
+	/*
+	 * Number of bits set in 'bits'.
+	 */
+	constexpr unsigned int countBits( unsigned int bits ) {
+#if defined( __GNUC__ )
+		return (unsigned int) __builtin_popcount( bits );
+#else
+		unsigned int count = 0;
+		for( ; bits; bits &= bits - 1 ) {
+			count++;
+		}
+		return count;
+#endif
+	}
+
+	/*
+	 * Kinds of the constraints. The violation of constraint 'j' is
+	 * 'max( scales[ j ] * v, v ) - tolerances[ j ]', where 'v' is the
+	 * value given for it: 'scales[ j ]' is -1 for an equality constraint,
+	 * whose violation is '|v| - tolerances[ j ]', and 0 for an inequality
+	 * constraint, whose tolerance is 0 and whose positive violations are
+	 * then 'v' itself. If 'scales' is null, all the constraints are
+	 * inequalities and the values are used as they are.
+	 */
+	template< typename T >
+	struct ConstraintKinds {
+		const T* scales;
+		const T* tolerances;
+	};
+
+	/*
+	 * Name: violationOf
+	 * Description: Return the violation of constraint 'j' whose value is
+	 * 'value'. If 'Equalities' is false, 'kinds' is not read.
+	 */
+	template< bool Equalities, typename T >
+	constexpr T violationOf( T value, const ConstraintKinds< T >& kinds, std::size_t j ) {
+		if ( !Equalities ) {
+			return value;
+		}
+		//the maximum keeps 'value' if the product is not a number
+		const T reflected = kinds.scales[ j ] * value;
+		return ( reflected > value? reflected: value ) - kinds.tolerances[ j ];
+	}
+
+	/*
+	 * Name: violationOf
+	 * Description: Same as the function above for any 'kinds'.
+	 */
+	template< typename T >
+	constexpr T violationOf( T value, const ConstraintKinds< T >& kinds, std::size_t j ) {
+		return kinds.scales? violationOf< true >( value, kinds, j ): value;
+	}
+
+	/*
+	 * In both kernels, the value of constraint 'j' for the
+	 * candidate solution 'k' is found at position
+	 * 'k * individualStride + j * constraintStride' of 'constraintViolationValues'
+	 * and the violation is calculated from it with 'kinds'.
+	 */
+	template< typename T, typename Accumulator >
+	struct Kernels {
+
+		/*
+		 * Name: accumulateViolations
+		 * Description: Add the positive constraint violations of 'count'
+		 * candidate solutions to 'sumViolation', in the order of the
+		 * candidate solutions. If 'violatedConstraints' is not null,
+		 * 'violatedConstraints[ k ]' is set to the number of constraints
+		 * violated by candidate solution 'k' (0 if it is feasible).
+		 */
+		void ( *accumulateViolations )(
+			Accumulator* sumViolation,
+			unsigned int* violatedConstraints,
+			const T* constraintViolationValues,
+			std::size_t count,
+			std::size_t individualStride,
+			std::size_t constraintStride,
+			std::size_t numberOfConstraints,
+			ConstraintKinds< T > kinds );
+
+		/*
+		 * Name: calculatePenalties
+		 * Description: Calculate the penalty values of 'count' candidate
+		 * solutions, adding their terms in the order of the constraints.
+		 * 'infeasible[ k ]' is set to 1 if candidate solution 'k' violates
+		 * some constraint and to 0 otherwise.
+		 */
+		void ( *calculatePenalties )(
+			Accumulator* penalties,
+			unsigned char* infeasible,
+			const T* constraintViolationValues,
+			std::size_t count,
+			std::size_t individualStride,
+			std::size_t constraintStride,
+			std::size_t numberOfConstraints,
+			const T* penaltyCoefficients,
+			ConstraintKinds< T > kinds );
+	};
+
+	/*
+	 * Scalar kernels. These are also used for the remainders
+	 * of the vectorized kernels. The loops for the equality constraints
+	 * are compiled separately, so the inequalities only are not slowed down.
+	 */
+	template< bool Equalities, typename T, typename Accumulator >
+	void accumulateViolationsOf(
+		Accumulator* sumViolation,
+		unsigned int* violatedConstraints,
+		const T* constraintViolationValues,
+		std::size_t count,
+		std::size_t individualStride,
+		std::size_t constraintStride,
+		std::size_t numberOfConstraints,
+		const ConstraintKinds< T >& kinds ) {
+
+		for( std::size_t k=0; k < count; k++ ) {
+
+			const T* violations = constraintViolationValues + k * individualStride;
+			unsigned int violated = 0;
+			for( std::size_t l=0; l < numberOfConstraints; l++ ) {
+
+				const T violation = violationOf< Equalities >( violations[ l * constraintStride ], kinds, l );
+				sumViolation[ l ] += violation > 0? (Accumulator) violation: (Accumulator) 0;
+				violated += violation > 0;
+
+			}
+			if ( violatedConstraints ) {
+				violatedConstraints[ k ] = violated;
+			}
+
+		}
+
+	}
+
+	template< typename T, typename Accumulator >
+	void accumulateViolationsScalar(
+		Accumulator* sumViolation,
+		unsigned int* violatedConstraints,
+		const T* constraintViolationValues,
+		std::size_t count,
+		std::size_t individualStride,
+		std::size_t constraintStride,
+		std::size_t numberOfConstraints,
+		ConstraintKinds< T > kinds ) {
+
+		if ( kinds.scales ) {
+			accumulateViolationsOf< true >( sumViolation, violatedConstraints, constraintViolationValues, count,
+				individualStride, constraintStride, numberOfConstraints, kinds );
+		} else {
+			accumulateViolationsOf< false >( sumViolation, violatedConstraints, constraintViolationValues, count,
+				individualStride, constraintStride, numberOfConstraints, kinds );
+		}
+
+	}
+
+	template< bool Equalities, typename T, typename Accumulator >
+	void calculatePenaltiesOf(
+		Accumulator* penalties,
+		unsigned char* infeasible,
+		const T* constraintViolationValues,
+		std::size_t count,
+		std::size_t individualStride,
+		std::size_t constraintStride,
+		std::size_t numberOfConstraints,
+		const T* penaltyCoefficients,
+		const ConstraintKinds< T >& kinds ) {
+
+		for( std::size_t k=0; k < count; k++ ) {
+
+			const T* violations = constraintViolationValues + k * individualStride;
+			bool violated = false;
+			Accumulator penalty = 0;
+			for( std::size_t j=0; j < numberOfConstraints; j++ ) {
+
+				const T violation = violationOf< Equalities >( violations[ j * constraintStride ], kinds, j );
+				if ( violation > 0 ) {
+					violated = true;
+					penalty += (Accumulator) penaltyCoefficients[ j ] * (Accumulator) violation;
+				}
+
+			}
+			penalties[ k ] = penalty;
+			infeasible[ k ] = violated;
+
+		}
+
+	}
+
+	template< typename T, typename Accumulator >
+	void calculatePenaltiesScalar(
+		Accumulator* penalties,
+		unsigned char* infeasible,
+		const T* constraintViolationValues,
+		std::size_t count,
+		std::size_t individualStride,
+		std::size_t constraintStride,
+		std::size_t numberOfConstraints,
+		const T* penaltyCoefficients,
+		ConstraintKinds< T > kinds ) {
+
+		if ( kinds.scales ) {
+			calculatePenaltiesOf< true >( penalties, infeasible, constraintViolationValues, count,
+				individualStride, constraintStride, numberOfConstraints, penaltyCoefficients, kinds );
+		} else {
+			calculatePenaltiesOf< false >( penalties, infeasible, constraintViolationValues, count,
+				individualStride, constraintStride, numberOfConstraints, penaltyCoefficients, kinds );
+		}
+
+	}
+
+	/*
+	 * Kernels for a number of constraints known at compile time ('M').
+	 * The loops over the constraints are fully unrolled and the argument
+	 * 'numberOfConstraints' is ignored. They are called directly (not
+	 * through a table), so that they are inlined for each candidate solution,
+	 * and they are constexpr, so they can also be evaluated at compile time
+	 * (e.g. to check a problem with known violations by a static_assert).
+	 */
+	template< bool Equalities, typename T, typename Accumulator, int M >
+	constexpr void accumulateViolationsFixedOf(
+		Accumulator* sumViolation,
+		unsigned int* violatedConstraints,
+		const T* constraintViolationValues,
+		std::size_t count,
+		std::size_t individualStride,
+		std::size_t constraintStride,
+		const ConstraintKinds< T >& kinds ) {
+
+		for( std::size_t k=0; k < count; k++ ) {
+
+			const T* violations = constraintViolationValues + k * individualStride;
+			unsigned int violated = 0;
+			APM_UNROLL
+			for( int l=0; l < M; l++ ) {
+
+				const T violation = violationOf< Equalities >( violations[ l * constraintStride ], kinds, l );
+				sumViolation[ l ] += violation > 0? (Accumulator) violation: (Accumulator) 0;
+				violated += violation > 0;
+
+			}
+			if ( violatedConstraints ) {
+				violatedConstraints[ k ] = violated;
+			}
+
+		}
+
+	}
+
+	template< typename T, typename Accumulator, int M >
+	constexpr void accumulateViolationsFixed(
+		Accumulator* sumViolation,
+		unsigned int* violatedConstraints,
+		const T* constraintViolationValues,
+		std::size_t count,
+		std::size_t individualStride,
+		std::size_t constraintStride,
+		std::size_t,
+		ConstraintKinds< T > kinds ) {
+
+		if ( kinds.scales ) {
+			accumulateViolationsFixedOf< true, T, Accumulator, M >( sumViolation, violatedConstraints, constraintViolationValues,
+				count, individualStride, constraintStride, kinds );
+		} else {
+			accumulateViolationsFixedOf< false, T, Accumulator, M >( sumViolation, violatedConstraints, constraintViolationValues,
+				count, individualStride, constraintStride, kinds );
+		}
+
+	}
+
+	template< bool Equalities, typename T, typename Accumulator, int M >
+	constexpr void calculatePenaltiesFixedOf(
+		Accumulator* penalties,
+		unsigned char* infeasible,
+		const T* constraintViolationValues,
+		std::size_t count,
+		std::size_t individualStride,
+		std::size_t constraintStride,
+		const T* penaltyCoefficients,
+		const ConstraintKinds< T >& kinds ) {
+
+		for( std::size_t k=0; k < count; k++ ) {
+
+			const T* violations = constraintViolationValues + k * individualStride;
+			bool violated = false;
+			Accumulator penalty = 0;
+			APM_UNROLL
+			for( int j=0; j < M; j++ ) {
+
+				const T violation = violationOf< Equalities >( violations[ j * constraintStride ], kinds, j );
+				if ( violation > 0 ) {
+					violated = true;
+					penalty += (Accumulator) penaltyCoefficients[ j ] * (Accumulator) violation;
+				}
+
+			}
+			penalties[ k ] = penalty;
+			infeasible[ k ] = violated;
+
+		}
+
+	}
+
+	template< typename T, typename Accumulator, int M >
+	constexpr void calculatePenaltiesFixed(
+		Accumulator* penalties,
+		unsigned char* infeasible,
+		const T* constraintViolationValues,
+		std::size_t count,
+		std::size_t individualStride,
+		std::size_t constraintStride,
+		std::size_t,
+		const T* penaltyCoefficients,
+		ConstraintKinds< T > kinds ) {
+
+		if ( kinds.scales ) {
+			calculatePenaltiesFixedOf< true, T, Accumulator, M >( penalties, infeasible, constraintViolationValues,
+				count, individualStride, constraintStride, penaltyCoefficients, kinds );
+		} else {
+			calculatePenaltiesFixedOf< false, T, Accumulator, M >( penalties, infeasible, constraintViolationValues,
+				count, individualStride, constraintStride, penaltyCoefficients, kinds );
+		}
+
+	}
+
+	/*
+	 * Name: fitnessOf
+	 * Description: Return the fitness of a candidate solution whose penalty
+	 * is 'penalty': the objective function value if it is feasible and,
+	 * otherwise, the penalty added to the maximum of the objective function
+	 * value and of the average of the objective function values.
+	 */
+	template< typename T, typename Accumulator >
+	constexpr T fitnessOf( T objectiveFunctionValue, Accumulator penalty, bool infeasible,
+		Accumulator averageObjectiveFunctionValues ) {
+		const Accumulator objective = objectiveFunctionValue;
+		return infeasible ?
+				(T) ( objective > averageObjectiveFunctionValues? objective + penalty: averageObjectiveFunctionValues + penalty ) :
+				objectiveFunctionValue;
+	}
+
+	/*
+	 * Name: fitnessFixed
+	 * Description: Return the fitness of a candidate solution with 'M'
+	 * constraints, whose violations are found 'stride' elements apart,
+	 * given the penalty coefficients and the average of the objective
+	 * function values (see BasicAdaptivePenaltyMethod::calculateFitness).
+	 */
+	template< typename T, typename Accumulator, int M >
+	constexpr T fitnessFixed(
+		T objectiveFunctionValue,
+		const T* constraintViolationValues,
+		std::size_t stride,
+		const T* penaltyCoefficients,
+		Accumulator averageObjectiveFunctionValues,
+		ConstraintKinds< T > kinds ) {
+
+		Accumulator penalty = 0;
+		unsigned char infeasible = 0;
+		calculatePenaltiesFixed< T, Accumulator, M >( &penalty, &infeasible, constraintViolationValues, 1, 0, stride, M,
+			penaltyCoefficients, kinds );
+		return fitnessOf< T, Accumulator >( objectiveFunctionValue, penalty, infeasible, averageObjectiveFunctionValues );
+
+	}
+
+	/*
+	 * Name: active
+	 * Description: Return the kernels of the selected instruction set.
+	 * Only the scalar kernels exist for the types without vectorized kernels.
+	 */
+	template< typename T, typename Accumulator >
+	const Kernels< T, Accumulator >& active( ) {
+		static const Kernels< T, Accumulator > scalar = {
+			accumulateViolationsScalar< T, Accumulator >,
+			calculatePenaltiesScalar< T, Accumulator > };
+		return scalar;
+	}
+
+	template< >
+	const Kernels< float, float >& active< float, float >( );
+
+	template< >
+	const Kernels< double, double >& active< double, double >( );
+
+}
+
+}
+
+#endif	/* ADAPTIVEPENALTYMETHODKERNELS_HPP */
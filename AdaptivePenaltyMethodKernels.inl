@@ -0,0 +1,197 @@
+/*
+ * File:   AdaptivePenaltyMethodKernels.inl
+ * Author: Heder Soares Bernardino
+ *
+ * Vectorized kernels written in terms of a 'Traits' class which
+ * wraps the intrinsics of an instruction set for a type of value.
+ * This file is included by AdaptivePenaltyMethodKernels.cpp once
+ * for each instruction set, inside a region compiled for it, so it
+ * has no include guard and must not be included anywhere else.
+ *
+ * 'Traits' provides:
+ * - Value, Vector, Mask and Offsets types and the number of lanes WIDTH;
+ * - zero, load, store, broadcast, add, subtract and multiply operations;
+ * - maximum( a, b ), which is 'a > b? a: b' in each lane;
+ * - offsets( stride ) and gather( values, offsets ), which load the
+ * lanes 'values[ 0 ], values[ stride ], ...';
+ * - greater, none, either, select( mask, v ) (v where mask, +0 otherwise)
+ * and bits( mask ), which returns one bit per lane.
+ */
+
+	/*
+	 * The violations of the lanes of 'values' (see 'violationOf'), whose
+	 * scales and tolerances are 'scale' and 'tolerance'.
+	 */
+	template< typename Traits, bool Equalities >
+	inline typename Traits::Vector violationsOf(
+		typename Traits::Vector values,
+		typename Traits::Vector scale,
+		typename Traits::Vector tolerance ) {
+
+		if ( !Equalities ) {
+			return values;
+		}
+		return Traits::subtract( Traits::maximum( Traits::multiply( scale, values ), values ), tolerance );
+
+	}
+
+	template< typename Traits, bool Equalities >
+	void accumulateViolationsVectorOf(
+		typename Traits::Value* sumViolation,
+		unsigned int* violatedConstraints,
+		const typename Traits::Value* constraintViolationValues,
+		std::size_t count,
+		std::size_t individualStride,
+		std::size_t constraintStride,
+		std::size_t numberOfConstraints,
+		const ConstraintKinds< typename Traits::Value >& kinds ) {
+
+		typedef typename Traits::Value Value;
+		typedef typename Traits::Vector Vector;
+		typedef typename Traits::Mask Mask;
+
+		const Vector zero = Traits::zero( );
+		const typename Traits::Offsets offsets = Traits::offsets( constraintStride );
+		const std::size_t vectorized = numberOfConstraints - numberOfConstraints % Traits::WIDTH;
+
+		for( std::size_t k=0; k < count; k++ ) {
+
+			const Value* violations = constraintViolationValues + k * individualStride;
+			unsigned int violated = 0;
+			std::size_t l;
+			//the lanes hold different constraints
+			for( l=0; l < vectorized; l += Traits::WIDTH ) {
+
+				const Vector value = constraintStride == 1?
+					Traits::load( violations + l ):
+					Traits::gather( violations + l * constraintStride, offsets );
+				const Vector violation = Equalities?
+					violationsOf< Traits, true >( value, Traits::load( kinds.scales + l ), Traits::load( kinds.tolerances + l ) ):
+					value;
+				const Mask positive = Traits::greater( violation, zero );
+				violated += countBits( Traits::bits( positive ) );
+				Traits::store( sumViolation + l, Traits::add( Traits::load( sumViolation + l ), Traits::select( positive, violation ) ) );
+
+			}
+			for( ; l < numberOfConstraints; l++ ) {
+
+				const Value violation = violationOf< Equalities >( violations[ l * constraintStride ], kinds, l );
+				sumViolation[ l ] += violation > 0? violation: (Value) 0;
+				violated += violation > 0;
+
+			}
+			if ( violatedConstraints ) {
+				violatedConstraints[ k ] = violated;
+			}
+
+		}
+
+	}
+
+	template< typename Traits >
+	void accumulateViolationsVector(
+		typename Traits::Value* sumViolation,
+		unsigned int* violatedConstraints,
+		const typename Traits::Value* constraintViolationValues,
+		std::size_t count,
+		std::size_t individualStride,
+		std::size_t constraintStride,
+		std::size_t numberOfConstraints,
+		ConstraintKinds< typename Traits::Value > kinds ) {
+
+		if ( kinds.scales ) {
+			accumulateViolationsVectorOf< Traits, true >( sumViolation, violatedConstraints, constraintViolationValues, count,
+				individualStride, constraintStride, numberOfConstraints, kinds );
+		} else {
+			accumulateViolationsVectorOf< Traits, false >( sumViolation, violatedConstraints, constraintViolationValues, count,
+				individualStride, constraintStride, numberOfConstraints, kinds );
+		}
+
+	}
+
+	template< typename Traits, bool Equalities >
+	void calculatePenaltiesVectorOf(
+		typename Traits::Value* penalties,
+		unsigned char* infeasible,
+		const typename Traits::Value* constraintViolationValues,
+		std::size_t count,
+		std::size_t individualStride,
+		std::size_t constraintStride,
+		std::size_t numberOfConstraints,
+		const typename Traits::Value* penaltyCoefficients,
+		const ConstraintKinds< typename Traits::Value >& kinds ) {
+
+		typedef typename Traits::Value Value;
+		typedef typename Traits::Vector Vector;
+		typedef typename Traits::Mask Mask;
+
+		const Vector zero = Traits::zero( );
+		const typename Traits::Offsets offsets = Traits::offsets( individualStride );
+		const std::size_t step = 2 * Traits::WIDTH;
+		const std::size_t vectorized = count - count % step;
+
+		std::size_t k;
+		//the lanes hold different candidate solutions; two vectors are
+		//processed together to hide the latency of the additions
+		for( k=0; k < vectorized; k += step ) {
+
+			const Value* first = constraintViolationValues + k * individualStride;
+			const Value* second = first + Traits::WIDTH * individualStride;
+			Vector penalty0 = zero;
+			Vector penalty1 = zero;
+			Mask violated0 = Traits::none( );
+			Mask violated1 = Traits::none( );
+			for( std::size_t j=0; j < numberOfConstraints; j++ ) {
+
+				const std::size_t position = j * constraintStride;
+				const Vector coefficient = Traits::broadcast( penaltyCoefficients[ j ] );
+				const Vector scale = Equalities? Traits::broadcast( kinds.scales[ j ] ): zero;
+				const Vector tolerance = Equalities? Traits::broadcast( kinds.tolerances[ j ] ): zero;
+				const Vector violation0 = violationsOf< Traits, Equalities >( individualStride == 1?
+					Traits::load( first + position ):
+					Traits::gather( first + position, offsets ), scale, tolerance );
+				const Vector violation1 = violationsOf< Traits, Equalities >( individualStride == 1?
+					Traits::load( second + position ):
+					Traits::gather( second + position, offsets ), scale, tolerance );
+				const Mask positive0 = Traits::greater( violation0, zero );
+				const Mask positive1 = Traits::greater( violation1, zero );
+				penalty0 = Traits::add( penalty0, Traits::select( positive0, Traits::multiply( coefficient, violation0 ) ) );
+				penalty1 = Traits::add( penalty1, Traits::select( positive1, Traits::multiply( coefficient, violation1 ) ) );
+				violated0 = Traits::either( violated0, positive0 );
+				violated1 = Traits::either( violated1, positive1 );
+
+			}
+			Traits::store( penalties + k, penalty0 );
+			Traits::store( penalties + k + Traits::WIDTH, penalty1 );
+			const unsigned long long mask = Traits::bits( violated0 ) | ( (unsigned long long) Traits::bits( violated1 ) << Traits::WIDTH );
+			for( std::size_t lane=0; lane < step; lane++ ) {
+				infeasible[ k + lane ] = ( mask >> lane ) & 1;
+			}
+
+		}
+		calculatePenaltiesOf< Equalities, Value, Value >( penalties + k, infeasible + k, constraintViolationValues + k * individualStride,
+			count - k, individualStride, constraintStride, numberOfConstraints, penaltyCoefficients, kinds );
+
+	}
+
+	template< typename Traits >
+	void calculatePenaltiesVector(
+		typename Traits::Value* penalties,
+		unsigned char* infeasible,
+		const typename Traits::Value* constraintViolationValues,
+		std::size_t count,
+		std::size_t individualStride,
+		std::size_t constraintStride,
+		std::size_t numberOfConstraints,
+		const typename Traits::Value* penaltyCoefficients,
+		ConstraintKinds< typename Traits::Value > kinds ) {
+
+		if ( kinds.scales ) {
+			calculatePenaltiesVectorOf< Traits, true >( penalties, infeasible, constraintViolationValues, count,
+				individualStride, constraintStride, numberOfConstraints, penaltyCoefficients, kinds );
+		} else {
+			calculatePenaltiesVectorOf< Traits, false >( penalties, infeasible, constraintViolationValues, count,
+				individualStride, constraintStride, numberOfConstraints, penaltyCoefficients, kinds );
+		}
+
+	}
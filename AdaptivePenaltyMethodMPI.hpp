@@ -0,0 +1,189 @@
+/*
+ * File:   AdaptivePenaltyMethodMPI.hpp
+ * Author: Heder Soares Bernardino
+ *
+ * Evaluation of a population sharded across the processes of an MPI
+ * communicator: each process calculates the sums over its own shard
+ * (see BasicAdaptivePenaltyMethod::calculateLocalSums), the sums and
+ * the sizes of the shards are added by MPI_Allreduce, and every process
+ * calculates the penalty coefficients of the whole population. Then,
+ * each process calculates the fitness values of its shard with
+ * 'calculateFitness', e.g.:
+ * apm::calculateGlobalPenaltyCoefficients( method, MPI_COMM_WORLD, shardSize,
+ *     objectiveFunctionValues, constraintViolationValues, penaltyCoefficients );
+ * method.calculateFitness( fitnessValues, shardSize, objectiveFunctionValues,
+ *     constraintViolationValues, penaltyCoefficients );
+ * Thus, the violations are never sent to other processes.
+ *
+ * The order of the additions of MPI_Allreduce depends on the
+ * implementation of MPI, so the results are reproducible for a given
+ * number of processes, but they may differ in the last bits from the
+ * ones of a single process. The sizes of the shards are added exactly:
+ * when every 'Index' is exact as an 'Accumulator' value (e.g. 'int' and
+ * 'double'), they are added with the sums by a single MPI_Allreduce of
+ * 'numberOfConstraints + 2' values; otherwise (e.g. 'float' sums), the
+ * sums are added by an MPI_Allreduce of 'numberOfConstraints + 1' values
+ * and the sizes by another one of a 64-bit integer. std::overflow_error
+ * is thrown if the size of the whole population does not fit in 'Index'.
+ *
+ * Compilation:
+ * The functions are templates over the public methods of the
+ * AdaptivePenaltyMethod class, so it is only necessary to include this
+ * file in code compiled with MPI (e.g. by mpicxx) and to link the
+ * objects of the class (see AdaptivePenaltyMethod.hpp).
+ */
+
+#ifndef ADAPTIVEPENALTYMETHODMPI_HPP
+#define	ADAPTIVEPENALTYMETHODMPI_HPP
+
+/*
+ * Includes.
+ */
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
+#include <mpi.h>
+
+#include "AdaptivePenaltyMethod.hpp"
+
+namespace apm {
+
+namespace detail {
+
+	/*
+	 * MPI datatype of the sums.
+	 */
+	template< typename Accumulator >
+	MPI_Datatype mpiTypeOf( );
+
+	template<>
+	inline MPI_Datatype mpiTypeOf< float >( ) {
+		return MPI_FLOAT;
+	}
+
+	template<>
+	inline MPI_Datatype mpiTypeOf< double >( ) {
+		return MPI_DOUBLE;
+	}
+
+	template<>
+	inline MPI_Datatype mpiTypeOf< long double >( ) {
+		return MPI_LONG_DOUBLE;
+	}
+
+	/*
+	 * Number of the values added with the sums of a shard: its size, when
+	 * every 'Index' is exact as an 'Accumulator' value, or none.
+	 */
+	template< typename Accumulator, typename Index >
+	constexpr std::size_t SIZE_VALUES = std::numeric_limits< Accumulator >::digits >= std::numeric_limits< Index >::digits? 1: 0;
+
+	/*
+	 * Add the sums and the sizes of all the shards and calculate
+	 * the penalty coefficients of the population. 'sums' has the
+	 * 'numberOfConstraints + 1' sums of the shard and 'SIZE_VALUES'
+	 * other values.
+	 */
+	template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+	void reducePenaltyCoefficients(
+		BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >& method,
+		MPI_Comm communicator,
+		Index populationSize,
+		Buffer< Accumulator >& sums,
+		T* penaltyCoefficients ) {
+
+		const std::size_t numberOfConstraints = (std::size_t) method.getNumberOfConstraints( );
+		Index size;
+		if constexpr ( SIZE_VALUES< Accumulator, Index > == 1 ) {
+			//the sizes are exact as sums, so they are added with them
+			sums[ numberOfConstraints + 1 ] = (Accumulator) populationSize;
+			if ( MPI_Allreduce( MPI_IN_PLACE, sums.data( ), (int) sums.size( ), mpiTypeOf< Accumulator >( ), MPI_SUM,
+				communicator ) != MPI_SUCCESS ) {
+				throw std::runtime_error( "cannot add the sums of the shards of the population" );
+			}
+			if ( sums[ numberOfConstraints + 1 ] > (Accumulator) std::numeric_limits< Index >::max( ) ) {
+				throw std::overflow_error( "the size of the population does not fit in the index type" );
+			}
+			size = (Index) sums[ numberOfConstraints + 1 ];
+		} else {
+			//the sizes are added as 64-bit integers, which are exact for any population
+			std::int64_t total = (std::int64_t) populationSize;
+			if ( MPI_Allreduce( MPI_IN_PLACE, sums.data( ), (int) sums.size( ), mpiTypeOf< Accumulator >( ), MPI_SUM,
+				communicator ) != MPI_SUCCESS ||
+				MPI_Allreduce( MPI_IN_PLACE, &total, 1, MPI_INT64_T, MPI_SUM, communicator ) != MPI_SUCCESS ) {
+				throw std::runtime_error( "cannot add the sums of the shards of the population" );
+			}
+			if ( (std::uint64_t) total > (std::uint64_t) std::numeric_limits< Index >::max( ) ) {
+				throw std::overflow_error( "the size of the population does not fit in the index type" );
+			}
+			size = (Index) total;
+		}
+		method.calculatePenaltyCoefficientsFromSums( sums.data( ), size, penaltyCoefficients );
+
+	}
+
+}
+
+/*
+ * Name: calculateGlobalPenaltyCoefficients
+ * Description: Calculate the penalty coefficients of a population sharded
+ * across the processes of a communicator. It must be called by all the
+ * processes, each one with its shard, and all of them receive the
+ * penalty coefficients and the average of the objective function values
+ * of the whole population. Errors of MPI are thrown as std::runtime_error
+ * (with the default error handler, MPI aborts instead).
+ * Parameters:
+ * - method: the object of the process;
+ * - communicator: the processes which hold the shards;
+ * - populationSize: the number of candidate solutions of the shard;
+ * - objectiveFunctionValues, constraintViolationValues: values of the
+ * candidate solutions of the shard (see 'calculatePenaltyCoefficients');
+ * - penaltyCoefficients: penalty coefficients calculated by the adaptive
+ * penalty method and which are used by the penalty function.
+ */
+template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+void calculateGlobalPenaltyCoefficients(
+	BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >& method,
+	MPI_Comm communicator,
+	Index populationSize,
+	T* objectiveFunctionValues,
+	T** constraintViolationValues,
+	T* penaltyCoefficients ) {
+
+	detail::Buffer< Accumulator > sums( (std::size_t) method.getNumberOfConstraints( ) + 1 + detail::SIZE_VALUES< Accumulator, Index >,
+		method.getMemoryResource( ) );
+	method.calculateLocalSums( populationSize, objectiveFunctionValues, constraintViolationValues, sums.data( ) );
+	detail::reducePenaltyCoefficients( method, communicator, populationSize, sums, penaltyCoefficients );
+
+}
+
+/*
+ * Name: calculateGlobalPenaltyCoefficients
+ * Description: Same as the function above for the constraint violation
+ * values of the shard in a contiguous matrix.
+ */
+template< typename T, typename Accumulator, typename Index, int Constraints, bool Instrumented >
+void calculateGlobalPenaltyCoefficients(
+	BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented >& method,
+	MPI_Comm communicator,
+	Index populationSize,
+	const T* objectiveFunctionValues,
+	const T* constraintViolationValues,
+	ViolationLayout layout,
+	std::size_t leadingDimension,
+	T* penaltyCoefficients ) {
+
+	detail::Buffer< Accumulator > sums( (std::size_t) method.getNumberOfConstraints( ) + 1 + detail::SIZE_VALUES< Accumulator, Index >,
+		method.getMemoryResource( ) );
+	method.calculateLocalSums( populationSize, objectiveFunctionValues, constraintViolationValues, layout, leadingDimension,
+		sums.data( ) );
+	detail::reducePenaltyCoefficients( method, communicator, populationSize, sums, penaltyCoefficients );
+
+}
+
+}
+
+
+#endif	/* ADAPTIVEPENALTYMETHODMPI_HPP */
@@ -0,0 +1,143 @@
+/*
+ * File:   AdaptivePenaltyMethodParallel.cpp
+ * Author: Heder Soares Bernardino
+ *
+ * Thread pool used by the AdaptivePenaltyMethod class.
+ * Please, read AdaptivePenaltyMethodParallel.hpp file for more
+ * information.
+ *
+ * Compilation:
+ * Use the following command to compile this code:
+ * g++ -c -pthread AdaptivePenaltyMethodParallel.cpp
+ * Add '-fopenmp -DAPM_USE_OPENMP' to run the jobs with the threads of
+ * OpenMP instead of the workers of the pool.
+ */
+
+/*
+ * Includes.
+ */
+#include "AdaptivePenaltyMethodParallel.hpp"
+
+
+namespace apm {
+
+	ThreadPool& ThreadPool::shared( ) {
+		static ThreadPool pool;
+		return pool;
+	}
+
+	int ThreadPool::hardwareConcurrency( ) {
+		const unsigned int threads = std::thread::hardware_concurrency( );
+		return threads == 0? 1: (int) threads;
+	}
+
+	ThreadPool::ThreadPool( ):
+		task( 0 ),
+		context( 0 ),
+		numberOfTasks( 0 ),
+		numberOfHelpers( 0 ),
+		nextTask( 0 ),
+		activeWorkers( 0 ),
+		generation( 0 ),
+		stopping( false ) {
+	}
+
+	ThreadPool::~ThreadPool( ) {
+
+		{
+			std::lock_guard< std::mutex > lock( this->mutex );
+			this->stopping = true;
+		}
+		this->wakeUp.notify_all( );
+		for( std::size_t i=0; i < this->workers.size( ); i++ ) {
+			this->workers[ i ].join( );
+		}
+
+	}
+
+	void ThreadPool::work( ) {
+
+		int index;
+		while( ( index = this->nextTask.fetch_add( 1 ) ) < this->numberOfTasks ) {
+			this->task( this->context, index );
+		}
+
+	}
+
+	void ThreadPool::loop( int id ) {
+
+		unsigned long seen = 0;
+		std::unique_lock< std::mutex > lock( this->mutex );
+		while( true ) {
+
+			this->wakeUp.wait( lock, [ & ]( ) { return this->stopping || this->generation != seen; } );
+			if ( this->stopping ) {
+				return;
+			}
+			seen = this->generation;
+			//only the first 'numberOfHelpers' workers take part in the job
+			if ( id >= this->numberOfHelpers ) {
+				continue;
+			}
+
+			lock.unlock( );
+			this->work( );
+			lock.lock( );
+			if ( --this->activeWorkers == 0 ) {
+				this->finished.notify_one( );
+			}
+
+		}
+
+	}
+
+	void ThreadPool::run( int numberOfThreads, int numberOfTasks, Task task, void* context ) {
+
+		if ( numberOfTasks <= 0 ) {
+			return;
+		}
+		if ( numberOfThreads > numberOfTasks ) {
+			numberOfThreads = numberOfTasks;
+		}
+
+		std::unique_lock< std::mutex > job( this->busy, std::try_to_lock );
+		if ( numberOfThreads <= 1 || !job.owns_lock( ) ) {
+			for( int i=0; i < numberOfTasks; i++ ) {
+				task( context, i );
+			}
+			return;
+		}
+
+#ifdef APM_USE_OPENMP
+		//the tasks are shared by the threads of OpenMP instead of the workers
+#pragma omp parallel for schedule( dynamic, 1 ) num_threads( numberOfThreads )
+		for( int i=0; i < numberOfTasks; i++ ) {
+			task( context, i );
+		}
+#else
+		{
+			std::lock_guard< std::mutex > lock( this->mutex );
+			//the missing workers are created
+			while( (int) this->workers.size( ) < numberOfThreads - 1 ) {
+				this->workers.push_back( std::thread( &ThreadPool::loop, this, (int) this->workers.size( ) ) );
+			}
+			this->task = task;
+			this->context = context;
+			this->numberOfTasks = numberOfTasks;
+			this->numberOfHelpers = numberOfThreads - 1;
+			this->nextTask.store( 0 );
+			this->activeWorkers = numberOfThreads - 1;
+			this->generation++;
+		}
+		this->wakeUp.notify_all( );
+
+		//the calling thread also executes tasks
+		this->work( );
+
+		std::unique_lock< std::mutex > lock( this->mutex );
+		this->finished.wait( lock, [ & ]( ) { return this->activeWorkers == 0; } );
+#endif
+
+	}
+
+}
@@ -0,0 +1,127 @@
+/*
+ * File:   AdaptivePenaltyMethodParallel.hpp
+ * Author: Heder Soares Bernardino
+ *
+ * Thread pool used by the AdaptivePenaltyMethod class to split
+ * the population among threads.
+ *
+ * Compilation:
+ * g++ -c -pthread AdaptivePenaltyMethodParallel.cpp
+ * This will generate a 'AdaptivePenaltyMethodParallel.o' object file,
+ * which must be linked together with 'AdaptivePenaltyMethod.o'.
+ */
+
+#ifndef ADAPTIVEPENALTYMETHODPARALLEL_HPP
+#define	ADAPTIVEPENALTYMETHODPARALLEL_HPP
+
+/*
+ * Includes.
+ */
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace apm {
+
+/*
+ * A pool of worker threads shared by all the objects of the library.
+ * The threads are created the first time they are needed and are
+ * reused by the following calls.
+ */
+class ThreadPool {
+	public:
+		/*
+		 * Type of the tasks: 'task( context, index )' is called once
+		 * for each index of the job.
+		 */
+		typedef void ( *Task )( void* context, int index );
+
+		/*
+		 * Name: shared
+		 * Description: Return the pool shared by the library.
+		 */
+		static ThreadPool& shared( );
+
+		/*
+		 * Name: run
+		 * Description: Call 'task( context, i )' for 'i = 0, ..., numberOfTasks - 1'
+		 * using up to 'numberOfThreads' threads (the calling thread included) and
+		 * wait for all the calls to finish. The tasks are executed in any order,
+		 * so they must write to disjoint memory. If the pool is already in use
+		 * (e.g. 'run' is called from inside a task or concurrently from
+		 * another thread), the tasks are executed by the calling thread.
+		 * If the library is compiled with APM_USE_OPENMP, the tasks are
+		 * executed by a parallel loop of OpenMP instead of the workers.
+		 * Parameters:
+		 * - numberOfThreads: maximum number of threads;
+		 * - numberOfTasks: number of calls of the task;
+		 * - task: the function to be called;
+		 * - context: pointer passed to every call of the task.
+		 */
+		void run( int numberOfThreads, int numberOfTasks, Task task, void* context );
+
+		/*
+		 * Name: run
+		 * Description: Same as the method above, for any callable
+		 * object 'function' such that 'function( i )' is valid.
+		 */
+		template< typename Function >
+		void run( int numberOfThreads, int numberOfTasks, Function& function ) {
+			this->run( numberOfThreads, numberOfTasks, &ThreadPool::call< Function >, &function );
+		}
+
+		/*
+		 * Name: hardwareConcurrency
+		 * Description: Return the number of threads supported
+		 * by the hardware (at least 1).
+		 */
+		static int hardwareConcurrency( );
+
+		/*
+		 * Destructor. Stops the worker threads.
+		 */
+		~ThreadPool( );
+
+	private:
+		ThreadPool( );
+		ThreadPool( const ThreadPool& );
+		ThreadPool& operator=( const ThreadPool& );
+
+		template< typename Function >
+		static void call( void* context, int index ) {
+			( *static_cast< Function* >( context ) )( index );
+		}
+
+		/*
+		 * Execute tasks of the current job until there are no more.
+		 */
+		void work( );
+
+		/*
+		 * Loop of the worker threads.
+		 */
+		void loop( int id );
+
+		std::vector< std::thread > workers;
+		//protects the state of the job
+		std::mutex mutex;
+		std::condition_variable wakeUp;
+		std::condition_variable finished;
+		//serializes the jobs
+		std::mutex busy;
+		//the current job
+		Task task;
+		void* context;
+		int numberOfTasks;
+		int numberOfHelpers;
+		std::atomic< int > nextTask;
+		int activeWorkers;
+		unsigned long generation;
+		bool stopping;
+};
+
+}
+
+#endif	/* ADAPTIVEPENALTYMETHODPARALLEL_HPP */
@@ -0,0 +1,295 @@
+/*
+ * File:   AdaptivePenaltyMethodPipeline.hpp
+ * Author: Heder Soares Bernardino
+ *
+ * Evaluation of a generation whose candidate solutions arrive in
+ * chunks, e.g. from evaluators of the objective function which finish
+ * at different times: each chunk is accumulated as soon as it is pushed,
+ * so the calculation of the penalty coefficients overlaps the evaluation
+ * of the remaining chunks, and the fitness values of every chunk are
+ * calculated when the last chunk arrives. Each push returns a
+ * std::future which is ready when the fitness values of its chunk are, e.g.:
+ * apm::GenerationPipeline< double > pipeline( method, populationSize, penaltyCoefficients );
+ * //in the thread of each evaluator
+ * std::future< void > scored = pipeline.push( first, size, fitnessValues + first,
+ *     objectiveFunctionValues + first, constraintViolationValues + first * m, apm::ROW_MAJOR, m );
+ * //in the thread of the selection
+ * scored.get( );
+ *
+ * Compilation:
+ * The pipeline is a template over the public methods of the
+ * AdaptivePenaltyMethod class, so it is only necessary to include this
+ * file and to link the objects of the class (see AdaptivePenaltyMethod.hpp).
+ */
+
+#ifndef ADAPTIVEPENALTYMETHODPIPELINE_HPP
+#define	ADAPTIVEPENALTYMETHODPIPELINE_HPP
+
+/*
+ * Includes.
+ */
+#include <exception>
+#include <future>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <stdexcept>
+
+#include "AdaptivePenaltyMethod.hpp"
+
+namespace apm {
+
+/*
+ * The evaluation of one generation by a BasicAdaptivePenaltyMethod
+ * whose chunks (see BasicAdaptivePenaltyMethod::accumulateChunk) are
+ * pushed by any number of threads. The chunks must cover the population
+ * given to the constructor; so that the results are the ones of the
+ * whole population, each chunk must start at a multiple of
+ * REDUCTION_BLOCK_SIZE and, except for the last one, its size must be a
+ * multiple of REDUCTION_BLOCK_SIZE. The thread which pushes the last
+ * chunk calculates the penalty coefficients and the fitness values of
+ * all the chunks. The values of a chunk must not change until its
+ * future is ready, and the method must not be used by other code until
+ * the generation is complete. If the chunks are pushed concurrently,
+ * the memory resource of the method must be thread-safe.
+ */
+template< typename T, typename Accumulator = T, typename Index = int, int Constraints = 0, bool Instrumented = false >
+class GenerationPipeline {
+	public:
+		typedef BasicAdaptivePenaltyMethod< T, Accumulator, Index, Constraints, Instrumented > Method;
+		typedef std::shared_ptr< const CoefficientSnapshot< T, Accumulator > > Snapshot;
+
+		/*
+		 * Constructor.
+		 * Parameters:
+		 * - method: the object which calculates the penalty coefficients,
+		 * which must outlive the pipeline;
+		 * - populationSize: the number of candidate solutions of the generation;
+		 * - penaltyCoefficients: the penalty coefficients calculated by
+		 * the generation (see BasicAdaptivePenaltyMethod::finalize);
+		 * - resource: the memory resource of the pending chunks.
+		 */
+		GenerationPipeline(
+			Method& method,
+			Index populationSize,
+			T* penaltyCoefficients,
+			std::pmr::memory_resource* resource = std::pmr::get_default_resource( ) ):
+			method( method ),
+			populationSize( populationSize ),
+			penaltyCoefficients( penaltyCoefficients ),
+			reserved( 0 ),
+			accumulated( 0 ),
+			complete( false ),
+			chunks( resource ),
+			snapshot( snapshotPromise.get_future( ).share( ) ) {
+
+			if ( populationSize <= 0 ) {
+				throw std::invalid_argument( "the population must not be empty" );
+			}
+
+		}
+
+		GenerationPipeline( const GenerationPipeline& ) = delete;
+		GenerationPipeline& operator=( const GenerationPipeline& ) = delete;
+
+	/*
+	 * Name: push
+	 * Description: Accumulate a chunk of candidate solutions and return
+	 * a future which is ready when its fitness values are calculated (or
+	 * holds the exception thrown by the calculation of the coefficients).
+	 * The exceptions of the accumulation (see
+	 * BasicAdaptivePenaltyMethod::accumulateChunk) are thrown by this
+	 * method. std::logic_error is thrown, and the chunk is not accumulated,
+	 * if it is beyond the population, if it would make the pushed chunks
+	 * larger than the population or if the generation is complete.
+	 * Parameters:
+	 * - firstIndividual: position of the first candidate solution of the
+	 * chunk in the population;
+	 * - chunkSize: number of candidate solutions in the chunk;
+	 * - fitnessValues: the fitness values of the chunk;
+	 * - objectiveFunctionValues, constraintViolationValues: values of the
+	 * candidate solutions of the chunk (see 'accumulateChunk').
+	 */
+	 std::future< void > push(
+		Index firstIndividual,
+		Index chunkSize,
+		T* fitnessValues,
+		T* objectiveFunctionValues,
+		T** constraintViolationValues ) {
+
+		 this->reserve( firstIndividual, chunkSize );
+		 try {
+			 this->method.accumulateChunk( firstIndividual, chunkSize, objectiveFunctionValues, constraintViolationValues );
+		 } catch( ... ) {
+			 this->release( chunkSize );
+			 throw;
+		 }
+		 const Chunk chunk = { chunkSize, fitnessValues, objectiveFunctionValues, constraintViolationValues, 0, ROW_MAJOR, 0 };
+		 return this->pending( chunk );
+	 }
+
+	/*
+	 * Name: push
+	 * Description: Same as the method above for the constraint violation
+	 * values of the chunk in a contiguous matrix ('leadingDimension'
+	 * concerns the matrix of the chunk).
+	 */
+	 std::future< void > push(
+		Index firstIndividual,
+		Index chunkSize,
+		T* fitnessValues,
+		const T* objectiveFunctionValues,
+		const T* constraintViolationValues,
+		ViolationLayout layout,
+		std::size_t leadingDimension ) {
+
+		 this->reserve( firstIndividual, chunkSize );
+		 try {
+			 this->method.accumulateChunk( firstIndividual, chunkSize, objectiveFunctionValues, constraintViolationValues,
+				 layout, leadingDimension );
+		 } catch( ... ) {
+			 this->release( chunkSize );
+			 throw;
+		 }
+		 const Chunk chunk = { chunkSize, fitnessValues, objectiveFunctionValues, 0, constraintViolationValues, layout, leadingDimension };
+		 return this->pending( chunk );
+	 }
+
+	/*
+	 * Name: getSnapshot
+	 * Description: Return a future of the snapshot of the penalty
+	 * coefficients of the generation (see CoefficientSnapshot), which is
+	 * ready before the fitness values of the chunks are calculated.
+	 */
+	 std::shared_future< Snapshot > getSnapshot( ) const {
+		 return this->snapshot;
+	 }
+
+	private:
+		/*
+		 * A chunk whose fitness values are not calculated yet.
+		 */
+		struct Chunk {
+			Index size;
+			T* fitnessValues;
+			const T* objectiveFunctionValues;
+			const T* const* rows;
+			const T* values;
+			ViolationLayout layout;
+			std::size_t leadingDimension;
+		};
+
+		struct PendingChunk {
+			Chunk chunk;
+			std::promise< void > scored;
+		};
+
+		/*
+		 * Reserve the place of a chunk in the population before it is
+		 * accumulated, so a chunk pushed after the population is covered
+		 * never reaches the method (which may be used by the next generation).
+		 */
+		void reserve( Index firstIndividual, Index chunkSize ) {
+			if ( firstIndividual < 0 || chunkSize < 0 || chunkSize > this->populationSize - firstIndividual ) {
+				throw std::logic_error( "the chunk is beyond the population" );
+			}
+			std::lock_guard< std::mutex > lock( this->mutex );
+			if ( this->complete ) {
+				throw std::logic_error( "the generation is complete" );
+			}
+			if ( chunkSize > this->populationSize - this->reserved ) {
+				throw std::logic_error( "the chunks are larger than the population" );
+			}
+			this->reserved += chunkSize;
+		}
+
+		/*
+		 * Release the place of a chunk which was not accumulated.
+		 */
+		void release( Index chunkSize ) {
+			std::lock_guard< std::mutex > lock( this->mutex );
+			this->reserved -= chunkSize;
+		}
+
+		/*
+		 * Record an accumulated chunk and, if it completes the population,
+		 * calculate the coefficients and the fitness values of all the chunks.
+		 */
+		std::future< void > pending( const Chunk& chunk ) {
+
+			std::size_t c;
+			std::future< void > scored;
+			{
+				std::lock_guard< std::mutex > lock( this->mutex );
+				this->chunks.emplace_back( );
+				this->chunks.back( ).chunk = chunk;
+				scored = this->chunks.back( ).scored.get_future( );
+				this->accumulated += chunk.size;
+				if ( this->accumulated < this->populationSize ) {
+					return scored;
+				}
+				this->complete = true;
+			}
+
+			//the other chunks were all pushed, so the chunks are not changed anymore
+			Snapshot coefficients;
+			try {
+				this->method.finalize( this->penaltyCoefficients );
+				coefficients = this->method.makeSnapshot( this->penaltyCoefficients );
+			} catch( ... ) {
+				const std::exception_ptr error = std::current_exception( );
+				this->snapshotPromise.set_exception( error );
+				for( c=0; c < this->chunks.size( ); c++ ) {
+					this->chunks[ c ].scored.set_exception( error );
+				}
+				return scored;
+			}
+			this->snapshotPromise.set_value( coefficients );
+
+			const int threadCount = this->method.getThreadCount( );
+			c = 0;
+			try {
+				for( ; c < this->chunks.size( ); c++ ) {
+
+					const Chunk& pending = this->chunks[ c ].chunk;
+					if ( pending.rows ) {
+						coefficients->calculateFitness( pending.fitnessValues, (std::size_t) pending.size, pending.objectiveFunctionValues,
+							pending.rows, threadCount );
+					} else {
+						coefficients->calculateFitness( pending.fitnessValues, (std::size_t) pending.size, pending.objectiveFunctionValues,
+							pending.values, pending.layout, pending.leadingDimension, threadCount );
+					}
+					this->chunks[ c ].scored.set_value( );
+
+				}
+			} catch( ... ) {
+				//the chunk which failed and the following ones are not scored
+				const std::exception_ptr error = std::current_exception( );
+				for( ; c < this->chunks.size( ); c++ ) {
+					this->chunks[ c ].scored.set_exception( error );
+				}
+			}
+			return scored;
+
+		}
+
+		Method& method;
+		Index populationSize;
+		T* penaltyCoefficients;
+		//guards the sizes, 'complete' and 'chunks' while the chunks are pushed:
+		//the sizes of the chunks pushed, including the ones being accumulated,
+		//and of the ones accumulated
+		std::mutex mutex;
+		Index reserved;
+		Index accumulated;
+		bool complete;
+		detail::Buffer< PendingChunk > chunks;
+		std::promise< Snapshot > snapshotPromise;
+		std::shared_future< Snapshot > snapshot;
+
+};
+
+}
+
+
+#endif	/* ADAPTIVEPENALTYMETHODPIPELINE_HPP */
@@ -14,6 +14,7 @@
  * Use the following command to compile this code:
  * gcc -c apm.c
  * This will generate a 'apm.o' object file.
+ * The functions are declared in the 'apm.h' file.
  */
 
 /*
@@ -21,35 +22,21 @@
  */
 #include <stdlib.h>
 
+#include "apm.h"
+
 /*
- * Name: calculatePenaltyCoefficients
- * Description: Calculate the penalty coefficients 
- * using the objective function and constraint violation
- * values by using APM ideas.
- * Also, the average of the objective function values is
- * calculated to be used for the calculation of the fitness values.
- * Parameters:
- * - populationSize: number of candidate solutions
- * in the population. This value defines the number
- * of elements indicated by the pointers;
- * - objectiveFunctionValues: values of the objective
- * function obtained by evaluating the candidate solutions;
- * - constraintViolationValues: values of the constraint 
- * violations obtained by evaluating the candidate violations;
- * - numberOfConstraints: the number of constraints of the
- * problem.
- * - penaltyCoefficients: penalty coefficients
- * calculated by the adaptive penalty method and which
- * are used by the penalty function.
- * - averageObjectiveFunctionValues: a pointer which is used to 
- * archive the average of the objective function values.
+ * Name: accumulatePenaltyCoefficients
+ * Description: Calculate the sums of the constraint violation values
+ * into 'sumViolation', the average of the objective function values
+ * and the penalty coefficients. 'sumViolation' may be the same array
+ * as 'penaltyCoefficients', so no additional memory is needed.
  */
-
-void calculatePenaltyCoefficients(
+static void accumulatePenaltyCoefficients(
 	int populationSize,
 	double* objectiveFunctionValues,
 	double** constraintViolationValues,
 	int numberOfConstraints,
+	double* sumViolation,
 	double* penaltyCoefficients, 
 	double* averageObjectiveFunctionValues) {
 
@@ -75,7 +62,6 @@ void calculatePenaltyCoefficients(
 	double denominator = 0;
 	//the sum of the constraint violation values
 	//these values are recorded to be used in the next situation
-	double* sumViolation = (double*) malloc(numberOfConstraints * sizeof ( double));
 	for (l = 0; l < numberOfConstraints; l++) {
 
 		sumViolation[ l ] = 0;
@@ -89,14 +75,150 @@ void calculatePenaltyCoefficients(
 	}
 
 	//the penalty coefficients are calculated
+	//(each sum is read before the coefficient which may replace it is written)
 	for (j = 0; j < numberOfConstraints; j++) {
 
 		penaltyCoefficients[ j ] = denominator == 0? 0: (sumObjectiveFunction / denominator) * sumViolation[ j ];
 
 	}
 
-	//remove auxiliary variables
-	free(sumViolation);
+}
+
+
+/*
+ * Name: initializeWorkspace
+ * Description: Allocate the memory of a workspace.
+ * Returns 0 on success and -1 if the memory could not be allocated.
+ * Parameters:
+ * - workspace: the workspace to be initialized;
+ * - numberOfConstraints: the number of constraints of the
+ * problem.
+ */
+int initializeWorkspace(
+	APMWorkspace* workspace,
+	int numberOfConstraints) {
+
+	workspace->numberOfConstraints = numberOfConstraints;
+	workspace->averageObjectiveFunctionValues = 0;
+	workspace->ownsMemory = 1;
+	workspace->sumViolation = (double*) malloc((numberOfConstraints > 0? numberOfConstraints: 1) * sizeof ( double));
+	if (!workspace->sumViolation) {
+		workspace->ownsMemory = 0;
+		return -1;
+	}
+	return 0;
+
+}
+
+
+/*
+ * Name: attachWorkspace
+ * Description: Initialize a workspace with memory provided by
+ * the caller, which must outlive the workspace.
+ * Parameters:
+ * - workspace: the workspace to be initialized;
+ * - numberOfConstraints: the number of constraints of the
+ * problem.
+ * - sumViolation: an array of 'numberOfConstraints' values.
+ */
+void attachWorkspace(
+	APMWorkspace* workspace,
+	int numberOfConstraints,
+	double* sumViolation) {
+
+	workspace->numberOfConstraints = numberOfConstraints;
+	workspace->sumViolation = sumViolation;
+	workspace->averageObjectiveFunctionValues = 0;
+	workspace->ownsMemory = 0;
+
+}
+
+
+/*
+ * Name: releaseWorkspace
+ * Description: Release the memory allocated by 'initializeWorkspace'.
+ * Parameters:
+ * - workspace: the workspace to be released.
+ */
+void releaseWorkspace(
+	APMWorkspace* workspace) {
+
+	if (workspace->ownsMemory) {
+		free(workspace->sumViolation);
+	}
+	workspace->sumViolation = 0;
+	workspace->ownsMemory = 0;
+
+}
+
+
+/*
+ * Name: calculatePenaltyCoefficients
+ * Description: Calculate the penalty coefficients 
+ * using the objective function and constraint violation
+ * values by using APM ideas.
+ * Also, the average of the objective function values is
+ * calculated to be used for the calculation of the fitness values.
+ * Parameters:
+ * - populationSize: number of candidate solutions
+ * in the population. This value defines the number
+ * of elements indicated by the pointers;
+ * - objectiveFunctionValues: values of the objective
+ * function obtained by evaluating the candidate solutions;
+ * - constraintViolationValues: values of the constraint 
+ * violations obtained by evaluating the candidate violations;
+ * - numberOfConstraints: the number of constraints of the
+ * problem.
+ * - penaltyCoefficients: penalty coefficients
+ * calculated by the adaptive penalty method and which
+ * are used by the penalty function.
+ * - averageObjectiveFunctionValues: a pointer which is used to 
+ * archive the average of the objective function values.
+ */
+
+void calculatePenaltyCoefficients(
+	int populationSize,
+	double* objectiveFunctionValues,
+	double** constraintViolationValues,
+	int numberOfConstraints,
+	double* penaltyCoefficients, 
+	double* averageObjectiveFunctionValues) {
+
+	//the sums of the constraint violation values are calculated in the
+	//array of the penalty coefficients, so no memory is allocated
+	accumulatePenaltyCoefficients(populationSize, objectiveFunctionValues, constraintViolationValues,
+		numberOfConstraints, penaltyCoefficients, penaltyCoefficients, averageObjectiveFunctionValues);
+
+}
+
+
+/*
+ * Name: calculatePenaltyCoefficientsWithWorkspace
+ * Description: Same as 'calculatePenaltyCoefficients', but the sums
+ * of the constraint violation values and the average of the objective
+ * function values are kept in a workspace. No memory is allocated.
+ * Parameters:
+ * - workspace: a workspace with the number of constraints of the problem;
+ * - populationSize: number of candidate solutions
+ * in the population;
+ * - objectiveFunctionValues: values of the objective
+ * function obtained by evaluating the candidate solutions;
+ * - constraintViolationValues: values of the constraint 
+ * violations obtained by evaluating the candidate violations;
+ * - penaltyCoefficients: penalty coefficients
+ * calculated by the adaptive penalty method and which
+ * are used by the penalty function.
+ */
+void calculatePenaltyCoefficientsWithWorkspace(
+	APMWorkspace* workspace,
+	int populationSize,
+	double* objectiveFunctionValues,
+	double** constraintViolationValues,
+	double* penaltyCoefficients) {
+
+	accumulatePenaltyCoefficients(populationSize, objectiveFunctionValues, constraintViolationValues,
+		workspace->numberOfConstraints, workspace->sumViolation, penaltyCoefficients,
+		&workspace->averageObjectiveFunctionValues);
 
 }
 
@@ -175,6 +297,26 @@ void calculateAllFitness(
 }
 
 
+/*
+ * Name: calculateAllFitnessWithWorkspace
+ * Description: Same as 'calculateAllFitness', using the number of
+ * constraints and the average of the objective function values of
+ * a workspace (calculated by 'calculatePenaltyCoefficientsWithWorkspace').
+ */
+void calculateAllFitnessWithWorkspace(
+	const APMWorkspace* workspace,
+	double* fitnessValues,
+	int populationSize,
+	double* objectiveFunctionValues,
+	double** constraintViolationValues,
+	double* penaltyCoefficients) {
+
+	calculateAllFitness(fitnessValues, populationSize, objectiveFunctionValues, constraintViolationValues,
+		workspace->numberOfConstraints, penaltyCoefficients, workspace->averageObjectiveFunctionValues);
+
+}
+
+
 /*
  * Name: calculateFitness
  * Description: This function calculates the fitness values using 
@@ -0,0 +1,353 @@
+/*
+ * File:   apm.h
+ * Author: Heder Soares Bernardino
+ *
+ * Declarations of the functions implemented in apm.c, the
+ * implementation in C programming language of the
+ * Adaptive Penalty Method proposed by H.J.C. Barbosa
+ * and A.C.C. Lemonge in 2003.
+ * Please, read README file for more information about
+ * the method.
+ *
+ * Compilation:
+ * Use the following command to compile the implementation:
+ * gcc -c apm.c
+ * This will generate a 'apm.o' object file, which must be linked
+ * to the code which includes this file.
+ * The functions of the shared core (see 'createMethod') are compiled
+ * separately, from the C++ implementation.
+ */
+
+#ifndef APM_H
+#define	APM_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Memory reused by the calculation of the penalty coefficients
+ * along the generations, so that no memory is allocated by
+ * 'calculatePenaltyCoefficientsWithWorkspace' and
+ * 'calculateAllFitnessWithWorkspace'.
+ * A workspace is created once by 'initializeWorkspace' (or by
+ * 'attachWorkspace', with memory provided by the caller) and
+ * destroyed by 'releaseWorkspace'. A workspace must not be used
+ * by two threads at the same time; use one per optimizer instead.
+ * - numberOfConstraints: the number of constraints of the problem;
+ * - sumViolation: the sums of the constraint violation values of
+ * the last population;
+ * - averageObjectiveFunctionValues: the average of the objective
+ * function values of the last population;
+ * - ownsMemory: indicates if 'sumViolation' is released by
+ * 'releaseWorkspace'.
+ */
+typedef struct {
+	int numberOfConstraints;
+	double* sumViolation;
+	double averageObjectiveFunctionValues;
+	int ownsMemory;
+} APMWorkspace;
+
+/*
+ * Name: initializeWorkspace
+ * Description: Allocate the memory of a workspace.
+ * Returns 0 on success and -1 if the memory could not be allocated.
+ * Parameters:
+ * - workspace: the workspace to be initialized;
+ * - numberOfConstraints: the number of constraints of the
+ * problem.
+ */
+int initializeWorkspace(
+	APMWorkspace* workspace,
+	int numberOfConstraints);
+
+/*
+ * Name: attachWorkspace
+ * Description: Initialize a workspace with memory provided by
+ * the caller, which must outlive the workspace.
+ * Parameters:
+ * - workspace: the workspace to be initialized;
+ * - numberOfConstraints: the number of constraints of the
+ * problem.
+ * - sumViolation: an array of 'numberOfConstraints' values.
+ */
+void attachWorkspace(
+	APMWorkspace* workspace,
+	int numberOfConstraints,
+	double* sumViolation);
+
+/*
+ * Name: releaseWorkspace
+ * Description: Release the memory allocated by 'initializeWorkspace'.
+ * Parameters:
+ * - workspace: the workspace to be released.
+ */
+void releaseWorkspace(
+	APMWorkspace* workspace);
+
+/*
+ * Name: calculatePenaltyCoefficients
+ * Description: Calculate the penalty coefficients and the average
+ * of the objective function values (see apm.c).
+ */
+void calculatePenaltyCoefficients(
+	int populationSize,
+	double* objectiveFunctionValues,
+	double** constraintViolationValues,
+	int numberOfConstraints,
+	double* penaltyCoefficients,
+	double* averageObjectiveFunctionValues);
+
+/*
+ * Name: calculatePenaltyCoefficientsWithWorkspace
+ * Description: Same as 'calculatePenaltyCoefficients', but the sums
+ * of the constraint violation values and the average of the objective
+ * function values are kept in a workspace.
+ * Parameters:
+ * - workspace: a workspace with the number of constraints of the problem;
+ * - populationSize: number of candidate solutions
+ * in the population;
+ * - objectiveFunctionValues: values of the objective
+ * function obtained by evaluating the candidate solutions;
+ * - constraintViolationValues: values of the constraint
+ * violations obtained by evaluating the candidate violations;
+ * - penaltyCoefficients: penalty coefficients
+ * calculated by the adaptive penalty method and which
+ * are used by the penalty function.
+ */
+void calculatePenaltyCoefficientsWithWorkspace(
+	APMWorkspace* workspace,
+	int populationSize,
+	double* objectiveFunctionValues,
+	double** constraintViolationValues,
+	double* penaltyCoefficients);
+
+/*
+ * Name: calculateAllFitness
+ * Description: Calculate the fitness values of the candidate
+ * solutions (see apm.c).
+ */
+void calculateAllFitness(
+	double* fitnessValues,
+	int populationSize,
+	double* objectiveFunctionValues,
+	double** constraintViolationValues,
+	int numberOfConstraints,
+	double* penaltyCoefficients,
+	double averageObjectiveFunctionValues);
+
+/*
+ * Name: calculateAllFitnessWithWorkspace
+ * Description: Same as 'calculateAllFitness', using the number of
+ * constraints and the average of the objective function values of
+ * a workspace (calculated by 'calculatePenaltyCoefficientsWithWorkspace').
+ */
+void calculateAllFitnessWithWorkspace(
+	const APMWorkspace* workspace,
+	double* fitnessValues,
+	int populationSize,
+	double* objectiveFunctionValues,
+	double** constraintViolationValues,
+	double* penaltyCoefficients);
+
+/*
+ * Name: calculateFitness
+ * Description: Calculate the fitness value of a candidate
+ * solution (see apm.c).
+ */
+double calculateFitness(
+	double objectiveFunctionValue,
+	double* constraintViolationValues,
+	int numberOfConstraints,
+	double* penaltyCoefficients,
+	double averageObjectiveFunctionValues);
+
+/*
+ * Functions of the shared core. They are implemented over the
+ * AdaptivePenaltyMethod C++ class by AdaptivePenaltyMethodC.cpp, so
+ * they give the same results as the class and have its features: the
+ * population may be split among threads (the results do not depend
+ * on the number of threads), the constraint violation values may be
+ * given in contiguous matrices and the SIMD kernels of the processor
+ * are selected at run time.
+ * Use the following command to compile the implementation:
+ * g++ -c -pthread AdaptivePenaltyMethodC.cpp AdaptivePenaltyMethod.cpp AdaptivePenaltyMethodKernels.cpp AdaptivePenaltyMethodParallel.cpp
+ * and link the object files with the C++ compiler (or with
+ * -lstdc++ -pthread).
+ * The functions above are not implemented over the shared core: apm.c
+ * must still compile alone with a C compiler, the functions with a
+ * workspace promise that no memory is allocated, and their sums are
+ * added in the order of the original implementation, whose results
+ * are then kept bit for bit. Use the functions below for the features
+ * of the class.
+ */
+
+/*
+ * Values returned by the functions of the shared core.
+ * - APM_SUCCESS: the function succeeded;
+ * - APM_OUT_OF_MEMORY: the memory could not be allocated (the buffers
+ * of an object grow with the population);
+ * - APM_INVALID_ARGUMENT: an argument is not valid, e.g. a leading
+ * dimension smaller than the number of constraints;
+ * - APM_FAILURE: any other failure, e.g. of the creation of the threads.
+ */
+typedef enum {
+	APM_SUCCESS = 0,
+	APM_OUT_OF_MEMORY = -1,
+	APM_INVALID_ARGUMENT = -2,
+	APM_FAILURE = -3
+} APMStatus;
+
+/*
+ * An object of the shared core, which keeps the sums and the average
+ * of the objective function values of the last population. An object
+ * must not be used by two threads at the same time.
+ */
+typedef struct APMMethod APMMethod;
+
+/*
+ * Memory layouts of a contiguous matrix of constraint violation values.
+ * - APM_ROW_MAJOR: the violation of constraint 'j' by candidate solution
+ * 'i' is at position 'i * leadingDimension + j';
+ * - APM_COLUMN_MAJOR: the violation of constraint 'j' by candidate
+ * solution 'i' is at position 'j * leadingDimension + i'.
+ */
+typedef enum {
+	APM_ROW_MAJOR,
+	APM_COLUMN_MAJOR
+} APMLayout;
+
+/*
+ * Name: createMethod
+ * Description: Create an object of the shared core.
+ * Returns the object or 0 if the memory could not be allocated
+ * or if 'numberOfConstraints' is negative.
+ * Parameters:
+ * - numberOfConstraints: the number of constraints of the
+ * problem.
+ */
+APMMethod* createMethod(
+	int numberOfConstraints);
+
+/*
+ * Name: destroyMethod
+ * Description: Release an object created by 'createMethod'.
+ */
+void destroyMethod(
+	APMMethod* method);
+
+/*
+ * Name: setMethodThreads
+ * Description: Set the maximum number of threads used by an object
+ * (1 by default; 0 selects the number of threads of the hardware).
+ */
+void setMethodThreads(
+	APMMethod* method,
+	int numberOfThreads);
+
+/*
+ * Name: getMethodAverageObjectiveFunctionValues
+ * Description: Return the average of the objective function values
+ * of the last population.
+ */
+double getMethodAverageObjectiveFunctionValues(
+	const APMMethod* method);
+
+/*
+ * Name: calculatePenaltyCoefficientsWithMethod
+ * Description: Same as 'calculatePenaltyCoefficients', with the
+ * average of the objective function values kept in the object.
+ * Returns APM_SUCCESS or the code of the failure (see APMStatus).
+ */
+int calculatePenaltyCoefficientsWithMethod(
+	APMMethod* method,
+	int populationSize,
+	double* objectiveFunctionValues,
+	double** constraintViolationValues,
+	double* penaltyCoefficients);
+
+/*
+ * Name: calculatePenaltyCoefficientsContiguous
+ * Description: Same as 'calculatePenaltyCoefficientsWithMethod' for
+ * constraint violation values in a contiguous matrix.
+ * Parameters:
+ * - layout, leadingDimension: the layout of 'constraintViolationValues'
+ * (see APMLayout); 'leadingDimension' is at least the number of
+ * constraints (APM_ROW_MAJOR) or the population size (APM_COLUMN_MAJOR).
+ */
+int calculatePenaltyCoefficientsContiguous(
+	APMMethod* method,
+	int populationSize,
+	const double* objectiveFunctionValues,
+	const double* constraintViolationValues,
+	APMLayout layout,
+	size_t leadingDimension,
+	double* penaltyCoefficients);
+
+/*
+ * Name: calculateAllFitnessWithMethod
+ * Description: Same as 'calculateAllFitness', using the average of the
+ * objective function values kept in the object. Returns APM_SUCCESS or
+ * the code of the failure (see APMStatus).
+ */
+int calculateAllFitnessWithMethod(
+	const APMMethod* method,
+	double* fitnessValues,
+	int populationSize,
+	double* objectiveFunctionValues,
+	double** constraintViolationValues,
+	double* penaltyCoefficients);
+
+/*
+ * Name: calculateAllFitnessContiguous
+ * Description: Same as 'calculateAllFitnessWithMethod' for constraint
+ * violation values in a contiguous matrix.
+ */
+int calculateAllFitnessContiguous(
+	const APMMethod* method,
+	double* fitnessValues,
+	int populationSize,
+	const double* objectiveFunctionValues,
+	const double* constraintViolationValues,
+	APMLayout layout,
+	size_t leadingDimension,
+	const double* penaltyCoefficients);
+
+/*
+ * Name: evaluateGenerationWithMethod
+ * Description: Calculate the penalty coefficients and the fitness
+ * values of a population reading the constraint violation values once
+ * for the feasible candidate solutions. Returns APM_SUCCESS or the code
+ * of the failure (see APMStatus).
+ */
+int evaluateGenerationWithMethod(
+	APMMethod* method,
+	double* fitnessValues,
+	int populationSize,
+	double* objectiveFunctionValues,
+	double** constraintViolationValues,
+	double* penaltyCoefficients);
+
+/*
+ * Name: evaluateGenerationContiguous
+ * Description: Same as 'evaluateGenerationWithMethod' for constraint
+ * violation values in a contiguous matrix.
+ */
+int evaluateGenerationContiguous(
+	APMMethod* method,
+	double* fitnessValues,
+	int populationSize,
+	const double* objectiveFunctionValues,
+	const double* constraintViolationValues,
+	APMLayout layout,
+	size_t leadingDimension,
+	double* penaltyCoefficients);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* APM_H */
@@ -0,0 +1,253 @@
+/*
+ * File:   AdaptivePenaltyMethodBenchmark.cpp
+ * Author: Heder Soares Bernardino
+ *
+ * Benchmarks of the calculation of the penalty coefficients and of
+ * the fitness values, for the AdaptivePenaltyMethod class and for the
+ * functions of apm.c. They sweep the population size (1e2 to 1e7), the
+ * number of constraints (1 to 1000) and the ratio of feasible candidate
+ * solutions (0% to 100%, which changes the behaviour of the branches).
+ * Each benchmark reports the time per candidate solution (time/individual,
+ * e.g. 2.5ns) and the bandwidth (bytes_per_second) of the values read
+ * and written.
+ * The populations with more than APM_BENCHMARK_MAX_VALUES constraint
+ * violation values are skipped.
+ *
+ * Compilation:
+ * Use the following commands, in the root directory of the project, to
+ * compile and run the benchmarks (Google Benchmark is required):
+ * gcc -O2 -c apm.c
+ * g++ -O2 -pthread -I. benchmarks/AdaptivePenaltyMethodBenchmark.cpp AdaptivePenaltyMethod.cpp AdaptivePenaltyMethodKernels.cpp AdaptivePenaltyMethodParallel.cpp apm.o -lbenchmark -o apm-benchmark
+ * ./apm-benchmark --benchmark_filter=Coefficients
+ * The usual options of Google Benchmark (e.g. '--benchmark_format=json'
+ * to keep the results and compare them later) are accepted.
+ */
+
+/*
+ * Includes.
+ */
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "AdaptivePenaltyMethod.hpp"
+#include "apm.h"
+
+#ifndef APM_BENCHMARK_MAX_VALUES
+#define APM_BENCHMARK_MAX_VALUES ( 1 << 26 )
+#endif
+
+namespace {
+
+	/*
+	 * A population with random objective function and constraint
+	 * violation values, stored as a pointer table as expected by the
+	 * original interfaces.
+	 * - feasibleRatio: the percentage of feasible candidate solutions,
+	 * which are spread at random along the population;
+	 * - an infeasible candidate solution violates each constraint with
+	 * probability 1/2 and, at least, one of them.
+	 */
+	struct Population {
+		int populationSize;
+		int numberOfConstraints;
+		std::vector< double > objectiveFunctionValues;
+		std::vector< double > violations;
+		std::vector< double* > constraintViolationValues;
+		std::vector< double > penaltyCoefficients;
+		std::vector< double > fitnessValues;
+
+		Population( int populationSize, int numberOfConstraints, int feasibleRatio ):
+			populationSize( populationSize ),
+			numberOfConstraints( numberOfConstraints ),
+			objectiveFunctionValues( populationSize ),
+			violations( (std::size_t) populationSize * numberOfConstraints ),
+			constraintViolationValues( populationSize ),
+			penaltyCoefficients( numberOfConstraints ),
+			fitnessValues( populationSize ) {
+
+			int i;
+			int j;
+			std::mt19937_64 generator( 2012 );
+			std::uniform_real_distribution< double > objective( -1e3, 1e3 );
+			std::uniform_real_distribution< double > violation( 0, 1 );
+			std::uniform_int_distribution< int > percentage( 0, 99 );
+			std::uniform_int_distribution< int > constraint( 0, numberOfConstraints - 1 );
+			for( i=0; i < populationSize; i++ ) {
+
+				double* values = &this->violations[ (std::size_t) i * numberOfConstraints ];
+				const bool feasible = percentage( generator ) < feasibleRatio;
+				this->objectiveFunctionValues[ i ] = objective( generator );
+				for( j=0; j < numberOfConstraints; j++ ) {
+					values[ j ] = !feasible && violation( generator ) < 0.5? violation( generator ): -violation( generator );
+				}
+				if ( !feasible ) {
+					values[ constraint( generator ) ] = 1 + violation( generator );
+				}
+				this->constraintViolationValues[ i ] = values;
+
+			}
+
+		}
+
+		//the bytes read by the calculation of the penalty coefficients
+		std::size_t bytesOfCoefficients( ) const {
+			return (std::size_t) this->populationSize * ( this->numberOfConstraints + 1 ) * sizeof( double );
+		}
+
+		//the bytes read and written by the calculation of the fitness values
+		std::size_t bytesOfFitness( ) const {
+			return (std::size_t) this->populationSize * ( this->numberOfConstraints + 2 ) * sizeof( double );
+		}
+	};
+
+	/*
+	 * The arguments of the benchmarks: population size, number of
+	 * constraints and percentage of feasible candidate solutions.
+	 */
+	void sweep( benchmark::internal::Benchmark* benchmark ) {
+
+		benchmark->ArgNames( { "population", "constraints", "feasible" } );
+		for( long long populationSize=100; populationSize <= 10000000; populationSize *= 10 ) {
+			for( int numberOfConstraints : { 1, 10, 100, 1000 } ) {
+
+				if ( populationSize * numberOfConstraints > APM_BENCHMARK_MAX_VALUES ) {
+					continue;
+				}
+				for( int feasibleRatio : { 0, 50, 100 } ) {
+					benchmark->Args( { populationSize, numberOfConstraints, feasibleRatio } );
+				}
+
+			}
+		}
+
+	}
+
+	Population populationOf( const benchmark::State& state ) {
+		return Population( (int) state.range( 0 ), (int) state.range( 1 ), (int) state.range( 2 ) );
+	}
+
+	/*
+	 * Report the time per candidate solution and the bandwidth
+	 * of the benchmark.
+	 */
+	void report( benchmark::State& state, const Population& population, std::size_t bytes ) {
+
+		state.counters[ "time/individual" ] = benchmark::Counter( population.populationSize,
+			benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert );
+		state.SetBytesProcessed( (int64_t) ( state.iterations( ) * bytes ) );
+
+	}
+
+	void coefficients( benchmark::State& state ) {
+
+		Population population = populationOf( state );
+		apm::AdaptivePenaltyMethod method( population.numberOfConstraints );
+		for( auto _ : state ) {
+			method.calculatePenaltyCoefficients( population.populationSize, population.objectiveFunctionValues.data( ),
+				population.constraintViolationValues.data( ), population.penaltyCoefficients.data( ) );
+			benchmark::ClobberMemory( );
+		}
+		report( state, population, population.bytesOfCoefficients( ) );
+
+	}
+
+	void fitness( benchmark::State& state ) {
+
+		Population population = populationOf( state );
+		apm::AdaptivePenaltyMethod method( population.numberOfConstraints );
+		method.calculatePenaltyCoefficients( population.populationSize, population.objectiveFunctionValues.data( ),
+			population.constraintViolationValues.data( ), population.penaltyCoefficients.data( ) );
+		for( auto _ : state ) {
+			method.calculateFitness( population.fitnessValues.data( ), population.populationSize, population.objectiveFunctionValues.data( ),
+				population.constraintViolationValues.data( ), population.penaltyCoefficients.data( ) );
+			benchmark::ClobberMemory( );
+		}
+		report( state, population, population.bytesOfFitness( ) );
+
+	}
+
+	//the fitness values are calculated one candidate solution at a time
+	void singleFitness( benchmark::State& state ) {
+
+		int i;
+		Population population = populationOf( state );
+		apm::AdaptivePenaltyMethod method( population.numberOfConstraints );
+		method.calculatePenaltyCoefficients( population.populationSize, population.objectiveFunctionValues.data( ),
+			population.constraintViolationValues.data( ), population.penaltyCoefficients.data( ) );
+		for( auto _ : state ) {
+			for( i=0; i < population.populationSize; i++ ) {
+				population.fitnessValues[ i ] = method.calculateFitness( population.objectiveFunctionValues[ i ],
+					population.constraintViolationValues[ i ], population.penaltyCoefficients.data( ) );
+			}
+			benchmark::ClobberMemory( );
+		}
+		report( state, population, population.bytesOfFitness( ) );
+
+	}
+
+	void coefficientsOfC( benchmark::State& state ) {
+
+		double average;
+		Population population = populationOf( state );
+		for( auto _ : state ) {
+			calculatePenaltyCoefficients( population.populationSize, population.objectiveFunctionValues.data( ),
+				population.constraintViolationValues.data( ), population.numberOfConstraints,
+				population.penaltyCoefficients.data( ), &average );
+			benchmark::DoNotOptimize( average );
+			benchmark::ClobberMemory( );
+		}
+		report( state, population, population.bytesOfCoefficients( ) );
+
+	}
+
+	void fitnessOfC( benchmark::State& state ) {
+
+		double average;
+		Population population = populationOf( state );
+		calculatePenaltyCoefficients( population.populationSize, population.objectiveFunctionValues.data( ),
+			population.constraintViolationValues.data( ), population.numberOfConstraints,
+			population.penaltyCoefficients.data( ), &average );
+		for( auto _ : state ) {
+			calculateAllFitness( population.fitnessValues.data( ), population.populationSize, population.objectiveFunctionValues.data( ),
+				population.constraintViolationValues.data( ), population.numberOfConstraints,
+				population.penaltyCoefficients.data( ), average );
+			benchmark::ClobberMemory( );
+		}
+		report( state, population, population.bytesOfFitness( ) );
+
+	}
+
+	void singleFitnessOfC( benchmark::State& state ) {
+
+		int i;
+		double average;
+		Population population = populationOf( state );
+		calculatePenaltyCoefficients( population.populationSize, population.objectiveFunctionValues.data( ),
+			population.constraintViolationValues.data( ), population.numberOfConstraints,
+			population.penaltyCoefficients.data( ), &average );
+		for( auto _ : state ) {
+			for( i=0; i < population.populationSize; i++ ) {
+				population.fitnessValues[ i ] = calculateFitness( population.objectiveFunctionValues[ i ],
+					population.constraintViolationValues[ i ], population.numberOfConstraints,
+					population.penaltyCoefficients.data( ), average );
+			}
+			benchmark::ClobberMemory( );
+		}
+		report( state, population, population.bytesOfFitness( ) );
+
+	}
+
+}
+
+BENCHMARK( coefficients )->Name( "AdaptivePenaltyMethod/Coefficients" )->Apply( sweep );
+BENCHMARK( fitness )->Name( "AdaptivePenaltyMethod/Fitness" )->Apply( sweep );
+BENCHMARK( singleFitness )->Name( "AdaptivePenaltyMethod/SingleFitness" )->Apply( sweep );
+BENCHMARK( coefficientsOfC )->Name( "apm/Coefficients" )->Apply( sweep );
+BENCHMARK( fitnessOfC )->Name( "apm/Fitness" )->Apply( sweep );
+BENCHMARK( singleFitnessOfC )->Name( "apm/SingleFitness" )->Apply( sweep );
+
+BENCHMARK_MAIN( );
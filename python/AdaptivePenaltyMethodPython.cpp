@@ -0,0 +1,347 @@
+/*
+ * File:   AdaptivePenaltyMethodPython.cpp
+ * Author: Heder Soares Bernardino
+ *
+ * Python module 'apm' (pybind11) over the AdaptivePenaltyMethod class.
+ * The constraint violation values are given as a 2-D NumPy array with
+ * one row per candidate solution, in either memory order: C-ordered
+ * arrays (and slices of their rows) are given to the class as ROW_MAJOR
+ * matrices and Fortran-ordered ones as COLUMN_MAJOR matrices, so the
+ * values are not copied. Only the arrays whose values are not
+ * contiguous in either dimension, or whose type is not the one of the
+ * class, are copied. E.g.:
+ * import apm, numpy
+ * method = apm.AdaptivePenaltyMethod( numberOfConstraints )
+ * method.thread_count = 4
+ * fitness, coefficients = method.evaluate_generation( objective, violations )
+ *
+ * The Global Interpreter Lock is released while the class calculates,
+ * so other Python threads run concurrently. The calls on the same object
+ * are serialized by the object; a snapshot (see 'make_snapshot') may
+ * be used by any number of threads at the same time.
+ *
+ * Compilation:
+ * Use the following commands, in the root directory of the project,
+ * to compile the module (pybind11 is required):
+ * cmake -S . -B build -DAPM_BUILD_PYTHON=ON
+ * cmake --build build
+ * This will generate the 'apm' module (e.g. 'apm.cpython-311-x86_64-linux-gnu.so')
+ * in the 'build' directory.
+ */
+
+/*
+ * Includes.
+ */
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+
+#include "AdaptivePenaltyMethod.hpp"
+
+namespace py = pybind11;
+
+namespace {
+
+	/*
+	 * Objective function values: a contiguous 1-D array ('forcecast'
+	 * is not requested, so only the safe conversions are made).
+	 */
+	template< typename T >
+	using Vector = py::array_t< T, py::array::c_style >;
+
+	/*
+	 * Constraint violation values: a 2-D array in any memory order.
+	 */
+	template< typename T >
+	using Matrix = py::array_t< T, 0 >;
+
+	/*
+	 * The values of a population given to the class. The arrays are
+	 * kept, so the pointers remain valid while the lock is released.
+	 */
+	template< typename T >
+	struct Population {
+		Vector< T > objectiveFunctionValues;
+		Matrix< T > constraintViolations;
+		int populationSize;
+		const T* constraintViolationValues;
+		apm::ViolationLayout layout;
+		std::size_t leadingDimension;
+	};
+
+	/*
+	 * Check the shapes of a population whose candidate solutions have
+	 * 'numberOfConstraints' constraints and find the layout of the
+	 * constraint violation values.
+	 */
+	template< typename T >
+	Population< T > populationOf(
+		Vector< T > objectiveFunctionValues,
+		Matrix< T > constraintViolationValues,
+		std::size_t numberOfConstraints ) {
+
+		if ( objectiveFunctionValues.ndim( ) != 1 ) {
+			throw std::invalid_argument( "the objective function values must be a 1-D array" );
+		}
+		if ( constraintViolationValues.ndim( ) != 2 ) {
+			throw std::invalid_argument( "the constraint violation values must be a 2-D array" );
+		}
+		const py::ssize_t rows = constraintViolationValues.shape( 0 );
+		const py::ssize_t columns = constraintViolationValues.shape( 1 );
+		if ( rows != objectiveFunctionValues.shape( 0 ) ) {
+			throw std::invalid_argument( "there must be one row of constraint violation values for each objective function value" );
+		}
+		if ( (std::size_t) columns != numberOfConstraints ) {
+			throw std::invalid_argument( "there must be one column of constraint violation values for each constraint" );
+		}
+		if ( rows > INT_MAX ) {
+			throw std::invalid_argument( "the population is too large" );
+		}
+
+		//the strides are in bytes; the one of a dimension of size 1 is irrelevant
+		const py::ssize_t item = (py::ssize_t) sizeof( T );
+		const py::ssize_t rowStride = constraintViolationValues.strides( 0 );
+		const py::ssize_t columnStride = constraintViolationValues.strides( 1 );
+		Population< T > population = { objectiveFunctionValues, constraintViolationValues, (int) rows, 0, apm::ROW_MAJOR, 0 };
+		if ( ( columns <= 1 || columnStride == item ) &&
+			( rows <= 1 || ( rowStride > 0 && rowStride % item == 0 && rowStride / item >= columns ) ) ) {
+			population.layout = apm::ROW_MAJOR;
+			population.leadingDimension = rows <= 1? (std::size_t) columns: (std::size_t) ( rowStride / item );
+		} else if ( ( rows <= 1 || rowStride == item ) &&
+			( columns <= 1 || ( columnStride > 0 && columnStride % item == 0 && columnStride / item >= rows ) ) ) {
+			population.layout = apm::COLUMN_MAJOR;
+			population.leadingDimension = columns <= 1? (std::size_t) rows: (std::size_t) ( columnStride / item );
+		} else {
+			//the values are not contiguous in either dimension
+			population.constraintViolations = py::cast< Matrix< T > >(
+				py::module_::import( "numpy" ).attr( "ascontiguousarray" )( constraintViolationValues ) );
+			population.layout = apm::ROW_MAJOR;
+			population.leadingDimension = (std::size_t) columns;
+		}
+		if ( population.leadingDimension == 0 ) {
+			population.leadingDimension = 1;
+		}
+		population.constraintViolationValues = population.constraintViolations.data( );
+		return population;
+
+	}
+
+	/*
+	 * Check that the penalty coefficients are one per constraint.
+	 */
+	template< typename T >
+	void checkCoefficients( const Vector< T >& penaltyCoefficients, std::size_t numberOfConstraints ) {
+		if ( penaltyCoefficients.ndim( ) != 1 || (std::size_t) penaltyCoefficients.shape( 0 ) != numberOfConstraints ) {
+			throw std::invalid_argument( "there must be one penalty coefficient for each constraint" );
+		}
+	}
+
+	/*
+	 * A snapshot of the penalty coefficients (see apm::CoefficientSnapshot).
+	 */
+	template< typename T >
+	class Snapshot {
+		public:
+			explicit Snapshot( std::shared_ptr< const apm::CoefficientSnapshot< T, T > > snapshot ):
+				snapshot( snapshot ) {
+			}
+
+			py::array_t< T > calculateFitness( Vector< T > objectiveFunctionValues, Matrix< T > constraintViolationValues,
+				int threadCount ) const {
+
+				const Population< T > population = populationOf< T >( objectiveFunctionValues, constraintViolationValues,
+					this->snapshot->getNumberOfConstraints( ) );
+				py::array_t< T > fitnessValues( (py::ssize_t) population.populationSize );
+				T* fitness = fitnessValues.mutable_data( );
+				{
+					//the snapshot is immutable, so the calls are not serialized
+					py::gil_scoped_release release;
+					this->snapshot->calculateFitness( fitness, (std::size_t) population.populationSize,
+						population.objectiveFunctionValues.data( ), population.constraintViolationValues, population.layout,
+						population.leadingDimension, threadCount );
+				}
+				return fitnessValues;
+
+			}
+
+			py::array_t< T > getPenaltyCoefficients( ) const {
+				return py::array_t< T >( (py::ssize_t) this->snapshot->getNumberOfConstraints( ),
+					this->snapshot->getPenaltyCoefficients( ) );
+			}
+
+			T getAverageObjectiveFunctionValues( ) const {
+				return this->snapshot->getAverageObjectiveFunctionValues( );
+			}
+
+			std::uint64_t getVersion( ) const {
+				return this->snapshot->getVersion( );
+			}
+
+		private:
+			std::shared_ptr< const apm::CoefficientSnapshot< T, T > > snapshot;
+	};
+
+	/*
+	 * An object of the class, whose calls are serialized by a mutex
+	 * because the lock of the interpreter is released during them.
+	 */
+	template< typename T >
+	class Method {
+		public:
+			explicit Method( int numberOfConstraints ):
+				method( numberOfConstraints ) {
+			}
+
+			py::array_t< T > calculatePenaltyCoefficients( Vector< T > objectiveFunctionValues, Matrix< T > constraintViolationValues ) {
+
+				const Population< T > population = populationOf< T >( objectiveFunctionValues, constraintViolationValues,
+					this->numberOfConstraints( ) );
+				py::array_t< T > penaltyCoefficients( (py::ssize_t) this->numberOfConstraints( ) );
+				T* coefficients = penaltyCoefficients.mutable_data( );
+				{
+					py::gil_scoped_release release;
+					std::lock_guard< std::mutex > lock( this->mutex );
+					this->method.calculatePenaltyCoefficients( population.populationSize, population.objectiveFunctionValues.data( ),
+						population.constraintViolationValues, population.layout, population.leadingDimension, coefficients );
+				}
+				return penaltyCoefficients;
+
+			}
+
+			py::array_t< T > calculateFitness( Vector< T > objectiveFunctionValues, Matrix< T > constraintViolationValues,
+				Vector< T > penaltyCoefficients ) {
+
+				const Population< T > population = populationOf< T >( objectiveFunctionValues, constraintViolationValues,
+					this->numberOfConstraints( ) );
+				checkCoefficients< T >( penaltyCoefficients, this->numberOfConstraints( ) );
+				const T* coefficients = penaltyCoefficients.data( );
+				py::array_t< T > fitnessValues( (py::ssize_t) population.populationSize );
+				T* fitness = fitnessValues.mutable_data( );
+				{
+					py::gil_scoped_release release;
+					std::lock_guard< std::mutex > lock( this->mutex );
+					this->method.calculateFitness( fitness, population.populationSize, population.objectiveFunctionValues.data( ),
+						population.constraintViolationValues, population.layout, population.leadingDimension, coefficients );
+				}
+				return fitnessValues;
+
+			}
+
+			py::tuple evaluateGeneration( Vector< T > objectiveFunctionValues, Matrix< T > constraintViolationValues ) {
+
+				const Population< T > population = populationOf< T >( objectiveFunctionValues, constraintViolationValues,
+					this->numberOfConstraints( ) );
+				py::array_t< T > fitnessValues( (py::ssize_t) population.populationSize );
+				py::array_t< T > penaltyCoefficients( (py::ssize_t) this->numberOfConstraints( ) );
+				T* fitness = fitnessValues.mutable_data( );
+				T* coefficients = penaltyCoefficients.mutable_data( );
+				{
+					py::gil_scoped_release release;
+					std::lock_guard< std::mutex > lock( this->mutex );
+					this->method.evaluateGeneration( fitness, population.populationSize, population.objectiveFunctionValues.data( ),
+						population.constraintViolationValues, population.layout, population.leadingDimension, coefficients );
+				}
+				return py::make_tuple( fitnessValues, penaltyCoefficients );
+
+			}
+
+			Snapshot< T > makeSnapshot( Vector< T > penaltyCoefficients ) {
+				checkCoefficients< T >( penaltyCoefficients, this->numberOfConstraints( ) );
+				std::lock_guard< std::mutex > lock( this->mutex );
+				return Snapshot< T >( this->method.makeSnapshot( penaltyCoefficients.data( ) ) );
+			}
+
+			void setThreadCount( int threadCount ) {
+				std::lock_guard< std::mutex > lock( this->mutex );
+				this->method.setThreadCount( threadCount );
+			}
+
+			int getThreadCount( ) {
+				std::lock_guard< std::mutex > lock( this->mutex );
+				return this->method.getThreadCount( );
+			}
+
+			T getAverageObjectiveFunctionValues( ) {
+				std::lock_guard< std::mutex > lock( this->mutex );
+				return this->method.getAverageObjectiveFunctionValues( );
+			}
+
+			void setConstraintKind( int constraint, apm::ConstraintKind kind, T tolerance ) {
+				std::lock_guard< std::mutex > lock( this->mutex );
+				this->method.setConstraintKind( constraint, kind, tolerance );
+			}
+
+			void setEqualityTolerance( T tolerance ) {
+				std::lock_guard< std::mutex > lock( this->mutex );
+				this->method.setEqualityTolerance( tolerance );
+			}
+
+			std::size_t numberOfConstraints( ) const {
+				return (std::size_t) this->method.getNumberOfConstraints( );
+			}
+
+		private:
+			std::mutex mutex;
+			apm::BasicAdaptivePenaltyMethod< T > method;
+	};
+
+	/*
+	 * Define the Python classes of the values of type 'T'.
+	 */
+	template< typename T >
+	void bindMethod( py::module_& module, const char* methodName, const char* snapshotName ) {
+
+		py::class_< Snapshot< T > >( module, snapshotName,
+			"Immutable penalty coefficients which may be used by several threads at the same time." )
+			.def( "calculate_fitness", &Snapshot< T >::calculateFitness,
+				py::arg( "objective_function_values" ), py::arg( "constraint_violation_values" ), py::arg( "thread_count" ) = 1,
+				"Return the fitness values of a population with the coefficients of the snapshot." )
+			.def_property_readonly( "penalty_coefficients", &Snapshot< T >::getPenaltyCoefficients )
+			.def_property_readonly( "average_objective_function_values", &Snapshot< T >::getAverageObjectiveFunctionValues )
+			.def_property_readonly( "version", &Snapshot< T >::getVersion );
+
+		py::class_< Method< T > >( module, methodName,
+			"The Adaptive Penalty Method. The constraint violation values are a 2-D array with one row per "
+			"candidate solution, in C or Fortran order." )
+			.def( py::init< int >( ), py::arg( "number_of_constraints" ) )
+			.def( "calculate_penalty_coefficients", &Method< T >::calculatePenaltyCoefficients,
+				py::arg( "objective_function_values" ), py::arg( "constraint_violation_values" ),
+				"Return the penalty coefficients of a population." )
+			.def( "calculate_fitness", &Method< T >::calculateFitness,
+				py::arg( "objective_function_values" ), py::arg( "constraint_violation_values" ), py::arg( "penalty_coefficients" ),
+				"Return the fitness values of a population." )
+			.def( "evaluate_generation", &Method< T >::evaluateGeneration,
+				py::arg( "objective_function_values" ), py::arg( "constraint_violation_values" ),
+				"Return the fitness values and the penalty coefficients of a population, reading the violations once." )
+			.def( "make_snapshot", &Method< T >::makeSnapshot, py::arg( "penalty_coefficients" ),
+				"Return a snapshot of the penalty coefficients and of the average of the objective function values." )
+			.def( "set_constraint_kind", &Method< T >::setConstraintKind,
+				py::arg( "constraint" ), py::arg( "kind" ), py::arg( "tolerance" ) = (T) 0 )
+			.def( "set_equality_tolerance", &Method< T >::setEqualityTolerance, py::arg( "tolerance" ) )
+			.def_property( "thread_count", &Method< T >::getThreadCount, &Method< T >::setThreadCount )
+			.def_property_readonly( "number_of_constraints", &Method< T >::numberOfConstraints )
+			.def_property_readonly( "average_objective_function_values", &Method< T >::getAverageObjectiveFunctionValues );
+
+	}
+
+}
+
+PYBIND11_MODULE( apm, module ) {
+
+	module.doc( ) = "Adaptive Penalty Method (Barbosa and Lemonge, 2003).";
+
+	py::enum_< apm::ConstraintKind >( module, "ConstraintKind" )
+		.value( "INEQUALITY_CONSTRAINT", apm::INEQUALITY_CONSTRAINT )
+		.value( "EQUALITY_CONSTRAINT", apm::EQUALITY_CONSTRAINT )
+		.export_values( );
+
+	bindMethod< double >( module, "AdaptivePenaltyMethod", "CoefficientSnapshot" );
+	bindMethod< float >( module, "AdaptivePenaltyMethodFloat", "CoefficientSnapshotFloat" );
+
+}
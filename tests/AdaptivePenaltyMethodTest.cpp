@@ -0,0 +1,1052 @@
+/*
+ * File:   AdaptivePenaltyMethodTest.cpp
+ * Author: Heder Soares Bernardino
+ *
+ * Tests of the AdaptivePenaltyMethod class. Each test checks that two
+ * ways of calculating the penalty coefficients and the fitness values
+ * give bitwise identical results (or the documented ones):
+ * - fused: 'evaluateGeneration' and the sequence 'calculatePenaltyCoefficients'
+ * and 'calculateFitness', and a population calculated by hand;
+ * - simd: the kernels of each instruction set and the scalar ones;
+ * - threads: any number of threads and a single thread;
+ * - chunks: the chunks ('accumulateChunk', 'finalize' and 'scoreChunk')
+ * and the whole population;
+ * - sparse: the sparse (CSR) input and the dense one;
+ * - summation: the results of each summation policy;
+ * - equality: the equality constraints and their violations '|h| - tolerance'
+ * calculated before, also after the annealing of the tolerances;
+ * - pipeline: the chunks pushed to a GenerationPipeline and 'evaluateGeneration';
+ * - selection: the best candidate solutions selected with the fitness
+ * values and the ones of a stable sort of the fitness values;
+ * - incremental: the coefficients updated by 'addIndividual', 'removeIndividual'
+ * and 'replaceIndividual' and the ones recalculated for the population;
+ * - io: the files written by 'writePopulation' and FitnessWriter, mapped
+ * by MappedPopulation, and the values in memory, and the invalid files
+ * (only with the POSIX interface, see AdaptivePenaltyMethodIO.hpp).
+ * The populations have small handcrafted cases and populations larger
+ * than REDUCTION_BLOCK_SIZE, whose last block is incomplete.
+ *
+ * Compilation:
+ * Use the following commands, in the root directory of the project, to
+ * compile and run the tests:
+ * g++ -O2 -pthread -I. tests/AdaptivePenaltyMethodTest.cpp AdaptivePenaltyMethod.cpp AdaptivePenaltyMethodKernels.cpp AdaptivePenaltyMethodParallel.cpp -o apm-test
+ * ./apm-test fused
+ * Without a name, all the tests are run. With CMake, they are run by
+ * 'ctest' (see CMakeLists.txt). The program returns 1 if a check fails.
+ */
+
+/*
+ * Includes.
+ */
+#include <algorithm>
+#include <cstddef>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <future>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AdaptivePenaltyMethod.hpp"
+#include "AdaptivePenaltyMethodPipeline.hpp"
+#if defined( __unix__ ) || defined( __APPLE__ )
+#define APM_TEST_IO
+#include "AdaptivePenaltyMethodIO.hpp"
+#endif
+
+namespace {
+
+	typedef apm::AdaptivePenaltyMethod Method;
+
+	const int BLOCK_SIZE = Method::REDUCTION_BLOCK_SIZE;
+
+	//number of the failed checks
+	int failures = 0;
+
+	/*
+	 * Record a failed check.
+	 */
+	void check( bool condition, const char* expression, int line ) {
+		if ( !condition ) {
+			std::printf( "line %d: %s\n", line, expression );
+			failures++;
+		}
+	}
+
+#define CHECK( condition ) check( ( condition ), #condition, __LINE__ )
+
+	/*
+	 * Indicates if two vectors have the same bits.
+	 */
+	bool same( const std::vector< double >& a, const std::vector< double >& b ) {
+		return a.size( ) == b.size( ) && std::memcmp( a.data( ), b.data( ), a.size( ) * sizeof( double ) ) == 0;
+	}
+
+	bool same( double a, double b ) {
+		return std::memcmp( &a, &b, sizeof( double ) ) == 0;
+	}
+
+	/*
+	 * A population with random values, given as a table of pointers to
+	 * the rows of a matrix (with one padding value per row) and as a
+	 * matrix of columns; about half of the candidate solutions are feasible.
+	 */
+	struct Population {
+		int populationSize;
+		int numberOfConstraints;
+		std::vector< double > objectiveFunctionValues;
+		std::vector< double > rows;
+		std::vector< double > columns;
+		std::vector< double* > constraintViolationValues;
+
+		Population( int populationSize, int numberOfConstraints, unsigned int seed ):
+			populationSize( populationSize ),
+			numberOfConstraints( numberOfConstraints ),
+			objectiveFunctionValues( populationSize ),
+			rows( (std::size_t) populationSize * ( numberOfConstraints + 1 ) ),
+			columns( (std::size_t) populationSize * numberOfConstraints ),
+			constraintViolationValues( populationSize ) {
+
+			int i;
+			int j;
+			std::mt19937_64 generator( seed );
+			std::uniform_real_distribution< double > objective( -1e3, 3e3 );
+			std::uniform_real_distribution< double > violation( -1, 1 );
+			for( i=0; i < populationSize; i++ ) {
+
+				const bool feasible = generator( ) % 2 == 0;
+				this->objectiveFunctionValues[ i ] = objective( generator );
+				this->constraintViolationValues[ i ] = &this->rows[ (std::size_t) i * ( numberOfConstraints + 1 ) ];
+				for( j=0; j < numberOfConstraints; j++ ) {
+					const double value = feasible? -violation( generator ) * violation( generator ) - 1: violation( generator ) * ( j + 1 );
+					this->setValue( i, j, value );
+				}
+
+			}
+
+		}
+
+		void setValue( int individual, int constraint, double value ) {
+			this->constraintViolationValues[ individual ][ constraint ] = value;
+			this->columns[ (std::size_t) constraint * this->populationSize + individual ] = value;
+		}
+
+		std::size_t rowDimension( ) const {
+			return (std::size_t) this->numberOfConstraints + 1;
+		}
+	};
+
+	/*
+	 * The penalty coefficients, the fitness values and the
+	 * average of the objective function values of a population.
+	 */
+	struct Result {
+		std::vector< double > penaltyCoefficients;
+		std::vector< double > fitnessValues;
+		double averageObjectiveFunctionValues;
+
+		explicit Result( const Population& population ):
+			penaltyCoefficients( population.numberOfConstraints ),
+			fitnessValues( population.populationSize ),
+			averageObjectiveFunctionValues( 0 ) {
+		}
+
+		bool operator==( const Result& other ) const {
+			return same( this->penaltyCoefficients, other.penaltyCoefficients ) && same( this->fitnessValues, other.fitnessValues ) &&
+				same( this->averageObjectiveFunctionValues, other.averageObjectiveFunctionValues );
+		}
+	};
+
+	/*
+	 * Layouts of the constraint violation values given to the methods.
+	 */
+	enum Input {
+		POINTERS,
+		ROWS,
+		COLUMNS
+	};
+
+	const Input INPUTS[ ] = { POINTERS, ROWS, COLUMNS };
+
+	/*
+	 * Calculate the penalty coefficients and then the fitness values.
+	 */
+	Result calculate( Method& method, Population& population, Input input ) {
+
+		Result result( population );
+		const int n = population.populationSize;
+		double* objectives = population.objectiveFunctionValues.data( );
+		if ( input == POINTERS ) {
+			method.calculatePenaltyCoefficients( n, objectives, population.constraintViolationValues.data( ), result.penaltyCoefficients.data( ) );
+			method.calculateFitness( result.fitnessValues.data( ), n, objectives, population.constraintViolationValues.data( ),
+				result.penaltyCoefficients.data( ) );
+		} else if ( input == ROWS ) {
+			method.calculatePenaltyCoefficients( n, objectives, population.rows.data( ), apm::ROW_MAJOR, population.rowDimension( ),
+				result.penaltyCoefficients.data( ) );
+			method.calculateFitness( result.fitnessValues.data( ), n, objectives, population.rows.data( ), apm::ROW_MAJOR,
+				population.rowDimension( ), result.penaltyCoefficients.data( ) );
+		} else {
+			method.calculatePenaltyCoefficients( n, objectives, population.columns.data( ), apm::COLUMN_MAJOR, (std::size_t) n,
+				result.penaltyCoefficients.data( ) );
+			method.calculateFitness( result.fitnessValues.data( ), n, objectives, population.columns.data( ), apm::COLUMN_MAJOR,
+				(std::size_t) n, result.penaltyCoefficients.data( ) );
+		}
+		result.averageObjectiveFunctionValues = method.getAverageObjectiveFunctionValues( );
+		return result;
+
+	}
+
+	/*
+	 * Calculate the penalty coefficients and the fitness values with 'evaluateGeneration'.
+	 */
+	Result evaluate( Method& method, Population& population, Input input ) {
+
+		Result result( population );
+		const int n = population.populationSize;
+		double* objectives = population.objectiveFunctionValues.data( );
+		if ( input == POINTERS ) {
+			method.evaluateGeneration( result.fitnessValues.data( ), n, objectives, population.constraintViolationValues.data( ),
+				result.penaltyCoefficients.data( ) );
+		} else if ( input == ROWS ) {
+			method.evaluateGeneration( result.fitnessValues.data( ), n, objectives, population.rows.data( ), apm::ROW_MAJOR,
+				population.rowDimension( ), result.penaltyCoefficients.data( ) );
+		} else {
+			method.evaluateGeneration( result.fitnessValues.data( ), n, objectives, population.columns.data( ), apm::COLUMN_MAJOR,
+				(std::size_t) n, result.penaltyCoefficients.data( ) );
+		}
+		result.averageObjectiveFunctionValues = method.getAverageObjectiveFunctionValues( );
+		return result;
+
+	}
+
+	/*
+	 * The fused method gives the results of the two calls, which are
+	 * the ones of the original formulas for a small population.
+	 */
+	void testFused( ) {
+
+		int n;
+		const double objectives[ ] = { 1, 2, 3, 6 };
+		const double violations[ ] = { -1, -1, 2, -0.5, -2, 4, 1, 0 };
+		const int sizes[ ] = { 4, 200, BLOCK_SIZE, 3 * BLOCK_SIZE + 1000 };
+
+		//sums: 12 for the objective function, 3 and 4 for the violations
+		Population handcrafted( 4, 2, 0 );
+		for( n=0; n < 4; n++ ) {
+			handcrafted.objectiveFunctionValues[ n ] = objectives[ n ];
+			handcrafted.setValue( n, 0, violations[ 2 * n ] );
+			handcrafted.setValue( n, 1, violations[ 2 * n + 1 ] );
+		}
+		Result expected( handcrafted );
+		expected.averageObjectiveFunctionValues = 3;
+		expected.penaltyCoefficients = { 12.0 / 25.0 * 3.0, 12.0 / 25.0 * 4.0 };
+		expected.fitnessValues = { 1, 3 + expected.penaltyCoefficients[ 0 ] * 2, 3 + expected.penaltyCoefficients[ 1 ] * 4,
+			6 + expected.penaltyCoefficients[ 0 ] * 1 };
+		for( Input input : INPUTS ) {
+			Method separate( 2 );
+			Method fused( 2 );
+			CHECK( calculate( separate, handcrafted, input ) == expected );
+			CHECK( evaluate( fused, handcrafted, input ) == expected );
+		}
+
+		for( n=0; n < 4; n++ ) {
+			Population population( sizes[ n ], 6, n + 1 );
+			for( Input input : INPUTS ) {
+				Method separate( 6 );
+				Method fused( 6 );
+				CHECK( evaluate( fused, population, input ) == calculate( separate, population, input ) );
+			}
+		}
+
+	}
+
+	/*
+	 * The kernels of every instruction set available give the results
+	 * of the scalar kernels.
+	 */
+	void testSimd( ) {
+
+		int c;
+		const apm::InstructionSet initial = apm::instructionSet( );
+		const apm::InstructionSet sets[ ] = { apm::NEON, apm::AVX2, apm::AVX512 };
+		const int constraints[ ] = { 1, 3, 4, 7, 8, 16, 33 };
+
+		for( c=0; c < 7; c++ ) {
+
+			Population population( BLOCK_SIZE + 777, constraints[ c ], 10 + c );
+			for( Input input : INPUTS ) {
+
+				CHECK( apm::selectInstructionSet( apm::SCALAR ) );
+				Method scalar( constraints[ c ] );
+				const Result expected = calculate( scalar, population, input );
+				const Result fused = evaluate( scalar, population, input );
+				for( apm::InstructionSet set : sets ) {
+					if ( !apm::selectInstructionSet( set ) ) {
+						continue;
+					}
+					Method method( constraints[ c ] );
+					CHECK( calculate( method, population, input ) == expected );
+					CHECK( evaluate( method, population, input ) == fused );
+				}
+
+			}
+
+		}
+		apm::selectInstructionSet( initial );
+
+	}
+
+	/*
+	 * The results do not depend on the number of threads.
+	 */
+	void testThreads( ) {
+
+		const int threads[ ] = { 2, 3, 4, 7 };
+		Population population( 3 * BLOCK_SIZE + 1000, 5, 20 );
+		for( Input input : INPUTS ) {
+
+			Method single( 5 );
+			const Result expected = calculate( single, population, input );
+			const Result fused = evaluate( single, population, input );
+			for( int count : threads ) {
+				Method method( 5 );
+				method.setThreadCount( count );
+				CHECK( calculate( method, population, input ) == expected );
+				CHECK( evaluate( method, population, input ) == fused );
+			}
+
+		}
+
+	}
+
+	/*
+	 * Accumulate the chunks of a population, concurrently and out of
+	 * order, and score them.
+	 */
+	Result calculateChunks( Method& method, Population& population, int chunkSize ) {
+
+		int first;
+		Result result( population );
+		std::vector< std::thread > threads;
+		const int n = population.populationSize;
+		double* objectives = population.objectiveFunctionValues.data( );
+		for( first=( n - 1 ) / chunkSize * chunkSize; first >= 0; first -= chunkSize ) {
+			const int size = first + chunkSize < n? chunkSize: n - first;
+			threads.emplace_back( [ &method, &population, objectives, first, size, chunkSize ]( ) {
+				//the chunks alternate between the two inputs
+				if ( first / chunkSize % 2 == 0 ) {
+					method.accumulateChunk( first, size, objectives + first, population.constraintViolationValues.data( ) + first );
+				} else {
+					method.accumulateChunk( first, size, objectives + first, &population.rows[ first * population.rowDimension( ) ],
+						apm::ROW_MAJOR, population.rowDimension( ) );
+				}
+			} );
+		}
+		for( std::thread& thread : threads ) {
+			thread.join( );
+		}
+		method.finalize( result.penaltyCoefficients.data( ) );
+		result.averageObjectiveFunctionValues = method.getAverageObjectiveFunctionValues( );
+
+		//the chunks of the fitness values may have any size
+		for( first=0; first < n; first += 1000 ) {
+			const int size = first + 1000 < n? 1000: n - first;
+			method.scoreChunk( &result.fitnessValues[ first ], size, objectives + first,
+				population.constraintViolationValues.data( ) + first, result.penaltyCoefficients.data( ) );
+		}
+		return result;
+
+	}
+
+	/*
+	 * The chunks give the results of the whole population.
+	 */
+	void testChunks( ) {
+
+		std::vector< double > penaltyCoefficients( 4 );
+		Population population( 4 * BLOCK_SIZE + 123, 4, 30 );
+		Method whole( 4 );
+		const Result expected = calculate( whole, population, POINTERS );
+
+		Method chunks( 4 );
+		chunks.setThreadCount( 2 );
+		CHECK( calculateChunks( chunks, population, BLOCK_SIZE ) == expected );
+		//the method is ready for another population
+		CHECK( calculateChunks( chunks, population, 2 * BLOCK_SIZE ) == expected );
+
+		//a chunk must start at a block and only the last one may end inside a block
+		Method invalid( 4 );
+		double* objectives = population.objectiveFunctionValues.data( );
+		double** violations = population.constraintViolationValues.data( );
+		bool thrown = false;
+		try {
+			invalid.accumulateChunk( 100, 10, objectives + 100, violations + 100 );
+		} catch( const std::invalid_argument& ) {
+			thrown = true;
+		}
+		CHECK( thrown );
+		invalid.accumulateChunk( 0, 100, objectives, violations );
+		thrown = false;
+		try {
+			invalid.accumulateChunk( BLOCK_SIZE, 10, objectives + BLOCK_SIZE, violations + BLOCK_SIZE );
+		} catch( const std::invalid_argument& ) {
+			thrown = true;
+		}
+		CHECK( thrown );
+		//a gap is detected by 'finalize'
+		Method gap( 4 );
+		gap.accumulateChunk( 0, BLOCK_SIZE, objectives, violations );
+		gap.accumulateChunk( 2 * BLOCK_SIZE, 10, objectives + 2 * BLOCK_SIZE, violations + 2 * BLOCK_SIZE );
+		thrown = false;
+		try {
+			gap.finalize( penaltyCoefficients.data( ) );
+		} catch( const std::logic_error& ) {
+			thrown = true;
+		}
+		CHECK( thrown );
+
+	}
+
+	/*
+	 * The sparse input (the violations of a CSR structure) gives the
+	 * results of the dense one, with or without the values which are
+	 * not positive.
+	 */
+	void testSparse( ) {
+
+		int i;
+		int j;
+		int k;
+		const int sizes[ ] = { 5, BLOCK_SIZE + 500 };
+
+		for( k=0; k < 4; k++ ) {
+
+			const bool withValuesNotPositive = k % 2 == 1;
+			Population population( sizes[ k / 2 ], 9, 40 + k );
+			const int n = population.populationSize;
+			std::vector< int > offsets( 1, 0 );
+			std::vector< int > constraints;
+			std::vector< double > values;
+			for( i=0; i < n; i++ ) {
+				for( j=0; j < 9; j++ ) {
+					const double value = population.constraintViolationValues[ i ][ j ];
+					if ( value > 0 || ( withValuesNotPositive && j % 3 == 0 ) ) {
+						constraints.push_back( j );
+						values.push_back( value );
+					}
+				}
+				offsets.push_back( (int) values.size( ) );
+			}
+
+			Method dense( 9 );
+			const Result expected = calculate( dense, population, POINTERS );
+			Method sparse( 9 );
+			Result result( population );
+			double* objectives = population.objectiveFunctionValues.data( );
+			sparse.calculatePenaltyCoefficients( n, objectives, offsets.data( ), constraints.data( ), values.data( ),
+				result.penaltyCoefficients.data( ) );
+			sparse.calculateFitness( result.fitnessValues.data( ), n, objectives, offsets.data( ), constraints.data( ), values.data( ),
+				result.penaltyCoefficients.data( ) );
+			result.averageObjectiveFunctionValues = sparse.getAverageObjectiveFunctionValues( );
+			CHECK( result == expected );
+
+			Method fused( 9 );
+			Result evaluated( population );
+			fused.evaluateGeneration( evaluated.fitnessValues.data( ), n, objectives, offsets.data( ), constraints.data( ), values.data( ),
+				evaluated.penaltyCoefficients.data( ) );
+			evaluated.averageObjectiveFunctionValues = fused.getAverageObjectiveFunctionValues( );
+			CHECK( evaluated == expected );
+
+		}
+
+	}
+
+	/*
+	 * The equality constraints give the results of their violations
+	 * '|h| - tolerance' calculated before the method, for every input and
+	 * number of threads, and the annealing of the tolerances does not
+	 * raise a tolerance which is below the minimum.
+	 */
+	void testEquality( ) {
+
+		int i;
+		int k;
+		const int n = 3 * BLOCK_SIZE + 100;
+		const int threads[ ] = { 1, 3 };
+		std::mt19937_64 generator( 70 );
+		std::uniform_real_distribution< double > value( -0.2, 0.2 );
+		Population population( n, 4, 71 );
+		Method method( 4 );
+		method.setConstraintKind( 1, apm::EQUALITY_CONSTRAINT, 0.1 );
+		method.setConstraintKind( 3, apm::EQUALITY_CONSTRAINT, 0.05 );
+		//the values equal to the tolerances are not violations
+		for( i=0; i < n; i++ ) {
+			population.setValue( i, 1, i % 50 == 0? -0.1: value( generator ) );
+			population.setValue( i, 3, i % 70 == 0? 0.05: value( generator ) );
+		}
+
+		for( k=0; k < 2; k++ ) {
+
+			//the second time, the tolerance of the constraint 1 decreases to the minimum and the one of the constraint 3 is kept
+			if ( k == 1 ) {
+				method.annealTolerances( 0.5, 0.08 );
+				CHECK( method.getTolerance( 1 ) == 0.08 );
+				CHECK( method.getTolerance( 3 ) == 0.05 );
+			}
+			Population violations( n, 4, 71 );
+			for( i=0; i < n; i++ ) {
+				violations.setValue( i, 1, std::fabs( population.constraintViolationValues[ i ][ 1 ] ) - method.getTolerance( 1 ) );
+				violations.setValue( i, 3, std::fabs( population.constraintViolationValues[ i ][ 3 ] ) - method.getTolerance( 3 ) );
+			}
+
+			for( int count : threads ) {
+				method.setThreadCount( count );
+				for( Input input : INPUTS ) {
+					Method inequality( 4 );
+					inequality.setThreadCount( count );
+					const Result expected = calculate( inequality, violations, input );
+					CHECK( calculate( method, population, input ) == expected );
+					CHECK( evaluate( method, population, input ) == expected );
+				}
+			}
+
+		}
+
+	}
+
+	/*
+	 * The summation policies: the sums of the tiles (256 candidate
+	 * solutions) are added in order (NAIVE_SUMMATION), by a balanced tree
+	 * (PAIRWISE_SUMMATION) or with a compensation (COMPENSATED_SUMMATION),
+	 * and the results of each policy do not depend on the threads or on
+	 * the chunks.
+	 */
+	void testSummation( ) {
+
+		int p;
+		const apm::SummationPolicy policies[ ] = { apm::NAIVE_SUMMATION, apm::PAIRWISE_SUMMATION, apm::COMPENSATED_SUMMATION };
+
+		//the sums of the four tiles are 1, 1e17, -1e17 and 1: in order, the
+		//first one is lost; by pairs, both are lost; with the compensation, none is
+		const double averages[ ] = { 1.0 / 1024, 0, 2.0 / 1024 };
+		Population cancellation( 1024, 1, 0 );
+		for( p=0; p < 1024; p++ ) {
+			cancellation.objectiveFunctionValues[ p ] = 0;
+			cancellation.setValue( p, 0, -1 );
+		}
+		cancellation.objectiveFunctionValues[ 0 ] = 1;
+		cancellation.objectiveFunctionValues[ 256 ] = 1e17;
+		cancellation.objectiveFunctionValues[ 512 ] = -1e17;
+		cancellation.objectiveFunctionValues[ 768 ] = 1;
+
+		//a single tile is added in order by every policy
+		Population tile( 256, 3, 50 );
+		Method naive( 3 );
+		const Result expectedTile = calculate( naive, tile, POINTERS );
+
+		Population population( 3 * BLOCK_SIZE + 2000, 3, 51 );
+		for( p=0; p < 3; p++ ) {
+
+			Method method( 1 );
+			method.setSummationPolicy( policies[ p ] );
+			for( Input input : INPUTS ) {
+				calculate( method, cancellation, input );
+				CHECK( same( method.getAverageObjectiveFunctionValues( ), averages[ p ] ) );
+			}
+
+			Method single( 3 );
+			single.setSummationPolicy( policies[ p ] );
+			CHECK( calculate( single, tile, POINTERS ) == expectedTile );
+			const Result expected = calculate( single, population, POINTERS );
+
+			Method parallel( 3 );
+			parallel.setSummationPolicy( policies[ p ] );
+			parallel.setThreadCount( 3 );
+			CHECK( calculate( parallel, population, POINTERS ) == expected );
+			CHECK( evaluate( parallel, population, COLUMNS ) == expected );
+
+			Method chunks( 3 );
+			chunks.setSummationPolicy( policies[ p ] );
+			CHECK( calculateChunks( chunks, population, BLOCK_SIZE ) == expected );
+
+		}
+
+	}
+
+	/*
+	 * Indicates if a future is ready.
+	 */
+	template< typename F >
+	bool isReady( const F& future ) {
+		return future.wait_for( std::chrono::seconds( 0 ) ) == std::future_status::ready;
+	}
+
+	/*
+	 * Indicates if a push to a pipeline throws std::logic_error.
+	 */
+	template< typename P >
+	bool rejects( P push ) {
+		try {
+			push( );
+		} catch( const std::logic_error& ) {
+			return true;
+		}
+		return false;
+	}
+
+	/*
+	 * The chunks pushed concurrently and out of order to a pipeline give
+	 * the results of 'evaluateGeneration'; the snapshot is ready with
+	 * the coefficients; the pushes which do not fit in the generation
+	 * are rejected before they are accumulated.
+	 */
+	void testPipeline( ) {
+
+		int c;
+		const int n = 3 * BLOCK_SIZE + 500;
+		Population population( n, 4, 60 );
+		Method whole( 4 );
+		const Result expected = evaluate( whole, population, POINTERS );
+
+		Method method( 4 );
+		Result result( population );
+		double* objectives = population.objectiveFunctionValues.data( );
+		typedef apm::GenerationPipeline< double > Pipeline;
+		Pipeline pipeline( method, n, result.penaltyCoefficients.data( ) );
+		std::vector< std::future< void > > scored( 4 );
+		//the first chunk is pushed last, after the others are accumulated
+		std::vector< std::thread > threads;
+		for( c=3; c > 0; c-- ) {
+			threads.emplace_back( [ &, c ]( ) {
+				const int first = c * BLOCK_SIZE;
+				const int size = c == 3? n - first: BLOCK_SIZE;
+				if ( c % 2 == 0 ) {
+					scored[ c ] = pipeline.push( first, size, &result.fitnessValues[ first ], objectives + first,
+						population.constraintViolationValues.data( ) + first );
+				} else {
+					scored[ c ] = pipeline.push( first, size, &result.fitnessValues[ first ], objectives + first,
+						population.columns.data( ) + first, apm::COLUMN_MAJOR, (std::size_t) n );
+				}
+			} );
+		}
+		for( std::thread& thread : threads ) {
+			thread.join( );
+		}
+		CHECK( !isReady( pipeline.getSnapshot( ) ) );
+		scored[ 0 ] = pipeline.push( 0, BLOCK_SIZE, &result.fitnessValues[ 0 ], objectives, &population.rows[ 0 ],
+			apm::ROW_MAJOR, population.rowDimension( ) );
+		CHECK( isReady( pipeline.getSnapshot( ) ) );
+		for( c=0; c < 4; c++ ) {
+			scored[ c ].get( );
+		}
+		result.averageObjectiveFunctionValues = method.getAverageObjectiveFunctionValues( );
+		CHECK( result == expected );
+		const Pipeline::Snapshot snapshot = pipeline.getSnapshot( ).get( );
+		CHECK( same( std::vector< double >( snapshot->getPenaltyCoefficients( ), snapshot->getPenaltyCoefficients( ) + 4 ),
+			expected.penaltyCoefficients ) );
+
+		//a push after the generation is complete does not change the method or the coefficients
+		CHECK( rejects( [ & ]( ) {
+			pipeline.push( 0, BLOCK_SIZE, &result.fitnessValues[ 0 ], objectives, population.constraintViolationValues.data( ) );
+		} ) );
+		CHECK( result == expected );
+		bool accumulated = true;
+		try {
+			method.finalize( result.penaltyCoefficients.data( ) );
+		} catch( const std::logic_error& ) {
+			accumulated = false;
+		}
+		CHECK( !accumulated );
+
+		//the chunks larger than the population and the ones beyond it
+		Method other( 4 );
+		std::vector< double > penaltyCoefficients( 4 );
+		Pipeline partial( other, 2 * BLOCK_SIZE, penaltyCoefficients.data( ) );
+		std::future< void > first = partial.push( 0, BLOCK_SIZE, &result.fitnessValues[ 0 ], objectives,
+			population.constraintViolationValues.data( ) );
+		CHECK( rejects( [ & ]( ) {
+			partial.push( 0, 2 * BLOCK_SIZE, &result.fitnessValues[ 0 ], objectives, population.constraintViolationValues.data( ) );
+		} ) );
+		CHECK( rejects( [ & ]( ) {
+			partial.push( BLOCK_SIZE, BLOCK_SIZE + 1, &result.fitnessValues[ 0 ], objectives, population.constraintViolationValues.data( ) );
+		} ) );
+		//an overlap is rejected by the method and its place is released
+		bool overlap = false;
+		try {
+			partial.push( 0, BLOCK_SIZE, &result.fitnessValues[ 0 ], objectives, population.constraintViolationValues.data( ) );
+		} catch( const std::invalid_argument& ) {
+			overlap = true;
+		}
+		CHECK( overlap );
+		std::future< void > second = partial.push( BLOCK_SIZE, BLOCK_SIZE, &result.fitnessValues[ BLOCK_SIZE ], objectives + BLOCK_SIZE,
+			population.constraintViolationValues.data( ) + BLOCK_SIZE );
+		first.get( );
+		second.get( );
+		CHECK( isReady( partial.getSnapshot( ) ) );
+
+	}
+
+	/*
+	 * The selection gives the first candidate solutions of a stable sort
+	 * of the fitness values (the NaN values last) for any number of
+	 * threads, including the selections larger than a reduction block
+	 * or than the population.
+	 */
+	void testSelection( ) {
+
+		int i;
+		const int n = 3 * BLOCK_SIZE + 100;
+		const int sizes[ ] = { 1, 10, BLOCK_SIZE + 7, n, n + 5 };
+		const int threads[ ] = { 1, 3 };
+		Population population( n, 4, 90 );
+		std::vector< double > penaltyCoefficients( 4 );
+		Method coefficients( 4 );
+		coefficients.calculatePenaltyCoefficients( n, population.objectiveFunctionValues.data( ), population.constraintViolationValues.data( ),
+			penaltyCoefficients.data( ) );
+		//many ties and some NaN values (the feasible candidate solutions keep their objective function values)
+		for( i=0; i < n; i++ ) {
+			population.objectiveFunctionValues[ i ] = i % 97 == 0? std::nan( "" ): std::floor( population.objectiveFunctionValues[ i ] / 200 );
+		}
+
+		for( int count : threads ) {
+			for( int size : sizes ) {
+
+				Method method( coefficients );
+				method.setThreadCount( count );
+				method.setSelectionSize( size );
+				std::vector< double > fitnessValues( n );
+				method.calculateFitness( fitnessValues.data( ), n, population.objectiveFunctionValues.data( ),
+					population.constraintViolationValues.data( ), penaltyCoefficients.data( ) );
+
+				std::vector< int > expected( n );
+				for( i=0; i < n; i++ ) {
+					expected[ i ] = i;
+				}
+				std::stable_sort( expected.begin( ), expected.end( ), [ &fitnessValues ]( int a, int b ) {
+					return !std::isnan( fitnessValues[ a ] ) && ( std::isnan( fitnessValues[ b ] ) || fitnessValues[ a ] < fitnessValues[ b ] );
+				} );
+				const int selected = size < n? size: n;
+				CHECK( method.getNumberOfBestIndividuals( ) == selected );
+				CHECK( std::equal( expected.begin( ), expected.begin( ) + selected, method.getBestIndividuals( ) ) );
+
+			}
+		}
+
+	}
+
+	/*
+	 * Indicates if an incremental update throws std::logic_error.
+	 */
+	template< typename U >
+	bool isForbidden( U update ) {
+		try {
+			update( );
+		} catch( const std::logic_error& ) {
+			return true;
+		}
+		return false;
+	}
+
+	/*
+	 * The incremental updates give the coefficients of the population
+	 * recalculated (the values are exact in binary, so every order of
+	 * the additions gives the same sums); the resynchronization is due
+	 * after the interval and after a change of the constraints, which
+	 * forbids the updates until the population is recalculated.
+	 */
+	void testIncremental( ) {
+
+		int i;
+		std::vector< double > penaltyCoefficients( 3 );
+		Population population( 300, 3, 80 );
+		for( i=0; i < 300; i++ ) {
+			population.objectiveFunctionValues[ i ] = (double) ( (int) population.objectiveFunctionValues[ i ] );
+			population.setValue( i, 0, (double) ( (int) ( population.constraintViolationValues[ i ][ 0 ] * 4 ) ) / 4 );
+			population.setValue( i, 1, (double) ( (int) ( population.constraintViolationValues[ i ][ 1 ] * 4 ) ) / 4 );
+			population.setValue( i, 2, (double) ( (int) ( population.constraintViolationValues[ i ][ 2 ] * 4 ) ) / 4 );
+		}
+		double* objectives = population.objectiveFunctionValues.data( );
+		double** violations = population.constraintViolationValues.data( );
+
+		//the population 0-199 becomes 30-259
+		Method method( 3 );
+		method.setResynchronizationInterval( 5 );
+		method.calculatePenaltyCoefficients( 200, objectives, violations, penaltyCoefficients.data( ) );
+		for( i=200; i < 250; i++ ) {
+			method.addIndividual( objectives[ i ], violations[ i ], penaltyCoefficients.data( ) );
+		}
+		for( i=0; i < 20; i++ ) {
+			method.removeIndividual( objectives[ i ], violations[ i ], penaltyCoefficients.data( ) );
+		}
+		for( i=20; i < 30; i++ ) {
+			method.replaceIndividual( objectives[ i ], violations[ i ], objectives[ i + 230 ], violations[ i + 230 ], penaltyCoefficients.data( ) );
+		}
+		Population remaining( 230, 3, 0 );
+		for( i=0; i < 230; i++ ) {
+			remaining.objectiveFunctionValues[ i ] = objectives[ i + 30 ];
+			remaining.setValue( i, 0, violations[ i + 30 ][ 0 ] );
+			remaining.setValue( i, 1, violations[ i + 30 ][ 1 ] );
+			remaining.setValue( i, 2, violations[ i + 30 ][ 2 ] );
+		}
+		Method full( 3 );
+		const Result expected = calculate( full, remaining, POINTERS );
+		Result result( remaining );
+		result.penaltyCoefficients = penaltyCoefficients;
+		method.calculateFitness( result.fitnessValues.data( ), 230, remaining.objectiveFunctionValues.data( ),
+			remaining.constraintViolationValues.data( ), penaltyCoefficients.data( ) );
+		result.averageObjectiveFunctionValues = method.getAverageObjectiveFunctionValues( );
+		CHECK( result == expected );
+		CHECK( method.isResynchronizationDue( ) );
+
+		//a replacement is a single update
+		method.calculatePenaltyCoefficients( 200, objectives, violations, penaltyCoefficients.data( ) );
+		CHECK( !method.isResynchronizationDue( ) );
+		for( i=0; i < 4; i++ ) {
+			method.replaceIndividual( objectives[ i ], violations[ i ], objectives[ i ], violations[ i ], penaltyCoefficients.data( ) );
+		}
+		CHECK( !method.isResynchronizationDue( ) );
+		method.addIndividual( objectives[ 200 ], violations[ 200 ], penaltyCoefficients.data( ) );
+		CHECK( method.isResynchronizationDue( ) );
+
+		//the factors of the constraints are applied to the sums, so they may change
+		Method changed( 3 );
+		changed.calculatePenaltyCoefficients( 200, objectives, violations, penaltyCoefficients.data( ) );
+		changed.setConstraintNormalization( 1, 2 );
+		CHECK( !changed.isResynchronizationDue( ) );
+		changed.addIndividual( objectives[ 200 ], violations[ 200 ], penaltyCoefficients.data( ) );
+
+		//the kinds and the tolerances change the violations of the population
+		for( i=0; i < 3; i++ ) {
+			if ( i == 0 ) {
+				changed.setConstraintKind( 0, apm::EQUALITY_CONSTRAINT, 0.5 );
+			} else if ( i == 1 ) {
+				changed.setEqualityTolerance( 0.25 );
+			} else {
+				changed.annealTolerances( 0.5, 0 );
+			}
+			CHECK( changed.isResynchronizationDue( ) );
+			CHECK( isForbidden( [ & ]( ) { changed.addIndividual( objectives[ 201 ], violations[ 201 ], penaltyCoefficients.data( ) ); } ) );
+			CHECK( isForbidden( [ & ]( ) { changed.removeIndividual( objectives[ 0 ], violations[ 0 ], penaltyCoefficients.data( ) ); } ) );
+			CHECK( isForbidden( [ & ]( ) {
+				changed.replaceIndividual( objectives[ 0 ], violations[ 0 ], objectives[ 1 ], violations[ 1 ], penaltyCoefficients.data( ) );
+			} ) );
+			changed.calculatePenaltyCoefficients( 200, objectives, violations, penaltyCoefficients.data( ) );
+			CHECK( !changed.isResynchronizationDue( ) );
+			changed.addIndividual( objectives[ 200 ], violations[ 200 ], penaltyCoefficients.data( ) );
+		}
+
+		//without a population, the constraints may change before the updates
+		Method empty( 3 );
+		empty.setConstraintKind( 2, apm::EQUALITY_CONSTRAINT, 0.5 );
+		empty.addIndividual( objectives[ 0 ], violations[ 0 ], penaltyCoefficients.data( ) );
+		CHECK( isForbidden( [ & ]( ) { empty.removeIndividual( objectives[ 0 ], violations[ 0 ], penaltyCoefficients.data( ) ); } ) );
+
+		//the adaptive normalization decays once per population
+		Method adaptive( 3 );
+		adaptive.setAdaptiveNormalization( true, 0.5 );
+		adaptive.calculatePenaltyCoefficients( 200, objectives, violations, penaltyCoefficients.data( ) );
+		const double factor = adaptive.getConstraintNormalization( 0 );
+		for( i=0; i < 10; i++ ) {
+			adaptive.replaceIndividual( objectives[ i ], violations[ i ], objectives[ i + 200 ], violations[ i + 200 ], penaltyCoefficients.data( ) );
+		}
+		CHECK( same( adaptive.getConstraintNormalization( 0 ), factor ) );
+
+	}
+
+#ifdef APM_TEST_IO
+	/*
+	 * Write the bytes of a file.
+	 */
+	void writeFile( const char* fileName, const std::vector< unsigned char >& bytes ) {
+		std::FILE* file = std::fopen( fileName, "wb" );
+		std::fwrite( bytes.data( ), 1, bytes.size( ), file );
+		std::fclose( file );
+	}
+
+	/*
+	 * Read the bytes of a file.
+	 */
+	std::vector< unsigned char > readFile( const char* fileName ) {
+		std::vector< unsigned char > bytes;
+		std::FILE* file = std::fopen( fileName, "rb" );
+		int byte;
+		while( ( byte = std::fgetc( file ) ) != EOF ) {
+			bytes.push_back( (unsigned char) byte );
+		}
+		std::fclose( file );
+		return bytes;
+	}
+
+	/*
+	 * Indicates if a file is rejected by MappedPopulation.
+	 */
+	bool isRejected( const char* fileName ) {
+		try {
+			apm::MappedPopulation population( fileName );
+		} catch( const std::runtime_error& ) {
+			return true;
+		}
+		return false;
+	}
+
+	/*
+	 * The populations written with both layouts and the fitness values
+	 * are mapped with the values in memory and give the results of the
+	 * population in memory; the invalid files are rejected.
+	 */
+	void testIo( ) {
+
+		int i;
+		int j;
+		const char* fileName = "apm-test-population.apm";
+		const Input inputs[ ] = { ROWS, COLUMNS };
+		Population population( BLOCK_SIZE + 300, 5, 70 );
+		const int n = population.populationSize;
+
+		for( Input input : inputs ) {
+
+			const apm::ViolationLayout layout = input == ROWS? apm::ROW_MAJOR: apm::COLUMN_MAJOR;
+			apm::writePopulation< double >( fileName, (std::size_t) n, 5, population.objectiveFunctionValues.data( ),
+				input == ROWS? population.rows.data( ): population.columns.data( ), layout,
+				input == ROWS? population.rowDimension( ): (std::size_t) n );
+			{
+				apm::MappedPopulation mapped( fileName );
+				CHECK( mapped.getPopulationSize( ) == (std::size_t) n && mapped.getNumberOfConstraints( ) == 5 );
+				CHECK( mapped.getLayout( ) == layout && mapped.getValueType( ) == apm::FLOAT64 );
+				//the matrix is written densely
+				const std::size_t leadingDimension = mapped.getLeadingDimension( );
+				CHECK( leadingDimension == ( input == ROWS? 5: (std::size_t) n ) );
+				const double* objectives = mapped.objectiveFunctionValues< double >( );
+				const double* violations = mapped.constraintViolationValues< double >( );
+				bool equal = true;
+				for( i=0; i < n; i++ ) {
+					equal = equal && same( objectives[ i ], population.objectiveFunctionValues[ i ] );
+					for( j=0; j < 5; j++ ) {
+						const double value = input == ROWS? violations[ i * leadingDimension + j ]: violations[ j * leadingDimension + i ];
+						equal = equal && same( value, population.constraintViolationValues[ i ][ j ] );
+					}
+				}
+				CHECK( equal );
+
+				Method memory( 5 );
+				const Result expected = evaluate( memory, population, input );
+				Method method( 5 );
+				Result result( population );
+				method.evaluateGeneration( result.fitnessValues.data( ), n, objectives, violations, layout, leadingDimension,
+					result.penaltyCoefficients.data( ) );
+				result.averageObjectiveFunctionValues = method.getAverageObjectiveFunctionValues( );
+				CHECK( result == expected );
+
+				bool thrown = false;
+				try {
+					mapped.objectiveFunctionValues< float >( );
+				} catch( const std::logic_error& ) {
+					thrown = true;
+				}
+				CHECK( thrown );
+
+				//the fitness values are written in pieces
+				{
+					apm::FitnessWriter< double > writer( "apm-test-fitness.apm" );
+					writer.write( result.fitnessValues.data( ), 1000 );
+					writer.write( result.fitnessValues.data( ) + 1000, 0 );
+					writer.write( result.fitnessValues.data( ) + 1000, n - 1000 );
+					writer.close( );
+				}
+				apm::MappedPopulation fitness( "apm-test-fitness.apm" );
+				CHECK( fitness.getPopulationSize( ) == (std::size_t) n && fitness.getNumberOfConstraints( ) == 0 );
+				CHECK( std::memcmp( fitness.objectiveFunctionValues< double >( ), result.fitnessValues.data( ), n * sizeof( double ) ) == 0 );
+			}
+
+		}
+
+		//the invalid files, made from the valid one of the last layout
+		const std::vector< unsigned char > valid = readFile( fileName );
+		apm::PopulationHeader header;
+		std::memcpy( &header, valid.data( ), sizeof( header ) );
+		CHECK( !isRejected( fileName ) );
+		CHECK( isRejected( "apm-test-missing.apm" ) );
+		for( i=0; i < 8; i++ ) {
+
+			std::vector< unsigned char > bytes = valid;
+			apm::PopulationHeader changed = header;
+			if ( i == 0 ) {
+				bytes.resize( sizeof( header ) / 2 );
+			} else if ( i == 1 ) {
+				bytes.resize( bytes.size( ) - 1 );
+			} else if ( i == 2 ) {
+				changed.magic[ 0 ] = 'X';
+			} else if ( i == 3 ) {
+				changed.byteOrder = 0x04030201;
+			} else if ( i == 4 ) {
+				changed.leadingDimension = changed.layout == apm::ROW_MAJOR? changed.numberOfConstraints - 1: changed.populationSize - 1;
+			} else if ( i == 5 ) {
+				changed.objectiveFunctionOffset = ( bytes.size( ) / 64 + 1 ) * 64;
+			} else if ( i == 6 ) {
+				changed.constraintViolationOffset = (std::uint64_t) 1 << 62;
+			} else {
+				changed.populationSize = ( (std::uint64_t) 1 << 61 ) + 1;
+			}
+			if ( i >= 2 ) {
+				std::memcpy( bytes.data( ), &changed, sizeof( changed ) );
+			}
+			writeFile( fileName, bytes );
+			CHECK( isRejected( fileName ) );
+
+		}
+		std::remove( fileName );
+		std::remove( "apm-test-fitness.apm" );
+
+	}
+#endif
+
+	/*
+	 * The tests, by name.
+	 */
+	struct Test {
+		const char* name;
+		void ( *run )( );
+	};
+
+	const Test TESTS[ ] = {
+		{ "fused", testFused },
+		{ "simd", testSimd },
+		{ "threads", testThreads },
+		{ "chunks", testChunks },
+		{ "sparse", testSparse },
+		{ "summation", testSummation },
+		{ "equality", testEquality },
+		{ "pipeline", testPipeline },
+		{ "selection", testSelection },
+		{ "incremental", testIncremental },
+#ifdef APM_TEST_IO
+		{ "io", testIo },
+#endif
+	};
+
+}
+
+int main( int argc, char** argv ) {
+
+	bool found = false;
+	for( const Test& test : TESTS ) {
+		if ( argc < 2 || std::string( argv[ 1 ] ) == test.name ) {
+			test.run( );
+			found = true;
+		}
+	}
+	if ( !found ) {
+		std::printf( "unknown test '%s'\n", argv[ 1 ] );
+		return 1;
+	}
+	if ( failures > 0 ) {
+		std::printf( "%d checks failed\n", failures );
+		return 1;
+	}
+	return 0;
+
+}
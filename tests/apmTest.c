@@ -0,0 +1,366 @@
+/*
+ * File:   apmTest.c
+ * Author: Heder Soares Bernardino
+ *
+ * Tests of the C interface (apm.h). Each test checks that two ways of
+ * calculating the penalty coefficients and the fitness values give
+ * bitwise identical results (or the documented ones):
+ * - workspace: the functions with a workspace and the original
+ * functions, which allocate no memory per call;
+ * - contiguous: the functions of the shared core for contiguous
+ * matrices and for the pointers to the rows, and the invalid arguments.
+ * The allocations are counted when the program is linked with
+ * '-Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc' and
+ * APM_TEST_WRAP_MALLOC is defined (see CMakeLists.txt).
+ *
+ * Compilation:
+ * Use the following commands, in the root directory of the project, to
+ * compile and run the tests:
+ * gcc -c -I. tests/apmTest.c apm.c
+ * g++ -pthread apmTest.o apm.o AdaptivePenaltyMethodC.cpp AdaptivePenaltyMethod.cpp AdaptivePenaltyMethodKernels.cpp AdaptivePenaltyMethodParallel.cpp -o apm-c-test
+ * ./apm-c-test workspace
+ * Without a name, all the tests are run. With CMake, they are run by
+ * 'ctest' (see CMakeLists.txt). The program returns 1 if a check fails.
+ */
+
+/*
+ * Includes.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "apm.h"
+
+//number of the failed checks
+static int failures = 0;
+
+//number of the allocations of memory
+static long allocations = 0;
+
+#ifdef APM_TEST_WRAP_MALLOC
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* pointer, size_t size);
+
+void* __wrap_malloc(size_t size) {
+	allocations++;
+	return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+	allocations++;
+	return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* pointer, size_t size) {
+	allocations++;
+	return __real_realloc(pointer, size);
+}
+#endif
+
+/*
+ * Record a failed check.
+ */
+static void check(int condition, const char* expression, int line) {
+	if ( !condition ) {
+		printf("line %d: %s\n", line, expression);
+		failures++;
+	}
+}
+
+#define CHECK( condition ) check(( condition ), #condition, __LINE__)
+
+/*
+ * Indicates if two arrays have the same bits.
+ */
+static int same(const double* a, const double* b, int size) {
+	return memcmp(a, b, size * sizeof ( double)) == 0;
+}
+
+/*
+ * A population with random objective function and constraint
+ * violation values; about half of the violations are zero.
+ * - objectiveFunctionValues: 'populationSize' values;
+ * - rows: the constraint violation values of each candidate solution;
+ * - values: the matrix of the rows (row-major, leading dimension
+ * 'numberOfConstraints').
+ */
+typedef struct {
+	int populationSize;
+	int numberOfConstraints;
+	double* objectiveFunctionValues;
+	double** rows;
+	double* values;
+} Population;
+
+/*
+ * Name: createPopulation
+ * Description: Allocate and fill a population; 'seed' selects the values.
+ */
+static void createPopulation(Population* population, int populationSize, int numberOfConstraints, unsigned seed) {
+
+	int i;
+	int j;
+	unsigned state = seed;
+	population->populationSize = populationSize;
+	population->numberOfConstraints = numberOfConstraints;
+	population->objectiveFunctionValues = (double*) malloc(populationSize * sizeof ( double));
+	population->rows = (double**) malloc(populationSize * sizeof ( double*));
+	population->values = (double*) malloc((size_t) populationSize * numberOfConstraints * sizeof ( double));
+	for (i = 0; i < populationSize; i++) {
+		population->rows[ i ] = population->values + (size_t) i * numberOfConstraints;
+		state = state * 1103515245u + 12345u;
+		population->objectiveFunctionValues[ i ] = (double) (state >> 8) / (1 << 24) * 200 - 100;
+		for (j = 0; j < numberOfConstraints; j++) {
+			state = state * 1103515245u + 12345u;
+			population->rows[ i ][ j ] = (state >> 31)? (double) (state >> 8) / (1 << 24) * 10: 0;
+		}
+	}
+
+}
+
+/*
+ * Name: destroyPopulation
+ * Description: Release the memory of a population.
+ */
+static void destroyPopulation(Population* population) {
+	free(population->objectiveFunctionValues);
+	free(population->rows);
+	free(population->values);
+}
+
+/*
+ * The functions with a workspace, initialized or attached, give the
+ * results of the original functions along the generations, and allocate
+ * no memory after the initialization of the workspace.
+ */
+static void testWorkspace(void) {
+
+	int generation;
+	long allocated;
+	const int populationSize = 1000;
+	const int numberOfConstraints = 5;
+	double penaltyCoefficients[ 5 ];
+	double averageObjectiveFunctionValues;
+	double sumViolation[ 5 ];
+	double workspacePenaltyCoefficients[ 5 ];
+	double attachedPenaltyCoefficients[ 5 ];
+	double* fitnessValues = (double*) malloc(populationSize * sizeof ( double));
+	double* workspaceFitnessValues = (double*) malloc(populationSize * sizeof ( double));
+	double* attachedFitnessValues = (double*) malloc(populationSize * sizeof ( double));
+	APMWorkspace workspace;
+	APMWorkspace attached;
+	Population population;
+	allocated = allocations;
+	CHECK(initializeWorkspace(&workspace, numberOfConstraints) == 0);
+#ifdef APM_TEST_WRAP_MALLOC
+	//the allocations of the library are counted
+	CHECK(allocations > allocated);
+#endif
+	attachWorkspace(&attached, numberOfConstraints, sumViolation);
+
+	for (generation = 0; generation < 3; generation++) {
+
+		createPopulation(&population, populationSize, numberOfConstraints, 7 + generation);
+		calculatePenaltyCoefficients(populationSize, population.objectiveFunctionValues, population.rows,
+			numberOfConstraints, penaltyCoefficients, &averageObjectiveFunctionValues);
+		calculateAllFitness(fitnessValues, populationSize, population.objectiveFunctionValues, population.rows,
+			numberOfConstraints, penaltyCoefficients, averageObjectiveFunctionValues);
+
+		allocated = allocations;
+		calculatePenaltyCoefficientsWithWorkspace(&workspace, populationSize, population.objectiveFunctionValues,
+			population.rows, workspacePenaltyCoefficients);
+		calculateAllFitnessWithWorkspace(&workspace, workspaceFitnessValues, populationSize,
+			population.objectiveFunctionValues, population.rows, workspacePenaltyCoefficients);
+		calculatePenaltyCoefficientsWithWorkspace(&attached, populationSize, population.objectiveFunctionValues,
+			population.rows, attachedPenaltyCoefficients);
+		calculateAllFitnessWithWorkspace(&attached, attachedFitnessValues, populationSize,
+			population.objectiveFunctionValues, population.rows, attachedPenaltyCoefficients);
+		CHECK(allocations == allocated);
+
+		CHECK(same(penaltyCoefficients, workspacePenaltyCoefficients, numberOfConstraints));
+		CHECK(same(penaltyCoefficients, attachedPenaltyCoefficients, numberOfConstraints));
+		CHECK(same(&averageObjectiveFunctionValues, &workspace.averageObjectiveFunctionValues, 1));
+		CHECK(same(&averageObjectiveFunctionValues, &attached.averageObjectiveFunctionValues, 1));
+		CHECK(same(fitnessValues, workspaceFitnessValues, populationSize));
+		CHECK(same(fitnessValues, attachedFitnessValues, populationSize));
+		destroyPopulation(&population);
+
+	}
+
+	releaseWorkspace(&workspace);
+	releaseWorkspace(&attached);
+	free(fitnessValues);
+	free(workspaceFitnessValues);
+	free(attachedFitnessValues);
+
+}
+
+/*
+ * Copy the constraint violation values of a population to a contiguous
+ * matrix; the padding of the leading dimension is NaN, so it must not
+ * be read.
+ */
+static double* copyViolations(const Population* population, APMLayout layout, size_t leadingDimension) {
+
+	int i;
+	int j;
+	size_t size = leadingDimension * (layout == APM_ROW_MAJOR? population->populationSize: population->numberOfConstraints);
+	double* values = (double*) malloc(size * sizeof ( double));
+	for (i = 0; i < (int) size; i++) {
+		values[ i ] = NAN;
+	}
+	for (i = 0; i < population->populationSize; i++) {
+		for (j = 0; j < population->numberOfConstraints; j++) {
+			values[ layout == APM_ROW_MAJOR? i * leadingDimension + j: j * leadingDimension + i ] = population->rows[ i ][ j ];
+		}
+	}
+	return values;
+
+}
+
+/*
+ * Indicates if the three functions for contiguous matrices reject
+ * the arguments with APM_INVALID_ARGUMENT and do not write the results.
+ */
+static int rejects(APMMethod* method, const Population* population, int populationSize, const double* values,
+	APMLayout layout, size_t leadingDimension) {
+
+	int i;
+	int rejected = 1;
+	double penaltyCoefficients[ 5 ];
+	double fitnessValues[ 1 ] = { 1 };
+	double untouched[ 5 ];
+	for (i = 0; i < 5; i++) {
+		penaltyCoefficients[ i ] = untouched[ i ] = i;
+	}
+	rejected = rejected && calculatePenaltyCoefficientsContiguous(method, populationSize, population->objectiveFunctionValues,
+		values, layout, leadingDimension, penaltyCoefficients) == APM_INVALID_ARGUMENT;
+	rejected = rejected && calculateAllFitnessContiguous(method, fitnessValues, populationSize, population->objectiveFunctionValues,
+		values, layout, leadingDimension, penaltyCoefficients) == APM_INVALID_ARGUMENT;
+	rejected = rejected && evaluateGenerationContiguous(method, fitnessValues, populationSize, population->objectiveFunctionValues,
+		values, layout, leadingDimension, penaltyCoefficients) == APM_INVALID_ARGUMENT;
+	return rejected && same(penaltyCoefficients, untouched, 5) && fitnessValues[ 0 ] == 1;
+
+}
+
+/*
+ * The functions for contiguous matrices, in both layouts and with a
+ * leading dimension larger than a row or a column, give the results
+ * of the functions for the pointers to the rows, with several threads
+ * and a population larger than a reduction block. The leading
+ * dimensions smaller than a row or a column, the unknown layouts and
+ * the negative sizes are rejected.
+ */
+static void testContiguous(void) {
+
+	int k;
+	const int populationSize = 5000;
+	const int numberOfConstraints = 5;
+	const APMLayout layouts[ ] = { APM_ROW_MAJOR, APM_COLUMN_MAJOR };
+	const size_t leadingDimensions[ ] = { numberOfConstraints + 2, populationSize + 3 };
+	double penaltyCoefficients[ 5 ];
+	double contiguousPenaltyCoefficients[ 5 ];
+	double averageObjectiveFunctionValues;
+	double* fitnessValues = (double*) malloc(populationSize * sizeof ( double));
+	double* evaluatedFitnessValues = (double*) malloc(populationSize * sizeof ( double));
+	double* contiguousFitnessValues = (double*) malloc(populationSize * sizeof ( double));
+	double* values;
+	APMMethod* method = createMethod(numberOfConstraints);
+	Population population;
+	createPopulation(&population, populationSize, numberOfConstraints, 11);
+	setMethodThreads(method, 3);
+
+	CHECK(calculatePenaltyCoefficientsWithMethod(method, populationSize, population.objectiveFunctionValues, population.rows,
+		penaltyCoefficients) == APM_SUCCESS);
+	averageObjectiveFunctionValues = getMethodAverageObjectiveFunctionValues(method);
+	CHECK(calculateAllFitnessWithMethod(method, fitnessValues, populationSize, population.objectiveFunctionValues, population.rows,
+		penaltyCoefficients) == APM_SUCCESS);
+	CHECK(evaluateGenerationWithMethod(method, evaluatedFitnessValues, populationSize, population.objectiveFunctionValues,
+		population.rows, contiguousPenaltyCoefficients) == APM_SUCCESS);
+	CHECK(same(penaltyCoefficients, contiguousPenaltyCoefficients, numberOfConstraints));
+	CHECK(same(fitnessValues, evaluatedFitnessValues, populationSize));
+
+	for (k = 0; k < 2; k++) {
+
+		values = copyViolations(&population, layouts[ k ], leadingDimensions[ k ]);
+		CHECK(calculatePenaltyCoefficientsContiguous(method, populationSize, population.objectiveFunctionValues, values,
+			layouts[ k ], leadingDimensions[ k ], contiguousPenaltyCoefficients) == APM_SUCCESS);
+		CHECK(same(penaltyCoefficients, contiguousPenaltyCoefficients, numberOfConstraints));
+		CHECK(getMethodAverageObjectiveFunctionValues(method) == averageObjectiveFunctionValues);
+		CHECK(calculateAllFitnessContiguous(method, contiguousFitnessValues, populationSize, population.objectiveFunctionValues,
+			values, layouts[ k ], leadingDimensions[ k ], contiguousPenaltyCoefficients) == APM_SUCCESS);
+		CHECK(same(fitnessValues, contiguousFitnessValues, populationSize));
+		CHECK(evaluateGenerationContiguous(method, contiguousFitnessValues, populationSize, population.objectiveFunctionValues,
+			values, layouts[ k ], leadingDimensions[ k ], contiguousPenaltyCoefficients) == APM_SUCCESS);
+		CHECK(same(penaltyCoefficients, contiguousPenaltyCoefficients, numberOfConstraints));
+		CHECK(same(fitnessValues, contiguousFitnessValues, populationSize));
+
+		//a negative size, with a valid leading dimension, and a leading dimension smaller than a row or a column
+		CHECK(rejects(method, &population, -1, values, layouts[ k ], leadingDimensions[ k ]));
+		CHECK(rejects(method, &population, populationSize, values, layouts[ k ],
+			layouts[ k ] == APM_ROW_MAJOR? numberOfConstraints - 1: populationSize - 1));
+		free(values);
+
+	}
+
+	//an unknown layout and the negative sizes of the functions for the pointers to the rows
+	values = copyViolations(&population, APM_ROW_MAJOR, numberOfConstraints);
+	CHECK(rejects(method, &population, populationSize, values, (APMLayout) 2, populationSize));
+	CHECK(calculatePenaltyCoefficientsWithMethod(method, -1, population.objectiveFunctionValues, population.rows,
+		contiguousPenaltyCoefficients) == APM_INVALID_ARGUMENT);
+	CHECK(calculateAllFitnessWithMethod(method, contiguousFitnessValues, -1, population.objectiveFunctionValues, population.rows,
+		penaltyCoefficients) == APM_INVALID_ARGUMENT);
+	CHECK(evaluateGenerationWithMethod(method, contiguousFitnessValues, -1, population.objectiveFunctionValues, population.rows,
+		contiguousPenaltyCoefficients) == APM_INVALID_ARGUMENT);
+	//the results of the last population are kept
+	CHECK(getMethodAverageObjectiveFunctionValues(method) == averageObjectiveFunctionValues);
+
+	free(values);
+	destroyMethod(method);
+	destroyPopulation(&population);
+	free(fitnessValues);
+	free(evaluatedFitnessValues);
+	free(contiguousFitnessValues);
+
+}
+
+/*
+ * A test and its name.
+ */
+typedef struct {
+	const char* name;
+	void (*run)(void);
+} Test;
+
+static const Test TESTS[ ] = {
+	{ "workspace", testWorkspace },
+	{ "contiguous", testContiguous }
+};
+
+/*
+ * Run the test named by the first argument, or all of them.
+ */
+int main(int argc, char** argv) {
+
+	size_t i;
+	int found = 0;
+	for (i = 0; i < sizeof ( TESTS) / sizeof ( TESTS[ 0 ]); i++) {
+		if ( argc < 2 || strcmp(argv[ 1 ], TESTS[ i ].name) == 0 ) {
+			TESTS[ i ].run();
+			found = 1;
+		}
+	}
+	if ( !found ) {
+		printf("unknown test '%s'\n", argv[ 1 ]);
+		return 1;
+	}
+	if ( failures > 0 ) {
+		printf("%d checks failed\n", failures);
+		return 1;
+	}
+	return 0;
+
+}